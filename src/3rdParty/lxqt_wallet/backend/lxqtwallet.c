@@ -32,7 +32,10 @@
 
 #ifndef _WIN32
 #include <sys/mman.h>
+#include <sys/file.h>
 #include <pwd.h>
+#else
+#include <io.h>
 #endif
 
 #include <sys/types.h>
@@ -46,14 +49,22 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <string.h>
+#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/keyctl.h>
+#endif
+
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #include <gcrypt.h>
 #pragma GCC diagnostic warning "-Wdeprecated-declarations"
 
 #define VERSION 200
+#define LOG_VERSION 300
+#define KDF_VERSION 400
 #define VERSION_SIZE sizeof( short )
 /*
  * below string MUST BE 11 bytes long
@@ -69,8 +80,44 @@
 
 #define PBKDF2_ITERATIONS 10000
 
+/*
+ * below string MUST BE 16 bytes long including the terminating '\0'
+ */
+#define KDF_MAGIC_STRING "lxqt_wallet_kdf"
+#define KDF_MAGIC_STRING_SIZE 16
+#define KDF_HEADER_SIZE 32
+#define KDF_TARGET_MILLISECONDS 250
+#define ARGON2ID_MEMORY 65536
+#define ARGON2ID_MIN_MEMORY 8192
+#define ARGON2ID_MAX_MEMORY 4194304
+#define ARGON2ID_MAX_ITERATIONS 1024
+#define ARGON2ID_MAX_PARALLELISM 64
+
+/*
+ * derived keys kept in the session keyring
+ */
+#define KEY_CACHE_PREFIX "lxqt_wallet"
+#define KEY_CACHE_LABEL "lxqt_wallet key cache"
+#define KEY_CACHE_ITERATIONS PBKDF2_ITERATIONS
+#define KEY_CACHE_DESCRIPTION_SIZE 4096
+#define KEY_CACHE_MAX_KEYS 512
+#define KEY_CACHE_PERMISSIONS 0x3b000000 /* possessor view,read,search,link and setattr */
+
 #define NODE_HEADER_SIZE ( 2 * sizeof( uint32_t ) )
 
+#define WALLET_HEADER_SIZE ( SALT_SIZE + IV_SIZE + MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE )
+
+#define LOG_ID_SIZE 8
+#define LOG_NONCE_SIZE 12
+#define LOG_TAG_SIZE 16
+#define LOG_RECORD_HEADER_SIZE ( sizeof( uint32_t ) + LOG_NONCE_SIZE )
+#define LOG_ENTRY_HEADER_SIZE ( 1 + NODE_HEADER_SIZE )
+#define LOG_AAD_SIZE ( LOG_ID_SIZE + sizeof( uint64_t ) + sizeof( uint32_t ) )
+#define LOG_KEY_LABEL "lxqt_wallet log key"
+#define LOG_RECORD_ADD 1
+#define LOG_RECORD_DELETE 2
+#define LOG_COMPACTION_THRESHOLD 64
+
 #define WALLET_EXTENSION ".lwt"
 
 struct lxqt_wallet_struct{
@@ -80,8 +127,19 @@ struct lxqt_wallet_struct{
 	char salt[ SALT_SIZE ] ;
 	char * wallet_data ;
 	uint64_t wallet_data_size ;
+	uint64_t wallet_data_capacity ;
 	uint64_t wallet_data_entry_count ;
+	uint64_t * index ;
+	uint64_t index_size ;
 	int wallet_modified ;
+	int log_fd ;
+	uint64_t log_end ;
+	uint64_t log_records ;
+	uint64_t log_sequence ;
+	char log_id[ LOG_ID_SIZE ] ;
+	char log_key[ PASSWORD_SIZE ] ;
+	lxqt_wallet_kdf_parameters_t kdf ;
+	uint64_t header_offset ;
 };
 
 /*
@@ -130,6 +188,45 @@ struct lxqt_wallet_struct{
  * The size of the value in the node is managed by a uint32_t data type.
  * The above two data types means a node can occupy upto 8 bytes + 8 GiB of memory.
  *
+ * The above describes version 200 wallets.They are still read but are written back in the
+ * format below the first time they are modified.
+ *
+ * Version 300 wallets keep the first 64 bytes of the header as described above with the
+ * version number set to 300.The first 8 bytes of the fourth 16 bytes hold a random log id
+ * that changes every time the wallet is rewritten,the remaining 8 bytes are unused.
+ *
+ * The load is an append only log of records that starts at the 64th byte.Adding or deleting
+ * a key appends one record and flushes it to disk instead of rewriting the whole file.
+ *
+ * A record starts with a uint32_t data type holding the size of its encrypted payload followed
+ * by a 12 bytes nonce,the payload and a 16 bytes authentication tag.The payload is encrypted
+ * using GCM mode of 256 bit AES with a key derived from the wallet key and the log id,the
+ * record's position in the log and the payload size are authenticated with it.
+ *
+ * The first byte of the payload is 1 for a record that adds a key and 2 for a record that deletes
+ * one.It is followed by a node as described above.
+ *
+ * A wallet is opened by replaying its log,the log stops at the first record that is incomplete
+ * or fails authentication and anything after it is discarded.
+ *
+ * The log is compacted into one record per key when the wallet is closed and more than half of
+ * its records no longer contribute to its content.
+ *
+ * Version 400 wallets are version 300 wallets with 32 bytes of unencrypted key derivation function
+ * parameters in front of them,every offset above moves by 32 bytes.
+ *
+ * The first 16 bytes are "lxqt_wallet_kdf" followed by a '\0',a salt that happens to start a version
+ * 200 or 300 wallet will not look like this.
+ * The second 16 bytes are four uint32_t data types holding the function(1 for PBKDF2-SHA256 and 2 for
+ * Argon2id),the number of iterations or passes,the Argon2id memory cost in KiB and the number of
+ * Argon2id lanes.
+ *
+ * Older wallets have their key derived with 10000 iterations of PBKDF2-SHA256.
+ *
+ * Builds that predate version 400 can not tell its header from a salt and report a wrong password
+ * for these wallets.A wallet is therefore only written in version 400 format when calibrated
+ * parameters were asked for with lxqt_wallet_calibrated_kdf() while it was created or while its
+ * password was changed,every other wallet is written in version 300 format.
  */
 
 static void _lxqt_wallet_write( int x,const void * y,size_t z )
@@ -149,15 +246,26 @@ static char * _wallet_full_path( char * path_buffer,uint32_t path_buffer_size,co
 
 static void _create_application_wallet_path( const char * application_name ) ;
 
-static gcry_error_t _create_key( const char salt[ SALT_SIZE ],char output_key[ PASSWORD_SIZE ],const char * input_key,uint32_t input_key_length ) ;
+static gcry_error_t _create_key( const char salt[ SALT_SIZE ],char output_key[ PASSWORD_SIZE ],const char * input_key,uint32_t input_key_length,
+				 const lxqt_wallet_kdf_parameters_t * ) ;
+
+static void _kdf_legacy( lxqt_wallet_kdf_parameters_t * ) ;
+
+static uint64_t _kdf_header_size( const lxqt_wallet_kdf_parameters_t * ) ;
+
+static int _calibrated_kdf = 0 ;
+
+static int _get_kdf_from_wallet_header( lxqt_wallet_t,int fd ) ;
+
+static void _create_kdf_header( char buffer[ KDF_HEADER_SIZE ],const lxqt_wallet_kdf_parameters_t * ) ;
 
 static gcry_error_t _create_temp_key( char * output_key,uint32_t output_key_size,const char * input_key,uint32_t input_key_length ) ;
 
-static void _get_iv_from_wallet_header( char iv[ IV_SIZE ],int fd ) ;
+static void _get_iv_from_wallet_header( char iv[ IV_SIZE ],int fd,uint64_t offset ) ;
 
-static void _get_salt_from_wallet_header( char salt[ SALT_SIZE ],int fd ) ;
+static void _get_salt_from_wallet_header( char salt[ SALT_SIZE ],int fd,uint64_t offset ) ;
 
-static void _get_volume_info( char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ],int fd ) ;
+static void _get_volume_info( char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ],int fd,uint64_t offset ) ;
 
 static void _get_random_data( char * buffer,size_t buffer_size ) ;
 
@@ -169,15 +277,49 @@ static int _password_match( const char * buffer ) ;
 
 static int _volume_version( const char * buffer ) ;
 
+static int _is_log_wallet( lxqt_wallet_t,const char * buffer ) ;
+
+static void _create_magic_string_header_1( char magic_string[ MAGIC_STRING_BUFFER_SIZE ],uint16_t version ) ;
+
+static lxqt_wallet_error _wallet_add_key( lxqt_wallet_t,const char * key,uint32_t key_size,
+					  const char * value,uint32_t key_value_length ) ;
+
+static int _wallet_delete_key( lxqt_wallet_t,const char * key,uint32_t key_size ) ;
+
+static void _wallet_clear( lxqt_wallet_t ) ;
+
+static lxqt_wallet_error _log_open( lxqt_wallet_t,const char * buffer ) ;
+
+static int _log_append( lxqt_wallet_t,char type,const char * key,uint32_t key_size,
+			const char * value,uint32_t key_value_length ) ;
+
+static int _log_needs_compaction( lxqt_wallet_t ) ;
+
+static lxqt_wallet_error _log_compact( lxqt_wallet_t ) ;
+
+static void _index_build( lxqt_wallet_t ) ;
+
+static void _index_add( lxqt_wallet_t,uint64_t offset ) ;
+
+static const char * _index_find( lxqt_wallet_t,const char * key,uint32_t key_size ) ;
+
 static void _get_load_information( lxqt_wallet_t,const char * buffer ) ;
 
+static int _key_cache_find( lxqt_wallet_t,const char * password,uint32_t password_length ) ;
+
+static void _key_cache_add( lxqt_wallet_t,const char * password,uint32_t password_length ) ;
+
+static void _key_cache_remove_wallet( const char * wallet_name,const char * application_name ) ;
+
+static uint32_t _key_cache_timeout = 0 ;
+
 static lxqt_wallet_error _lxqt_wallet_open( const char * password,uint32_t password_length,
 					    const char * wallet_name,const char * application_name,char * buffer,
 					    int * ffd,struct lxqt_wallet_struct ** ww,gcry_cipher_hd_t * h ) ;
 
 int lxqt_wallet_library_version( void )
 {
-	return VERSION ;
+	return KDF_VERSION ;
 }
 
 char * _lxqt_wallet_get_wallet_data( lxqt_wallet_t wallet )
@@ -233,7 +375,7 @@ static lxqt_wallet_error _exit_create( lxqt_wallet_error r,gcry_cipher_hd_t hand
 
 static lxqt_wallet_error lxqt_wallet_create_1( gcry_cipher_hd_t * h,const char * password,
                            uint32_t password_length,char * key,char * iv,
-					       char * salt )
+					       char * salt,const lxqt_wallet_kdf_parameters_t * kdf )
 {
 	gcry_error_t r ;
 
@@ -254,7 +396,7 @@ static lxqt_wallet_error lxqt_wallet_create_1( gcry_cipher_hd_t * h,const char *
 
 	_get_random_data( salt,SALT_SIZE ) ;
 
-	r = _create_key( salt,key,password,password_length ) ;
+	r = _create_key( salt,key,password,password_length,kdf ) ;
 
 	if( _failed( r ) ){
 		return lxqt_wallet_failed_to_create_key_hash ;
@@ -286,6 +428,11 @@ lxqt_wallet_error lxqt_wallet_create( const char * password,uint32_t password_le
 	char key[ PASSWORD_SIZE ] ;
 	char salt[ SALT_SIZE ] ;
 	char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' } ;
+	char kdf_buffer[ KDF_HEADER_SIZE ] ;
+
+	lxqt_wallet_kdf_parameters_t kdf ;
+	uint32_t duration ;
+	uint64_t header_size ;
 
 	gcry_cipher_hd_t handle = 0 ;
 	gcry_error_t r ;
@@ -297,12 +444,28 @@ lxqt_wallet_error lxqt_wallet_create( const char * password,uint32_t password_le
 		return _exit_create( lxqt_wallet_wallet_exists,handle ) ;
 	}
 
-	r = lxqt_wallet_create_1( &handle,password,password_length,key,iv,salt ) ;
+	if( _calibrated_kdf ){
+		r = lxqt_wallet_kdf_calibrate( lxqt_wallet_kdf_default,KDF_TARGET_MILLISECONDS,&kdf,&duration ) ;
+
+		if( r != lxqt_wallet_no_error ){
+			return _exit_create( r,handle ) ;
+		}
+	}else{
+		_kdf_legacy( &kdf ) ;
+	}
+
+	header_size = _kdf_header_size( &kdf ) ;
+
+	r = lxqt_wallet_create_1( &handle,password,password_length,key,iv,salt,&kdf ) ;
 
 	if( _failed( r ) ){
 		return _exit_create( lxqt_wallet_gcry_cipher_encrypt_failed,handle ) ;
 	}else{
-		_create_magic_string_header( buffer ) ;
+		_create_kdf_header( kdf_buffer,&kdf ) ;
+
+		_create_magic_string_header_1( buffer,header_size == 0 ? LOG_VERSION : KDF_VERSION ) ;
+
+		_get_random_data( buffer + MAGIC_STRING_BUFFER_SIZE,LOG_ID_SIZE ) ;
 
 		r = gcry_cipher_encrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
 
@@ -316,19 +479,25 @@ lxqt_wallet_error lxqt_wallet_create( const char * password,uint32_t password_le
 			return _exit_create( lxqt_wallet_failed_to_open_file,handle ) ;
 		}else{
 			/*
-			 * first 16 bytes are for PBKDF2 salt
+			 * version 400 wallets start with 32 bytes of key derivation function parameters
+			 */
+			if( header_size != 0 ){
+				_lxqt_wallet_write( fd,kdf_buffer,header_size ) ;
+			}
+			/*
+			 * next 16 bytes are for the key derivation function salt
 			 */
 			_lxqt_wallet_write( fd,salt,SALT_SIZE ) ;
 			/*
-			 * second 16 bytes are for AES IV
+			 * next 16 bytes are for AES IV
 			 */
 			_lxqt_wallet_write( fd,iv,IV_SIZE ) ;
 			/*
-			 * third 16 bytes are for the magic string
+			 * next 16 bytes are for the magic string
 			 */
 			_lxqt_wallet_write( fd,buffer,MAGIC_STRING_BUFFER_SIZE ) ;
 			/*
-			 * fourth 16 bytes block that holds information about data load sizes
+			 * last 16 bytes block that holds the log id
 			 */
 			_lxqt_wallet_write( fd,buffer + MAGIC_STRING_BUFFER_SIZE,BLOCK_SIZE ) ;
 
@@ -356,6 +525,8 @@ lxqt_wallet_error lxqt_wallet_create_encrypted_file( const char * password,uint3
 	int k ;
 	gcry_cipher_hd_t handle = 0 ;
 
+	lxqt_wallet_kdf_parameters_t kdf ;
+
 	struct stat st ;
 
 	if( password == NULL || source == NULL || destination == NULL ){
@@ -366,7 +537,12 @@ lxqt_wallet_error lxqt_wallet_create_encrypted_file( const char * password,uint3
 		return lxqt_wallet_failed_to_open_file ;
 	}
 
-	r = lxqt_wallet_create_1( &handle,password,password_length,key,iv,salt ) ;
+	/*
+	 * Encrypted files keep the format they always had
+	 */
+	_kdf_legacy( &kdf ) ;
+
+	r = lxqt_wallet_create_1( &handle,password,password_length,key,iv,salt,&kdf ) ;
 
 	if( _failed( r ) ){
 		return _exit_create( lxqt_wallet_gcry_cipher_encrypt_failed,handle ) ;
@@ -440,20 +616,45 @@ lxqt_wallet_error lxqt_wallet_change_wallet_password( lxqt_wallet_t wallet,const
 	char key[ PASSWORD_SIZE ] ;
 	gcry_error_t r ;
 
+	lxqt_wallet_kdf_parameters_t kdf ;
+	uint32_t duration ;
+
 	if( wallet == NULL || new_key == NULL ){
 		return lxqt_wallet_invalid_argument ;
 	}else{
-		r = _create_key( wallet->salt,key,new_key,new_key_size ) ;
+		if( _calibrated_kdf ){
+			r = lxqt_wallet_kdf_calibrate( lxqt_wallet_kdf_default,KDF_TARGET_MILLISECONDS,&kdf,&duration ) ;
+			if( r != lxqt_wallet_no_error ){
+				return r ;
+			}
+		}else{
+			/*
+			 * keep whatever the wallet uses,a wallet only moves to a calibrated function on request
+			 */
+			kdf = wallet->kdf ;
+		}
+		r = _create_key( wallet->salt,key,new_key,new_key_size,&kdf ) ;
 		if( _failed( r ) ){
 			return lxqt_wallet_failed_to_create_key_hash ;
 		}else{
 			memcpy( wallet->key,key,PASSWORD_SIZE ) ;
+			memset( key,'\0',PASSWORD_SIZE ) ;
+			wallet->kdf = kdf ;
 			wallet->wallet_modified = 1 ;
+			_key_cache_remove_wallet( wallet->wallet_name,wallet->application_name ) ;
+			_key_cache_add( wallet,new_key,new_key_size ) ;
 			return lxqt_wallet_no_error ;
 		}
 	}
 }
 
+void lxqt_wallet_kdf_parameters( lxqt_wallet_t wallet,lxqt_wallet_kdf_parameters_t * kdf )
+{
+	if( wallet != NULL && kdf != NULL ){
+		*kdf = wallet->kdf ;
+	}
+}
+
 static lxqt_wallet_error _exit_open( lxqt_wallet_error st,
 				     struct lxqt_wallet_struct * w,gcry_cipher_hd_t handle,int fd )
 {
@@ -464,6 +665,10 @@ static lxqt_wallet_error _exit_open( lxqt_wallet_error st,
 		_lxqt_wallet_close( fd ) ;
 	}
 	if( w != NULL ){
+		_wallet_clear( w ) ;
+		if( w->log_fd != -1 ){
+			_lxqt_wallet_close( w->log_fd ) ;
+		}
 		free( w->wallet_name ) ;
 		free( w->application_name ) ;
 		free( w ) ;
@@ -477,6 +682,7 @@ static lxqt_wallet_error _lxqt_wallet_open_0( gcry_cipher_hd_t * h,struct lxqt_w
 	gcry_error_t r ;
 	gcry_cipher_hd_t handle ;
 	char iv[ IV_SIZE ] ;
+	int cached ;
 
 	if( gcry_control( GCRYCTL_INITIALIZATION_FINISHED_P ) == 0 ){
 		gcry_check_version( NULL ) ;
@@ -491,29 +697,59 @@ static lxqt_wallet_error _lxqt_wallet_open_0( gcry_cipher_hd_t * h,struct lxqt_w
 		return lxqt_wallet_gcry_cipher_open_failed ;
 	}
 
-	_get_salt_from_wallet_header( w->salt,fd ) ;
+	if( !_get_kdf_from_wallet_header( w,fd ) ){
+		return lxqt_wallet_incompatible_wallet ;
+	}
 
-	r = _create_key( w->salt,w->key,password,password_length ) ;
+	_get_salt_from_wallet_header( w->salt,fd,w->header_offset ) ;
 
-	if( _failed( r ) ){
-		return lxqt_wallet_failed_to_create_key_hash ;
-	}
+	cached = _key_cache_find( w,password,password_length ) ;
 
-	r = gcry_cipher_setkey( handle,w->key,PASSWORD_SIZE ) ;
+	while( 1 ){
 
-	if( _failed( r ) ){
-		return lxqt_wallet_gcry_cipher_setkey_failed ;
-	}
+		if( !cached ){
 
-	_get_iv_from_wallet_header( iv,fd ) ;
+			r = _create_key( w->salt,w->key,password,password_length,&w->kdf ) ;
 
-	r = gcry_cipher_setiv( handle,iv,IV_SIZE ) ;
+			if( _failed( r ) ){
+				return lxqt_wallet_failed_to_create_key_hash ;
+			}
+		}
 
-	if( _failed( r ) ){
-		return lxqt_wallet_gcry_cipher_setiv_failed ;
-	}else{
-		_get_volume_info( buffer,fd ) ;
-		return gcry_cipher_decrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
+		r = gcry_cipher_setkey( handle,w->key,PASSWORD_SIZE ) ;
+
+		if( _failed( r ) ){
+			return lxqt_wallet_gcry_cipher_setkey_failed ;
+		}
+
+		_get_iv_from_wallet_header( iv,fd,w->header_offset ) ;
+
+		r = gcry_cipher_setiv( handle,iv,IV_SIZE ) ;
+
+		if( _failed( r ) ){
+			return lxqt_wallet_gcry_cipher_setiv_failed ;
+		}
+
+		_get_volume_info( buffer,fd,w->header_offset ) ;
+
+		r = gcry_cipher_decrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
+
+		if( _failed( r ) ){
+			return r ;
+		}else if( _password_match( buffer ) ){
+			if( !cached ){
+				_key_cache_add( w,password,password_length ) ;
+			}
+			return r ;
+		}else if( cached ){
+			/*
+			 * A cached key that does not open the wallet is stale,derive the key again.
+			 */
+			_key_cache_remove_wallet( w->wallet_name,w->application_name ) ;
+			cached = 0 ;
+		}else{
+			return r ;
+		}
 	}
 }
 
@@ -557,6 +793,8 @@ lxqt_wallet_error lxqt_wallet_create_decrypted_file( const char * password,uint3
 
 	memset( w,'\0',sizeof( struct lxqt_wallet_struct ) ) ;
 
+	w->log_fd = -1 ;
+
 	fd_src = open( source,O_RDONLY ) ;
 	if( fd_src == -1 ){
 		return _exit_open( lxqt_wallet_failed_to_open_file,w,handle,-1 ) ;
@@ -651,6 +889,8 @@ static lxqt_wallet_error _lxqt_wallet_open( const char * password,uint32_t passw
 
 	memset( w,'\0',sizeof( struct lxqt_wallet_struct ) ) ;
 
+	w->log_fd = -1 ;
+
 	len = strlen( wallet_name ) ;
 
 	w->wallet_name = malloc( sizeof( char ) * ( len + 1 ) ) ;
@@ -711,7 +951,18 @@ lxqt_wallet_error lxqt_wallet_open( lxqt_wallet_t * wallet,const char * password
 
 	if( _password_match( buffer ) ){
 
-		if( _wallet_is_compatible( buffer ) ){
+		if( _is_log_wallet( w,buffer ) ){
+
+			r = _log_open( w,buffer ) ;
+
+			if( r == lxqt_wallet_no_error ){
+				*wallet = w ;
+				return _exit_open( lxqt_wallet_no_error,NULL,handle,fd ) ;
+			}else{
+				return _exit_open( r,w,handle,fd ) ;
+			}
+
+		}else if( _wallet_is_compatible( buffer ) && w->header_offset == 0 ){
 
 			fstat( fd,&st ) ;
 
@@ -726,6 +977,12 @@ lxqt_wallet_error lxqt_wallet_open( lxqt_wallet_t * wallet,const char * password
 			}else{
 				_get_load_information( w,buffer ) ;
 
+				/*
+				 * Older builds did not write the load size and left whatever was on the stack
+				 * in its place,the load is walked up to the entry count instead.
+				 */
+				w->wallet_data_size = len ;
+
 				e = malloc( len ) ;
 
 				if( e != NULL ){
@@ -736,6 +993,8 @@ lxqt_wallet_error lxqt_wallet_open( lxqt_wallet_t * wallet,const char * password
 					r = gcry_cipher_decrypt( handle,e,len,NULL,0 ) ;
 					if( _passed( r ) ){
 						w->wallet_data = e ;
+						w->wallet_data_capacity = len ;
+						_index_build( w ) ;
 						*wallet = w ;
 						return _exit_open( lxqt_wallet_no_error,NULL,handle,fd ) ;
 					}else{
@@ -789,39 +1048,27 @@ int lxqt_wallet_volume_version( const char * wallet_name,const char * applicatio
 int lxqt_wallet_read_key_value( lxqt_wallet_t wallet,const char * key,uint32_t key_size,lxqt_wallet_key_values_t * key_value )
 {
 	const char * e ;
-	const char * z ;
-
-	uint64_t k = 0 ;
-	uint64_t i = 0 ;
 
 	uint32_t key_len ;
 	uint32_t key_value_len ;
 
 	if( key == NULL || wallet == NULL || key_value == NULL ){
-		;
+		return 0 ;
 	}else{
-		e = wallet->wallet_data ;
-		z = e ;
-		k = wallet->wallet_data_size ;
-
-		while( i < k ){
+		e = _index_find( wallet,key,key_size ) ;
 
+		if( e == NULL ){
+			return 0 ;
+		}else{
 			_get_header_components( &key_len,&key_value_len,e ) ;
 
-			if( key_len == key_size && memcmp( key,e + NODE_HEADER_SIZE,key_size ) == 0 ){
-				key_value->key            = e + NODE_HEADER_SIZE ;
-				key_value->key_size       = key_len ;
-				key_value->key_value      = e + NODE_HEADER_SIZE + key_len ;
-				key_value->key_value_size = key_value_len ;
-				return 1 ;
-			}else{
-				i = i + NODE_HEADER_SIZE + key_len + key_value_len ;
-				e = z + i ;
-			}
+			key_value->key            = e + NODE_HEADER_SIZE ;
+			key_value->key_size       = key_len ;
+			key_value->key_value      = e + NODE_HEADER_SIZE + key_len ;
+			key_value->key_value_size = key_value_len ;
+			return 1 ;
 		}
 	}
-
-	return 0 ;
 }
 
 int lxqt_wallet_has_key( lxqt_wallet_t wallet,const char * key,uint32_t key_size )
@@ -871,10 +1118,7 @@ int lxqt_wallet_has_value( lxqt_wallet_t wallet,const char * value,uint32_t valu
 lxqt_wallet_error lxqt_wallet_add_key( lxqt_wallet_t wallet,const char * key,uint32_t key_size,
                        const char * value,uint32_t key_value_length )
 {
-	char * e ;
-	char * f ;
-
-	uint64_t len ;
+	lxqt_wallet_error r ;
 
 	if( key == NULL || wallet == NULL ){
 		return lxqt_wallet_invalid_argument ;
@@ -887,31 +1131,82 @@ lxqt_wallet_error lxqt_wallet_add_key( lxqt_wallet_t wallet,const char * key,uin
 				value = "" ;
 			}
 
-			len = NODE_HEADER_SIZE + key_size + key_value_length ;
-			f = realloc( wallet->wallet_data,wallet->wallet_data_size + len ) ;
+			if( _log_append( wallet,LOG_RECORD_ADD,key,key_size,value,key_value_length ) ){
+				return _wallet_add_key( wallet,key,key_size,value,key_value_length ) ;
+			}else{
+				/*
+				 * The wallet will be rewritten when it is closed
+				 */
+				r = _wallet_add_key( wallet,key,key_size,value,key_value_length ) ;
+
+				if( r == lxqt_wallet_no_error ){
+					wallet->wallet_modified = 1 ;
+				}
 
-			if( f != NULL ){
-#ifndef _WIN32
-				mlock( f,wallet->wallet_data_size + len ) ;
-#endif
-				e = f + wallet->wallet_data_size ;
+				return r ;
+			}
+		}
+	}
+}
 
-				memcpy( e,&key_size,sizeof( uint32_t ) ) ;
-				memcpy( e + sizeof( uint32_t ),&key_value_length,sizeof( uint32_t ) ) ;
-				memcpy( e + NODE_HEADER_SIZE,key,key_size ) ;
-				memcpy( e + NODE_HEADER_SIZE + key_size,value,key_value_length ) ;
+static lxqt_wallet_error _wallet_add_key( lxqt_wallet_t wallet,const char * key,uint32_t key_size,
+					  const char * value,uint32_t key_value_length )
+{
+	char * e ;
+	char * f ;
 
-				wallet->wallet_data_size += len ;
-				wallet->wallet_modified = 1 ;
-				wallet->wallet_data = f ;
-				wallet->wallet_data_entry_count++ ;
+	uint64_t len ;
+	uint64_t capacity ;
 
-				return lxqt_wallet_no_error ;
-			}else{
-				return lxqt_wallet_failed_to_allocate_memory ;
-			}
+	len = NODE_HEADER_SIZE + key_size + key_value_length ;
+
+	if( wallet->wallet_data_size + len > wallet->wallet_data_capacity ){
+		/*
+		 * realloc() would leave copies of the data in freed memory
+		 */
+		capacity = wallet->wallet_data_capacity * 2 ;
+
+		if( capacity < wallet->wallet_data_size + len ){
+			capacity = wallet->wallet_data_size + len ;
+		}
+		if( capacity < FILE_BLOCK_SIZE ){
+			capacity = FILE_BLOCK_SIZE ;
+		}
+
+		f = calloc( 1,capacity ) ;
+
+		if( f == NULL ){
+			return lxqt_wallet_failed_to_allocate_memory ;
 		}
+#ifndef _WIN32
+		mlock( f,capacity ) ;
+#endif
+		if( wallet->wallet_data != NULL ){
+			memcpy( f,wallet->wallet_data,wallet->wallet_data_size ) ;
+			memset( wallet->wallet_data,'\0',wallet->wallet_data_capacity ) ;
+#ifndef _WIN32
+			munlock( wallet->wallet_data,wallet->wallet_data_capacity ) ;
+#endif
+			free( wallet->wallet_data ) ;
+		}
+
+		wallet->wallet_data = f ;
+		wallet->wallet_data_capacity = capacity ;
 	}
+
+	e = wallet->wallet_data + wallet->wallet_data_size ;
+
+	memcpy( e,&key_size,sizeof( uint32_t ) ) ;
+	memcpy( e + sizeof( uint32_t ),&key_value_length,sizeof( uint32_t ) ) ;
+	memcpy( e + NODE_HEADER_SIZE,key,key_size ) ;
+	memcpy( e + NODE_HEADER_SIZE + key_size,value,key_value_length ) ;
+
+	wallet->wallet_data_size += len ;
+	wallet->wallet_data_entry_count++ ;
+
+	_index_add( wallet,wallet->wallet_data_size - len ) ;
+
+	return lxqt_wallet_no_error ;
 }
 
 int lxqt_wallet_iter_read_value( lxqt_wallet_t wallet,lxqt_wallet_iterator_t * iter )
@@ -976,59 +1271,88 @@ int lxqt_wallet_read_value_at( lxqt_wallet_t wallet,uint64_t pos,lxqt_wallet_key
 }
 
 lxqt_wallet_error lxqt_wallet_delete_key( lxqt_wallet_t wallet,const char * key,uint32_t key_size )
+{
+	if( key == NULL || wallet == NULL ){
+		return lxqt_wallet_invalid_argument ;
+	}
+
+	if( _index_find( wallet,key,key_size ) == NULL ){
+		return lxqt_wallet_no_error ;
+	}
+
+	if( _log_append( wallet,LOG_RECORD_DELETE,key,key_size,"",0 ) ){
+		_wallet_delete_key( wallet,key,key_size ) ;
+	}else{
+		if( _wallet_delete_key( wallet,key,key_size ) ){
+			wallet->wallet_modified = 1 ;
+		}
+	}
+
+	return lxqt_wallet_no_error ;
+}
+
+static int _wallet_delete_key( lxqt_wallet_t wallet,const char * key,uint32_t key_size )
 {
 	char * e ;
-	char * z ;
 
-	uint64_t k = 0 ;
-	uint64_t i = 0 ;
+	uint64_t i ;
 
 	uint32_t key_len ;
 	uint32_t key_value_len ;
 
 	uint64_t block_size ;
 
-	if( key == NULL || wallet == NULL ){
-		return lxqt_wallet_invalid_argument ;
-	}else{
-		e = wallet->wallet_data ;
-		z = e ;
-		k = wallet->wallet_data_size ;
+	e = ( char * )_index_find( wallet,key,key_size ) ;
 
-		while( i < k ){
+	if( e == NULL ){
+		return 0 ;
+	}
 
-			_get_header_components( &key_len,&key_value_len,e ) ;
+	if( wallet->wallet_data_entry_count == 1 ){
+		_wallet_clear( wallet ) ;
+		return 1 ;
+	}
 
-			if( key_len == key_size && memcmp( key,e + NODE_HEADER_SIZE,key_size ) == 0 ){
+	_get_header_components( &key_len,&key_value_len,e ) ;
 
-				if( wallet->wallet_data_entry_count == 1 ){
-					memset( wallet->wallet_data,'\0',wallet->wallet_data_size ) ;
-					free( wallet->wallet_data ) ;
-					wallet->wallet_data_size = 0 ;
-					wallet->wallet_modified = 1 ;
-					wallet->wallet_data = NULL ;
-					wallet->wallet_data_entry_count = 0 ;
-				}else{
-					block_size = NODE_HEADER_SIZE + key_len + key_value_len ;
+	i = e - wallet->wallet_data ;
 
-					memmove( e,e + block_size,wallet->wallet_data_size - ( i + block_size ) ) ;
+	block_size = NODE_HEADER_SIZE + key_len + key_value_len ;
 
-					memset( z + wallet->wallet_data_size - block_size,'\0',block_size ) ;
+	memmove( e,e + block_size,wallet->wallet_data_size - ( i + block_size ) ) ;
 
-					wallet->wallet_data_size -= block_size ;
-					wallet->wallet_modified = 1 ;
-					wallet->wallet_data_entry_count-- ;
-				}
+	memset( wallet->wallet_data + wallet->wallet_data_size - block_size,'\0',block_size ) ;
 
-				break ;
-			}else{
-				i = i + NODE_HEADER_SIZE + key_len + key_value_len ;
-				e = z + i ;
-			}
-		}
+	wallet->wallet_data_size -= block_size ;
+	wallet->wallet_data_entry_count-- ;
+
+	/*
+	 * Every node after the deleted one has moved,the memmove above already
+	 * touched them all and rebuilding the index costs about the same.
+	 */
+	_index_build( wallet ) ;
+
+	return 1 ;
+}
+
+static void _wallet_clear( lxqt_wallet_t wallet )
+{
+	if( wallet->wallet_data != NULL ){
+		memset( wallet->wallet_data,'\0',wallet->wallet_data_capacity ) ;
+#ifndef _WIN32
+		munlock( wallet->wallet_data,wallet->wallet_data_capacity ) ;
+#endif
+		free( wallet->wallet_data ) ;
 	}
 
-	return lxqt_wallet_no_error ;
+	free( wallet->index ) ;
+
+	wallet->wallet_data = NULL ;
+	wallet->wallet_data_size = 0 ;
+	wallet->wallet_data_capacity = 0 ;
+	wallet->wallet_data_entry_count = 0 ;
+	wallet->index = NULL ;
+	wallet->index_size = 0 ;
 }
 
 lxqt_wallet_error lxqt_wallet_delete_wallet( const char * wallet_name,const char * application_name )
@@ -1036,25 +1360,24 @@ lxqt_wallet_error lxqt_wallet_delete_wallet( const char * wallet_name,const char
 	char path[ PATH_MAX ] ;
 	_wallet_full_path( path,PATH_MAX,wallet_name,application_name ) ;
 	unlink( path ) ;
+	_key_cache_remove_wallet( wallet_name,application_name ) ;
 	return lxqt_wallet_no_error ;
 }
 
-static lxqt_wallet_error lxqt_wallet_close_exit( lxqt_wallet_error err,lxqt_wallet_t * w,gcry_cipher_hd_t handle )
+static lxqt_wallet_error lxqt_wallet_close_exit( lxqt_wallet_error err,lxqt_wallet_t * w )
 {
 	lxqt_wallet_t wallet = *w ;
 	*w = NULL ;
 
-	if( handle != 0 ){
-	gcry_cipher_close( handle ) ;
+	if( wallet->log_fd != -1 ){
+		_lxqt_wallet_close( wallet->log_fd ) ;
 	}
 
-	if( wallet->wallet_data_size > 0 ){
-		memset( wallet->wallet_data,'\0',wallet->wallet_data_size ) ;
-#ifndef _WIN32
-		munlock( wallet->wallet_data,wallet->wallet_data_size ) ;
-#endif
-		free( wallet->wallet_data ) ;
-	}
+	_wallet_clear( wallet ) ;
+
+	memset( wallet->key,'\0',PASSWORD_SIZE ) ;
+	memset( wallet->log_key,'\0',PASSWORD_SIZE ) ;
+
 	free( wallet->wallet_name ) ;
 	free( wallet->application_name ) ;
 	free( wallet ) ;
@@ -1063,110 +1386,20 @@ static lxqt_wallet_error lxqt_wallet_close_exit( lxqt_wallet_error err,lxqt_wall
 
 lxqt_wallet_error lxqt_wallet_close( lxqt_wallet_t * w )
 {
-	gcry_cipher_hd_t handle ;
-	int fd ;
-	char iv[ IV_SIZE ] ;
-	char path[ PATH_MAX ] ;
-	char path_1[ PATH_MAX ] ;
-	char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] ;
-
 	lxqt_wallet_t wallet ;
 
-	uint64_t k ;
-	char * e ;
-
-	gcry_error_t r ;
-
 	if( w == NULL || *w == NULL ){
 		return lxqt_wallet_invalid_argument ;
 	}
 
 	wallet = *w ;
 
-	if( wallet->wallet_modified == 0 ){
-		return lxqt_wallet_close_exit( lxqt_wallet_no_error,w,0 ) ;
+	if( wallet->wallet_modified || _log_needs_compaction( wallet ) ){
+		return lxqt_wallet_close_exit( _log_compact( wallet ),w ) ;
+	}else{
+		return lxqt_wallet_close_exit( lxqt_wallet_no_error,w ) ;
 	}
-
-	gcry_control( GCRYCTL_INITIALIZATION_FINISHED,0 ) ;
-
-	r = gcry_cipher_open( &handle,GCRY_CIPHER_AES256,GCRY_CIPHER_MODE_CBC,0 ) ;
-
-	if( _failed( r ) ){
-		return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_open_failed,w,0 ) ;
-	}
-
-	r = gcry_cipher_setkey( handle,wallet->key,PASSWORD_SIZE ) ;
-
-	if( _failed( r ) ){
-		return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_setkey_failed,w,handle ) ;
-	}
-
-	_get_random_data( iv,IV_SIZE ) ;
-
-	r = gcry_cipher_setiv( handle,iv,IV_SIZE ) ;
-
-	if( _failed( r ) ){
-		return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_setiv_failed,w,handle ) ;
-	}
-
-	_create_magic_string_header( buffer ) ;
-
-	memcpy( buffer + MAGIC_STRING_BUFFER_SIZE + sizeof( uint64_t ),&wallet->wallet_data_entry_count,sizeof( uint64_t ) ) ;
-
-	r = gcry_cipher_encrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
-
-	if( _failed( r ) ){
-		return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_encrypt_failed,w,handle ) ;
-	}
-
-	_wallet_full_path( path,PATH_MAX,wallet->wallet_name,wallet->application_name ) ;
-	snprintf( path_1,PATH_MAX,"%s.tmp",path ) ;
-
-	k = wallet->wallet_data_size ;
-
-	if( k == 0 ){
-		fd = open( path_1,O_WRONLY|O_CREAT,0600 ) ;
-		if( fd == -1 ){
-			return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_open_failed,w,handle ) ;
-		}else{
-			_lxqt_wallet_write( fd,wallet->salt,SALT_SIZE ) ;
-			_lxqt_wallet_write( fd,iv,IV_SIZE ) ;
-			_lxqt_wallet_write( fd,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ) ;
-			_lxqt_wallet_close( fd ) ;
-			rename( path_1,path ) ;
-			return lxqt_wallet_close_exit( lxqt_wallet_no_error,w,handle ) ;
-		}
-	}else{
-		while( k % 32 != 0 ){
-			k++ ;
-		}
-
-		e = realloc( wallet->wallet_data,k ) ;
-
-		if( e != NULL ){
-			wallet->wallet_data = e ;
-			r = gcry_cipher_encrypt( handle,wallet->wallet_data,k,NULL,0 ) ;
-			if( _failed( r ) ){
-				return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_encrypt_failed,w,handle ) ;
-			}else{
-				fd = open( path_1,O_WRONLY|O_CREAT,0600 ) ;
-				if( fd == -1 ){
-					return lxqt_wallet_close_exit( lxqt_wallet_gcry_cipher_open_failed,w,handle ) ;
-				}else{
-					_lxqt_wallet_write( fd,wallet->salt,SALT_SIZE ) ;
-					_lxqt_wallet_write( fd,iv,IV_SIZE ) ;
-					_lxqt_wallet_write( fd,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ) ;
-					_lxqt_wallet_write( fd,wallet->wallet_data,k ) ;
-					_lxqt_wallet_close( fd ) ;
-					rename( path_1,path ) ;
-					return lxqt_wallet_close_exit( lxqt_wallet_no_error,w,handle ) ;
-				}
-			}
-		}else{
-			return lxqt_wallet_close_exit( lxqt_wallet_failed_to_allocate_memory,w,handle ) ;
-		}
-	}
-}
+}
 
 char ** lxqt_wallet_list( const char * application_name,int * size )
 {
@@ -1305,87 +1538,1438 @@ static gcry_error_t _create_temp_key( char * output_key,uint32_t output_key_size
 	return r ;
 }
 
+static gcry_error_t _argon2id( const char * input_key,uint32_t input_key_length,const char salt[ SALT_SIZE ],
+			       const lxqt_wallet_kdf_parameters_t * kdf,char output_key[ PASSWORD_SIZE ] )
+{
+#if GCRYPT_VERSION_NUMBER >= 0x010a00
+	gcry_kdf_hd_t hd ;
+	gcry_error_t r ;
+
+	unsigned long params[ 4 ] = { PASSWORD_SIZE,kdf->iterations,kdf->memory,kdf->parallelism } ;
+
+	r = gcry_kdf_open( &hd,GCRY_KDF_ARGON2,GCRY_KDF_ARGON2ID,params,4,
+			   input_key,input_key_length,salt,SALT_SIZE,NULL,0,NULL,0 ) ;
+
+	if( _passed( r ) ){
+		r = gcry_kdf_compute( hd,NULL ) ;
+		if( _passed( r ) ){
+			r = gcry_kdf_final( hd,PASSWORD_SIZE,output_key ) ;
+		}
+		gcry_kdf_close( hd ) ;
+	}
+
+	return r ;
+#else
+	if( input_key && input_key_length && salt && kdf && output_key ){}
+	return gcry_error( GPG_ERR_NOT_SUPPORTED ) ;
+#endif
+}
+
 /*
  * gcry_kdf_derive() doesnt seem to work with empty passphrases,to work around it,we create a temporary passphrases
  * based on provided passphrase and then feed the temporary key to gcry_kdf_derive()
  */
 static gcry_error_t _create_key( const char salt[ SALT_SIZE ],
-                 char output_key[ PASSWORD_SIZE ],const char * input_key,uint32_t input_key_length )
+                 char output_key[ PASSWORD_SIZE ],const char * input_key,uint32_t input_key_length,
+				 const lxqt_wallet_kdf_parameters_t * kdf )
 {
 	char temp_key[ PASSWORD_SIZE ] ;
 	gcry_error_t r = _create_temp_key( temp_key,PASSWORD_SIZE,input_key,input_key_length ) ;
 
 	if( _passed( r ) ){
-		return gcry_kdf_derive( temp_key,PASSWORD_SIZE,GCRY_KDF_PBKDF2,GCRY_MD_SHA256,
-				salt,SALT_SIZE,PBKDF2_ITERATIONS,PASSWORD_SIZE,output_key ) ;
+		if( kdf->kdf == lxqt_wallet_kdf_argon2id ){
+			r = _argon2id( temp_key,PASSWORD_SIZE,salt,kdf,output_key ) ;
+		}else{
+			r = gcry_kdf_derive( temp_key,PASSWORD_SIZE,GCRY_KDF_PBKDF2,GCRY_MD_SHA256,
+					salt,SALT_SIZE,kdf->iterations,PASSWORD_SIZE,output_key ) ;
+		}
+		memset( temp_key,'\0',PASSWORD_SIZE ) ;
+	}
+
+	return r ;
+}
+
+static void _kdf_legacy( lxqt_wallet_kdf_parameters_t * kdf )
+{
+	kdf->kdf         = lxqt_wallet_kdf_pbkdf2 ;
+	kdf->iterations  = PBKDF2_ITERATIONS ;
+	kdf->memory      = 0 ;
+	kdf->parallelism = 0 ;
+}
+
+/*
+ * Wallets whose key is derived the way older builds derive it keep the version 300 layout that
+ * has no key derivation function header.
+ */
+static uint64_t _kdf_header_size( const lxqt_wallet_kdf_parameters_t * kdf )
+{
+	if( kdf->kdf == lxqt_wallet_kdf_pbkdf2 && kdf->iterations == PBKDF2_ITERATIONS ){
+		return 0 ;
 	}else{
-		return r ;
+		return KDF_HEADER_SIZE ;
 	}
 }
 
-static void _get_iv_from_wallet_header( char iv[ IV_SIZE ],int fd )
+void lxqt_wallet_calibrated_kdf( int enable )
 {
-	lseek( fd,SALT_SIZE,SEEK_SET ) ;
-	_lxqt_wallet_read( fd,iv,IV_SIZE ) ;
+	_calibrated_kdf = enable ;
 }
 
-static void _get_salt_from_wallet_header( char salt[ SALT_SIZE ],int fd )
+static int _kdf_is_valid( const lxqt_wallet_kdf_parameters_t * kdf )
 {
-	lseek( fd,0,SEEK_SET ) ;
-	_lxqt_wallet_read( fd,salt,SALT_SIZE ) ;
+	if( kdf->kdf == lxqt_wallet_kdf_pbkdf2 ){
+		return kdf->iterations > 0 ;
+	}else if( kdf->kdf == lxqt_wallet_kdf_argon2id ){
+		/*
+		 * Do not let a damaged header make us allocate all memory there is
+		 */
+		return kdf->iterations > 0 && kdf->iterations <= ARGON2ID_MAX_ITERATIONS &&
+			kdf->memory >= ARGON2ID_MIN_MEMORY && kdf->memory <= ARGON2ID_MAX_MEMORY &&
+			kdf->parallelism > 0 && kdf->parallelism <= ARGON2ID_MAX_PARALLELISM ;
+	}else{
+		return 0 ;
+	}
 }
 
-static void _get_volume_info( char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ],int fd )
+static void _create_kdf_header( char buffer[ KDF_HEADER_SIZE ],const lxqt_wallet_kdf_parameters_t * kdf )
 {
-	lseek( fd,IV_SIZE + SALT_SIZE,SEEK_SET ) ;
-	_lxqt_wallet_read( fd,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ) ;
+	uint32_t e[ 4 ] = { ( uint32_t )kdf->kdf,kdf->iterations,kdf->memory,kdf->parallelism } ;
+
+	memcpy( buffer,KDF_MAGIC_STRING,KDF_MAGIC_STRING_SIZE ) ;
+	memcpy( buffer + KDF_MAGIC_STRING_SIZE,e,sizeof( e ) ) ;
 }
 
-static void _get_load_information( lxqt_wallet_t w,const char * buffer )
+/*
+ * Sets the wallet's key derivation function parameters and where the rest of the header starts
+ */
+static int _get_kdf_from_wallet_header( lxqt_wallet_t w,int fd )
 {
-	buffer = buffer + MAGIC_STRING_BUFFER_SIZE ;
-	memcpy( &w->wallet_data_size,buffer,sizeof( uint64_t ) ) ;
-	memcpy( &w->wallet_data_entry_count,buffer + sizeof( uint64_t ),sizeof( uint64_t ) ) ;
+	char buffer[ KDF_HEADER_SIZE ] ;
+	uint32_t e[ 4 ] ;
+
+	lseek( fd,0,SEEK_SET ) ;
+
+	if( read( fd,buffer,KDF_HEADER_SIZE ) == KDF_HEADER_SIZE &&
+			memcmp( buffer,KDF_MAGIC_STRING,KDF_MAGIC_STRING_SIZE ) == 0 ){
+
+		memcpy( e,buffer + KDF_MAGIC_STRING_SIZE,sizeof( e ) ) ;
+
+		w->kdf.kdf         = ( lxqt_wallet_kdf )e[ 0 ] ;
+		w->kdf.iterations  = e[ 1 ] ;
+		w->kdf.memory      = e[ 2 ] ;
+		w->kdf.parallelism = e[ 3 ] ;
+
+		w->header_offset = KDF_HEADER_SIZE ;
+
+		return _kdf_is_valid( &w->kdf ) ;
+	}else{
+		_kdf_legacy( &w->kdf ) ;
+
+		w->header_offset = 0 ;
+
+		return 1 ;
+	}
 }
 
-static void _get_random_data( char * buffer,size_t buffer_size )
+static uint64_t _kdf_milliseconds( const lxqt_wallet_kdf_parameters_t * kdf )
 {
-	int fd ;
-	fd = open( "/dev/urandom",O_RDONLY ) ;
-	if( fd != -1 ){
-		_lxqt_wallet_read( fd,buffer,buffer_size ) ;
-		_lxqt_wallet_close( fd ) ;
+	char salt[ SALT_SIZE ] = { '\0' } ;
+	char key[ PASSWORD_SIZE ] ;
+
+	struct timespec start ;
+	struct timespec end ;
+
+	gcry_error_t r ;
+
+	clock_gettime( CLOCK_MONOTONIC,&start ) ;
+
+	r = _create_key( salt,key,KDF_MAGIC_STRING,KDF_MAGIC_STRING_SIZE,kdf ) ;
+
+	clock_gettime( CLOCK_MONOTONIC,&end ) ;
+
+	if( _failed( r ) ){
+		return UINT64_MAX ;
 	}else{
-		gcry_create_nonce( buffer,buffer_size ) ;
+		return ( end.tv_sec - start.tv_sec ) * 1000 + ( end.tv_nsec - start.tv_nsec ) / 1000000 ;
 	}
 }
 
-static int _password_match( const char * buffer )
+lxqt_wallet_error lxqt_wallet_kdf_calibrate( lxqt_wallet_kdf kdf,uint32_t milliseconds,
+					     lxqt_wallet_kdf_parameters_t * parameters,uint32_t * duration )
 {
-	return memcmp( buffer,MAGIC_STRING,MAGIC_STRING_SIZE ) == 0 ;
+	uint64_t t ;
+	uint64_t n ;
+
+	if( parameters == NULL || duration == NULL || milliseconds == 0 ){
+		return lxqt_wallet_invalid_argument ;
+	}
+
+	if( gcry_control( GCRYCTL_INITIALIZATION_FINISHED_P ) == 0 ){
+		gcry_check_version( NULL ) ;
+		gcry_control( GCRYCTL_INITIALIZATION_FINISHED,0 ) ;
+	}
+
+	if( kdf == lxqt_wallet_kdf_default ){
+#if GCRYPT_VERSION_NUMBER >= 0x010a00
+		kdf = lxqt_wallet_kdf_argon2id ;
+#else
+		kdf = lxqt_wallet_kdf_pbkdf2 ;
+#endif
+	}
+
+	if( kdf == lxqt_wallet_kdf_argon2id ){
+
+		parameters->kdf         = lxqt_wallet_kdf_argon2id ;
+		parameters->iterations  = 1 ;
+		parameters->memory      = ARGON2ID_MEMORY ;
+		parameters->parallelism = 1 ;
+
+		t = _kdf_milliseconds( parameters ) ;
+
+		/*
+		 * Slow machines get less memory,fast ones get more passes over it
+		 */
+		while( t != UINT64_MAX && t > milliseconds && parameters->memory > ARGON2ID_MIN_MEMORY ){
+			parameters->memory /= 2 ;
+			t = _kdf_milliseconds( parameters ) ;
+		}
+
+		if( t == UINT64_MAX ){
+			return lxqt_wallet_failed_to_create_key_hash ;
+		}
+
+		n = milliseconds / ( t > 0 ? t : 1 ) ;
+
+		if( n > 1 ){
+			parameters->iterations = n < ARGON2ID_MAX_ITERATIONS ? ( uint32_t )n : ARGON2ID_MAX_ITERATIONS ;
+			t = _kdf_milliseconds( parameters ) ;
+		}
+
+	}else if( kdf == lxqt_wallet_kdf_pbkdf2 ){
+
+		parameters->kdf         = lxqt_wallet_kdf_pbkdf2 ;
+		parameters->iterations  = PBKDF2_ITERATIONS ;
+		parameters->memory      = 0 ;
+		parameters->parallelism = 0 ;
+
+		/*
+		 * Time enough iterations for the clock to be meaningful before extrapolating
+		 */
+		while( ( t = _kdf_milliseconds( parameters ) ) < 20 && parameters->iterations < UINT32_MAX / 2 ){
+			parameters->iterations *= 2 ;
+		}
+
+		if( t == UINT64_MAX ){
+			return lxqt_wallet_failed_to_create_key_hash ;
+		}
+
+		n = ( uint64_t )parameters->iterations * milliseconds / ( t > 0 ? t : 1 ) ;
+
+		if( n < PBKDF2_ITERATIONS ){
+			n = PBKDF2_ITERATIONS ;
+		}else if( n > UINT32_MAX ){
+			n = UINT32_MAX ;
+		}
+
+		parameters->iterations = ( uint32_t )n ;
+
+		t = _kdf_milliseconds( parameters ) ;
+	}else{
+		return lxqt_wallet_invalid_argument ;
+	}
+
+	if( t == UINT64_MAX ){
+		return lxqt_wallet_failed_to_create_key_hash ;
+	}else{
+		*duration = ( uint32_t )t ;
+		return lxqt_wallet_no_error ;
+	}
 }
 
-static void _create_magic_string_header( char magic_string[ MAGIC_STRING_BUFFER_SIZE ] )
+#ifdef __linux__
+
+/*
+ * Derived keys are cached as "user" keys in the session keyring with a description of
+ * "lxqt_wallet:<application name>:<wallet name>:<salt in hex>".
+ *
+ * The payload is a 32 bytes verifier followed by the 32 bytes key.The verifier keeps a cached key
+ * from opening a wallet with a wrong password or with parameters it was not derived with.
+ *
+ * Anybody who can read the payload can test passwords against the verifier and it is therefore
+ * derived with PBKDF2 and as many iterations as the key of a wallet with default parameters,with a
+ * salt bound to the wallet's salt and key derivation function parameters.Guessing against it costs
+ * as much as guessing against a wallet file with default parameters.It is cheaper than guessing
+ * against a wallet with calibrated or Argon2id parameters,that is the price of skipping the key
+ * derivation on a cache hit and it only matters to somebody who can already read the cached key.
+ */
+static int _key_cache_description( char * buffer,size_t size,const char * application_name,
+				   const char * wallet_name,const char salt[ SALT_SIZE ] )
 {
-	uint16_t version = VERSION ;
-	/*
-	 * write 11 bytes of magic string
-	 */
-	memcpy( magic_string,MAGIC_STRING,MAGIC_STRING_SIZE ) ;
-	/*
-	 * write version information in the remaining 5 bytes of the 16 byte buffer
-	 */
-	memcpy( magic_string + MAGIC_STRING_SIZE,&version,sizeof( uint16_t ) ) ;
+	const unsigned char * e = ( const unsigned char * )salt ;
+	size_t i ;
+	int n ;
+
+	n = snprintf( buffer,size,"%s:%s:%s:",KEY_CACHE_PREFIX,application_name,wallet_name ) ;
+
+	if( salt != NULL ){
+		for( i = 0 ; i < SALT_SIZE && n > 0 && ( size_t )n + 2 < size ; i++ ){
+			n += snprintf( buffer + n,size - n,"%02x",e[ i ] ) ;
+		}
+	}
+
+	return n > 0 && ( size_t )n < size ;
 }
 
-static int _wallet_is_compatible( const char * buffer )
+static gcry_error_t _key_cache_verifier( lxqt_wallet_t w,const char * password,uint32_t password_length,
+					 char verifier[ PASSWORD_SIZE ] )
 {
-	uint16_t version ;
-	memcpy( &version,buffer + MAGIC_STRING_SIZE,sizeof( uint16_t ) ) ;
+	gcry_md_hd_t md ;
+	unsigned char * digest ;
+	char kdf[ KDF_HEADER_SIZE ] ;
+	char salt[ PASSWORD_SIZE ] ;
+	char temp_key[ PASSWORD_SIZE ] ;
+
+	gcry_error_t r = gcry_md_open( &md,GCRY_MD_SHA256,GCRY_MD_FLAG_SECURE ) ;
+
+	if( _passed( r ) ){
+		_create_kdf_header( kdf,&w->kdf ) ;
+		gcry_md_write( md,KEY_CACHE_LABEL,strlen( KEY_CACHE_LABEL ) ) ;
+		gcry_md_write( md,kdf,KDF_HEADER_SIZE ) ;
+		gcry_md_write( md,w->salt,SALT_SIZE ) ;
+		digest = gcry_md_read( md,0 ) ;
+		if( digest == NULL ){
+			r = !GPG_ERR_NO_ERROR ;
+		}else{
+			memcpy( salt,digest,PASSWORD_SIZE ) ;
+		}
+		gcry_md_close( md ) ;
+	}
+
+	if( _passed( r ) ){
+		r = _create_temp_key( temp_key,PASSWORD_SIZE,password,password_length ) ;
+	}
+
+	if( _passed( r ) ){
+		r = gcry_kdf_derive( temp_key,PASSWORD_SIZE,GCRY_KDF_PBKDF2,GCRY_MD_SHA256,
+				     salt,PASSWORD_SIZE,KEY_CACHE_ITERATIONS,PASSWORD_SIZE,verifier ) ;
+	}
+
+	memset( temp_key,'\0',PASSWORD_SIZE ) ;
+
+	return r ;
+}
+
+/*
+ * Compares without returning early so that how long it takes does not tell how much matched.
+ */
+static int _key_cache_verifier_match( const char * a,const char * b )
+{
+	unsigned char e = 0 ;
+	int i ;
+
+	for( i = 0 ; i < PASSWORD_SIZE ; i++ ){
+		e |= ( unsigned char )( a[ i ] ^ b[ i ] ) ;
+	}
+
+	return e == 0 ;
+}
+
+/*
+ * Set "w->key" from the cache and return 1 if the cache has a key for the wallet and the password,
+ * return 0 otherwise.
+ */
+static int _key_cache_find( lxqt_wallet_t w,const char * password,uint32_t password_length )
+{
+	char description[ KEY_CACHE_DESCRIPTION_SIZE ] ;
+	char payload[ 2 * PASSWORD_SIZE ] ;
+	char verifier[ PASSWORD_SIZE ] ;
+	long id ;
+	long n ;
+	int st = 0 ;
+
+	if( _key_cache_timeout == 0 ){
+		return 0 ;
+	}
+	if( !_key_cache_description( description,sizeof( description ),w->application_name,w->wallet_name,w->salt ) ){
+		return 0 ;
+	}
+
+	id = syscall( __NR_keyctl,KEYCTL_SEARCH,KEY_SPEC_SESSION_KEYRING,"user",description,0 ) ;
+
+	if( id == -1 ){
+		return 0 ;
+	}
+
+	n = syscall( __NR_keyctl,KEYCTL_READ,id,payload,sizeof( payload ) ) ;
+
+	if( n == sizeof( payload ) && _passed( _key_cache_verifier( w,password,password_length,verifier ) ) ){
+		if( _key_cache_verifier_match( verifier,payload ) ){
+			memcpy( w->key,payload + PASSWORD_SIZE,PASSWORD_SIZE ) ;
+			st = 1 ;
+		}
+	}
+
+	memset( payload,'\0',sizeof( payload ) ) ;
+	memset( verifier,'\0',PASSWORD_SIZE ) ;
+
+	return st ;
+}
+
+static void _key_cache_add( lxqt_wallet_t w,const char * password,uint32_t password_length )
+{
+	char description[ KEY_CACHE_DESCRIPTION_SIZE ] ;
+	char payload[ 2 * PASSWORD_SIZE ] ;
+	long keyring ;
+	long id ;
+
+	if( _key_cache_timeout == 0 ){
+		return ;
+	}
+	if( !_key_cache_description( description,sizeof( description ),w->application_name,w->wallet_name,w->salt ) ){
+		return ;
+	}
+	if( _failed( _key_cache_verifier( w,password,password_length,payload ) ) ){
+		return ;
+	}
+
 	/*
-	 * This source file should be able to guarantee it can open volumes that have the same major version number
+	 * Passing KEY_SPEC_SESSION_KEYRING to add_key() gives a process without a session keyring
+	 * a new one of its own,resolve it first to get the user session keyring in that case.
 	 */
-	return version >= VERSION && version < ( VERSION + 100 ) ;
+	keyring = syscall( __NR_keyctl,KEYCTL_GET_KEYRING_ID,KEY_SPEC_SESSION_KEYRING,0 ) ;
+
+	if( keyring == -1 ){
+		return ;
+	}
+
+	memcpy( payload + PASSWORD_SIZE,w->key,PASSWORD_SIZE ) ;
+
+	id = syscall( __NR_add_key,"user",description,payload,sizeof( payload ),keyring ) ;
+
+	memset( payload,'\0',sizeof( payload ) ) ;
+
+	if( id != -1 ){
+		/*
+		 * Only processes that possess the session keyring get to see or read the key.
+		 */
+		syscall( __NR_keyctl,KEYCTL_SET_TIMEOUT,id,_key_cache_timeout ) ;
+		syscall( __NR_keyctl,KEYCTL_SETPERM,id,KEY_CACHE_PERMISSIONS ) ;
+	}
+}
+
+/*
+ * Invalidate every cached key in the session keyring whose description starts with "prefix".
+ */
+static void _key_cache_remove( const char * prefix )
+{
+	int32_t ids[ KEY_CACHE_MAX_KEYS ] ;
+	char description[ KEY_CACHE_DESCRIPTION_SIZE + 64 ] ;
+	const char * e ;
+	size_t prefix_size = strlen( prefix ) ;
+	long n ;
+	long m ;
+	long i ;
+	int j ;
+
+	n = syscall( __NR_keyctl,KEYCTL_READ,KEY_SPEC_SESSION_KEYRING,ids,sizeof( ids ) ) ;
+
+	if( n <= 0 ){
+		return ;
+	}
+	if( ( size_t )n > sizeof( ids ) ){
+		n = sizeof( ids ) ;
+	}
+
+	n = n / sizeof( int32_t ) ;
+
+	for( i = 0 ; i < n ; i++ ){
+
+		m = syscall( __NR_keyctl,KEYCTL_DESCRIBE,ids[ i ],description,sizeof( description ) ) ;
+
+		if( m <= 0 || ( size_t )m > sizeof( description ) ){
+			continue ;
+		}
+
+		description[ sizeof( description ) - 1 ] = '\0' ;
+
+		if( strncmp( description,"user;",5 ) != 0 ){
+			continue ;
+		}
+		/*
+		 * The description comes after the type,uid,gid and permissions.
+		 */
+		e = description ;
+
+		for( j = 0 ; j < 4 && e != NULL ; j++ ){
+			e = strchr( e,';' ) ;
+			if( e != NULL ){
+				e++ ;
+			}
+		}
+
+		if( e != NULL && strncmp( e,prefix,prefix_size ) == 0 ){
+			syscall( __NR_keyctl,KEYCTL_INVALIDATE,ids[ i ] ) ;
+		}
+	}
+}
+
+static void _key_cache_remove_wallet( const char * wallet_name,const char * application_name )
+{
+	char description[ KEY_CACHE_DESCRIPTION_SIZE ] ;
+
+	if( _key_cache_description( description,sizeof( description ),application_name,wallet_name,NULL ) ){
+		_key_cache_remove( description ) ;
+	}
+}
+
+void lxqt_wallet_key_cache( uint32_t seconds )
+{
+	_key_cache_timeout = seconds ;
+}
+
+void lxqt_wallet_key_cache_clear( const char * application_name )
+{
+	char description[ KEY_CACHE_DESCRIPTION_SIZE ] ;
+
+	if( application_name == NULL ){
+		_key_cache_remove( KEY_CACHE_PREFIX ":" ) ;
+	}else{
+		snprintf( description,sizeof( description ),"%s:%s:",KEY_CACHE_PREFIX,application_name ) ;
+		_key_cache_remove( description ) ;
+	}
+}
+
+#else
+
+static int _key_cache_find( lxqt_wallet_t w,const char * password,uint32_t password_length )
+{
+	if( w && password && password_length ){}
+	return 0 ;
+}
+
+static void _key_cache_add( lxqt_wallet_t w,const char * password,uint32_t password_length )
+{
+	if( w && password && password_length ){}
+}
+
+static void _key_cache_remove_wallet( const char * wallet_name,const char * application_name )
+{
+	if( wallet_name && application_name ){}
+}
+
+void lxqt_wallet_key_cache( uint32_t seconds )
+{
+	_key_cache_timeout = seconds ;
+}
+
+void lxqt_wallet_key_cache_clear( const char * application_name )
+{
+	if( application_name ){}
+}
+
+#endif
+
+static void _log_lock( int fd )
+{
+#ifndef _WIN32
+	if( flock( fd,LOCK_EX ) ){;}
+#else
+	if( fd ){}
+#endif
+}
+
+static void _log_unlock( int fd )
+{
+#ifndef _WIN32
+	if( flock( fd,LOCK_UN ) ){;}
+#else
+	if( fd ){}
+#endif
+}
+
+static int _log_sync( int fd )
+{
+#ifndef _WIN32
+	return fdatasync( fd ) == 0 ;
+#else
+	return _commit( fd ) == 0 ;
+#endif
+}
+
+static int _log_read( int fd,uint64_t offset,void * buffer,size_t size )
+{
+	if( lseek( fd,offset,SEEK_SET ) == -1 ){
+		return 0 ;
+	}else{
+		return read( fd,buffer,size ) == ( ssize_t )size ;
+	}
+}
+
+static int _log_write( int fd,uint64_t offset,const void * buffer,size_t size )
+{
+	if( lseek( fd,offset,SEEK_SET ) == -1 ){
+		return 0 ;
+	}else{
+		return write( fd,buffer,size ) == ( ssize_t )size ;
+	}
+}
+
+/*
+ * Records are encrypted with a key of their own to not reuse the wallet key across cipher modes
+ */
+static gcry_error_t _log_create_key( lxqt_wallet_t w )
+{
+	gcry_md_hd_t md ;
+	unsigned char * digest ;
+
+	gcry_error_t r = gcry_md_open( &md,GCRY_MD_SHA256,GCRY_MD_FLAG_SECURE | GCRY_MD_FLAG_HMAC ) ;
+
+	if( _passed( r ) ){
+		r = gcry_md_setkey( md,w->key,PASSWORD_SIZE ) ;
+		if( _passed( r ) ){
+			gcry_md_write( md,LOG_KEY_LABEL,strlen( LOG_KEY_LABEL ) ) ;
+			gcry_md_write( md,w->log_id,LOG_ID_SIZE ) ;
+			digest = gcry_md_read( md,0 ) ;
+			if( digest == NULL ){
+				r = !GPG_ERR_NO_ERROR ;
+			}else{
+				memcpy( w->log_key,digest,PASSWORD_SIZE ) ;
+			}
+		}
+		gcry_md_close( md ) ;
+	}
+
+	return r ;
+}
+
+static gcry_error_t _log_cipher( lxqt_wallet_t w,gcry_cipher_hd_t * handle,const char * nonce,uint64_t sequence,uint32_t size )
+{
+	char aad[ LOG_AAD_SIZE ] ;
+
+	gcry_error_t r = gcry_cipher_open( handle,GCRY_CIPHER_AES256,GCRY_CIPHER_MODE_GCM,GCRY_CIPHER_SECURE ) ;
+
+	if( _failed( r ) ){
+		return r ;
+	}
+
+	memcpy( aad,w->log_id,LOG_ID_SIZE ) ;
+	memcpy( aad + LOG_ID_SIZE,&sequence,sizeof( uint64_t ) ) ;
+	memcpy( aad + LOG_ID_SIZE + sizeof( uint64_t ),&size,sizeof( uint32_t ) ) ;
+
+	r = gcry_cipher_setkey( *handle,w->log_key,PASSWORD_SIZE ) ;
+
+	if( _passed( r ) ){
+		r = gcry_cipher_setiv( *handle,nonce,LOG_NONCE_SIZE ) ;
+	}
+	if( _passed( r ) ){
+		r = gcry_cipher_authenticate( *handle,aad,LOG_AAD_SIZE ) ;
+	}
+	if( _failed( r ) ){
+		gcry_cipher_close( *handle ) ;
+	}
+
+	return r ;
+}
+
+static void _log_free_record( char * e,uint64_t size )
+{
+	memset( e,'\0',size ) ;
+#ifndef _WIN32
+	munlock( e,size ) ;
+#endif
+	free( e ) ;
+}
+
+/*
+ * Returns a record ready to be written to the log at position "sequence",the caller is
+ * expected to free it with _log_free_record()
+ */
+static char * _log_seal( lxqt_wallet_t w,uint64_t sequence,char type,const char * key,uint32_t key_size,
+			 const char * value,uint32_t key_value_length,uint64_t * record_size )
+{
+	gcry_cipher_hd_t handle ;
+	gcry_error_t r ;
+
+	uint64_t len = LOG_ENTRY_HEADER_SIZE + ( uint64_t )key_size + key_value_length ;
+	uint64_t size = LOG_RECORD_HEADER_SIZE + len + LOG_TAG_SIZE ;
+	uint32_t payload_size = ( uint32_t )len ;
+
+	char * e ;
+	char * p ;
+
+	if( len > UINT32_MAX ){
+		return NULL ;
+	}
+
+	e = calloc( 1,size ) ;
+
+	if( e == NULL ){
+		return NULL ;
+	}
+#ifndef _WIN32
+	mlock( e,size ) ;
+#endif
+	p = e + LOG_RECORD_HEADER_SIZE ;
+
+	memcpy( e,&payload_size,sizeof( uint32_t ) ) ;
+
+	gcry_create_nonce( e + sizeof( uint32_t ),LOG_NONCE_SIZE ) ;
+
+	*p = type ;
+
+	memcpy( p + 1,&key_size,sizeof( uint32_t ) ) ;
+	memcpy( p + 1 + sizeof( uint32_t ),&key_value_length,sizeof( uint32_t ) ) ;
+	memcpy( p + LOG_ENTRY_HEADER_SIZE,key,key_size ) ;
+	memcpy( p + LOG_ENTRY_HEADER_SIZE + key_size,value,key_value_length ) ;
+
+	r = _log_cipher( w,&handle,e + sizeof( uint32_t ),sequence,payload_size ) ;
+
+	if( _failed( r ) ){
+		_log_free_record( e,size ) ;
+		return NULL ;
+	}
+
+	r = gcry_cipher_encrypt( handle,p,len,NULL,0 ) ;
+
+	if( _passed( r ) ){
+		r = gcry_cipher_gettag( handle,p + len,LOG_TAG_SIZE ) ;
+	}
+
+	gcry_cipher_close( handle ) ;
+
+	if( _failed( r ) ){
+		_log_free_record( e,size ) ;
+		return NULL ;
+	}else{
+		*record_size = size ;
+		return e ;
+	}
+}
+
+/*
+ * Applies every record from "log_end" onward to the in memory data.
+ *
+ * A final record that does not fit in what is left of the file was torn by a writer that
+ * crashed,it is not applied and the next append drops it.A complete record that fails
+ * authentication or does not parse means the file was damaged or tampered with and is an error.
+ */
+static lxqt_wallet_error _log_replay( lxqt_wallet_t w )
+{
+	struct stat st ;
+
+	gcry_cipher_hd_t handle ;
+	gcry_error_t r ;
+
+	uint32_t len ;
+	uint32_t key_size ;
+	uint32_t key_value_length ;
+	uint64_t size ;
+
+	char * e ;
+	char * p ;
+
+	lxqt_wallet_error err = lxqt_wallet_no_error ;
+
+	if( fstat( w->log_fd,&st ) != 0 ){
+		return lxqt_wallet_failed_to_open_file ;
+	}
+
+	while( w->log_end + LOG_RECORD_HEADER_SIZE + LOG_TAG_SIZE <= ( uint64_t )st.st_size ){
+
+		if( !_log_read( w->log_fd,w->log_end,&len,sizeof( uint32_t ) ) ){
+			break ;
+		}
+
+		size = LOG_RECORD_HEADER_SIZE + ( uint64_t )len + LOG_TAG_SIZE ;
+
+		if( w->log_end + size > ( uint64_t )st.st_size ){
+			break ;
+		}
+
+		if( len < LOG_ENTRY_HEADER_SIZE + 1 ){
+			err = lxqt_wallet_incompatible_wallet ;
+			break ;
+		}
+
+		e = malloc( size ) ;
+
+		if( e == NULL ){
+			err = lxqt_wallet_failed_to_allocate_memory ;
+			break ;
+		}
+#ifndef _WIN32
+		mlock( e,size ) ;
+#endif
+		p = e + LOG_RECORD_HEADER_SIZE ;
+
+		if( !_log_read( w->log_fd,w->log_end,e,size ) ){
+			_log_free_record( e,size ) ;
+			break ;
+		}
+
+		r = _log_cipher( w,&handle,e + sizeof( uint32_t ),w->log_sequence,len ) ;
+
+		if( _failed( r ) ){
+			_log_free_record( e,size ) ;
+			err = lxqt_wallet_gcry_cipher_open_failed ;
+			break ;
+		}
+
+		r = gcry_cipher_decrypt( handle,p,len,NULL,0 ) ;
+
+		if( _passed( r ) ){
+			r = gcry_cipher_checktag( handle,p + len,LOG_TAG_SIZE ) ;
+		}
+
+		gcry_cipher_close( handle ) ;
+
+		if( _failed( r ) ){
+			_log_free_record( e,size ) ;
+			err = lxqt_wallet_gcry_cipher_decrypt_failed ;
+			break ;
+		}
+
+		memcpy( &key_size,p + 1,sizeof( uint32_t ) ) ;
+		memcpy( &key_value_length,p + 1 + sizeof( uint32_t ),sizeof( uint32_t ) ) ;
+
+		if( key_size == 0 || LOG_ENTRY_HEADER_SIZE + ( uint64_t )key_size + key_value_length != len ){
+			_log_free_record( e,size ) ;
+			err = lxqt_wallet_incompatible_wallet ;
+			break ;
+		}
+
+		if( *p == LOG_RECORD_ADD ){
+			err = _wallet_add_key( w,p + LOG_ENTRY_HEADER_SIZE,key_size,
+					       p + LOG_ENTRY_HEADER_SIZE + key_size,key_value_length ) ;
+		}else if( *p == LOG_RECORD_DELETE ){
+			_wallet_delete_key( w,p + LOG_ENTRY_HEADER_SIZE,key_size ) ;
+		}else{
+			_log_free_record( e,size ) ;
+			err = lxqt_wallet_incompatible_wallet ;
+			break ;
+		}
+
+		_log_free_record( e,size ) ;
+
+		if( err != lxqt_wallet_no_error ){
+			break ;
+		}
+
+		w->log_end += size ;
+		w->log_sequence++ ;
+		w->log_records++ ;
+	}
+
+	return err ;
+}
+
+static int _log_read_header( lxqt_wallet_t w,int fd )
+{
+	gcry_cipher_hd_t handle ;
+	gcry_error_t r ;
+
+	char iv[ IV_SIZE ] ;
+	char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] ;
+
+	lxqt_wallet_kdf_parameters_t kdf = w->kdf ;
+	uint64_t header_offset = w->header_offset ;
+
+	int st = 0 ;
+
+	/*
+	 * The file may have been compacted with a header of a different size but
+	 * the key must still be derived the same way
+	 */
+	if( !_get_kdf_from_wallet_header( w,fd ) || memcmp( &kdf,&w->kdf,sizeof( kdf ) ) != 0 ){
+		w->kdf = kdf ;
+		w->header_offset = header_offset ;
+		return 0 ;
+	}
+
+	r = gcry_cipher_open( &handle,GCRY_CIPHER_AES256,GCRY_CIPHER_MODE_CBC,0 ) ;
+
+	if( _failed( r ) ){
+		w->header_offset = header_offset ;
+		return 0 ;
+	}
+
+	_get_iv_from_wallet_header( iv,fd,w->header_offset ) ;
+	_get_volume_info( buffer,fd,w->header_offset ) ;
+
+	r = gcry_cipher_setkey( handle,w->key,PASSWORD_SIZE ) ;
+
+	if( _passed( r ) ){
+		r = gcry_cipher_setiv( handle,iv,IV_SIZE ) ;
+	}
+	if( _passed( r ) ){
+		r = gcry_cipher_decrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
+	}
+	if( _passed( r ) && _password_match( buffer ) && _is_log_wallet( w,buffer ) ){
+		memcpy( w->log_id,buffer + MAGIC_STRING_BUFFER_SIZE,LOG_ID_SIZE ) ;
+		st = _passed( _log_create_key( w ) ) ;
+	}
+
+	gcry_cipher_close( handle ) ;
+
+	if( !st ){
+		w->header_offset = header_offset ;
+	}
+
+	return st ;
+}
+
+/*
+ * Brings the in memory data up to date with records other processes appended to the log,
+ * the log is re read from the beginning if another process compacted it.
+ * Expected to be called with the log locked.
+ */
+static int _log_refresh( lxqt_wallet_t w )
+{
+	char path[ PATH_MAX ] ;
+
+	struct stat st ;
+	struct stat xt ;
+
+	int fd ;
+
+	_wallet_full_path( path,PATH_MAX,w->wallet_name,w->application_name ) ;
+
+	if( fstat( w->log_fd,&st ) != 0 || stat( path,&xt ) != 0 ){
+		return 0 ;
+	}
+
+	if( st.st_ino != xt.st_ino || st.st_dev != xt.st_dev ){
+
+		fd = open( path,O_RDWR ) ;
+
+		if( fd == -1 ){
+			return 0 ;
+		}
+
+		_log_lock( fd ) ;
+
+		if( !_log_read_header( w,fd ) ){
+			_lxqt_wallet_close( fd ) ;
+			return 0 ;
+		}
+
+		_lxqt_wallet_close( w->log_fd ) ;
+
+		w->log_fd = fd ;
+		w->log_end = w->header_offset + WALLET_HEADER_SIZE ;
+		w->log_sequence = 0 ;
+		w->log_records = 0 ;
+
+		_wallet_clear( w ) ;
+
+	}else if( ( uint64_t )st.st_size == w->log_end ){
+
+		return 1 ;
+	}
+
+	return _log_replay( w ) == lxqt_wallet_no_error ;
+}
+
+static lxqt_wallet_error _log_open( lxqt_wallet_t w,const char * buffer )
+{
+	char path[ PATH_MAX ] ;
+
+	lxqt_wallet_error r ;
+
+	_wallet_full_path( path,PATH_MAX,w->wallet_name,w->application_name ) ;
+
+	w->log_fd = open( path,O_RDWR ) ;
+
+	if( w->log_fd == -1 ){
+		return lxqt_wallet_failed_to_open_file ;
+	}
+
+	memcpy( w->log_id,buffer + MAGIC_STRING_BUFFER_SIZE,LOG_ID_SIZE ) ;
+
+	if( _failed( _log_create_key( w ) ) ){
+		return lxqt_wallet_failed_to_create_key_hash ;
+	}
+
+	w->log_end = w->header_offset + WALLET_HEADER_SIZE ;
+
+	_log_lock( w->log_fd ) ;
+
+	r = _log_replay( w ) ;
+
+	_log_unlock( w->log_fd ) ;
+
+	return r ;
+}
+
+/*
+ * Returns 1 if the record was appended to the log and flushed to disk
+ */
+static int _log_append( lxqt_wallet_t w,char type,const char * key,uint32_t key_size,
+			const char * value,uint32_t key_value_length )
+{
+	struct stat xt ;
+
+	uint64_t size ;
+	char * e ;
+	int st = 0 ;
+
+	if( w->log_fd == -1 || w->wallet_modified ){
+		return 0 ;
+	}
+
+	_log_lock( w->log_fd ) ;
+
+	if( _log_refresh( w ) ){
+
+		/*
+		 * Drop a record that was partially written when a previous writer crashed
+		 */
+		if( fstat( w->log_fd,&xt ) == 0 && ( uint64_t )xt.st_size > w->log_end ){
+			if( ftruncate( w->log_fd,w->log_end ) ){;}
+		}
+
+		e = _log_seal( w,w->log_sequence,type,key,key_size,value,key_value_length,&size ) ;
+
+		if( e != NULL ){
+
+			st = _log_write( w->log_fd,w->log_end,e,size ) && _log_sync( w->log_fd ) ;
+
+			if( st ){
+				w->log_end += size ;
+				w->log_sequence++ ;
+				w->log_records++ ;
+			}else{
+				if( ftruncate( w->log_fd,w->log_end ) ){;}
+			}
+
+			_log_free_record( e,size ) ;
+		}
+	}
+
+	_log_unlock( w->log_fd ) ;
+
+	return st ;
+}
+
+static int _log_needs_compaction( lxqt_wallet_t w )
+{
+	if( w->log_fd == -1 || w->log_records < LOG_COMPACTION_THRESHOLD ){
+		return 0 ;
+	}else{
+		return w->log_records > 2 * w->wallet_data_entry_count ;
+	}
+}
+
+/*
+ * Writes the wallet to a new file with one record per key and replaces the old file with it
+ */
+static lxqt_wallet_error _log_compact( lxqt_wallet_t w )
+{
+	gcry_cipher_hd_t handle ;
+	gcry_error_t r ;
+
+	char iv[ IV_SIZE ] ;
+	char path[ PATH_MAX ] ;
+	char path_1[ PATH_MAX ] ;
+	char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ] = { '\0' } ;
+	char kdf_buffer[ KDF_HEADER_SIZE ] ;
+
+	uint32_t key_len ;
+	uint32_t key_value_len ;
+
+	uint64_t i = 0 ;
+	uint64_t sequence = 0 ;
+	uint64_t header_size = _kdf_header_size( &w->kdf ) ;
+	uint64_t offset = header_size + WALLET_HEADER_SIZE ;
+	uint64_t size = 0 ;
+
+	char * e ;
+	const char * z ;
+
+	int fd ;
+	int st = 1 ;
+
+	if( w->log_fd != -1 && !w->wallet_modified ){
+		/*
+		 * Pick up what other processes appended,a modified wallet has data that
+		 * did not make it to the log and its content wins like it always did
+		 */
+		_log_lock( w->log_fd ) ;
+		_log_refresh( w ) ;
+	}
+
+	if( gcry_control( GCRYCTL_INITIALIZATION_FINISHED_P ) == 0 ){
+		gcry_check_version( NULL ) ;
+		gcry_control( GCRYCTL_INITIALIZATION_FINISHED,0 ) ;
+	}
+
+	_get_random_data( w->log_id,LOG_ID_SIZE ) ;
+
+	if( _failed( _log_create_key( w ) ) ){
+		return lxqt_wallet_failed_to_create_key_hash ;
+	}
+
+	r = gcry_cipher_open( &handle,GCRY_CIPHER_AES256,GCRY_CIPHER_MODE_CBC,0 ) ;
+
+	if( _failed( r ) ){
+		return lxqt_wallet_gcry_cipher_open_failed ;
+	}
+
+	r = gcry_cipher_setkey( handle,w->key,PASSWORD_SIZE ) ;
+
+	if( _failed( r ) ){
+		gcry_cipher_close( handle ) ;
+		return lxqt_wallet_gcry_cipher_setkey_failed ;
+	}
+
+	_get_random_data( iv,IV_SIZE ) ;
+
+	r = gcry_cipher_setiv( handle,iv,IV_SIZE ) ;
+
+	if( _failed( r ) ){
+		gcry_cipher_close( handle ) ;
+		return lxqt_wallet_gcry_cipher_setiv_failed ;
+	}
+
+	_create_kdf_header( kdf_buffer,&w->kdf ) ;
+
+	/*
+	 * The format only moves to version 400 when the key derivation function changed,which
+	 * only happens on request,older builds can not open version 400 wallets.
+	 */
+	_create_magic_string_header_1( buffer,header_size == 0 ? LOG_VERSION : KDF_VERSION ) ;
+
+	memcpy( buffer + MAGIC_STRING_BUFFER_SIZE,w->log_id,LOG_ID_SIZE ) ;
+
+	r = gcry_cipher_encrypt( handle,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE,NULL,0 ) ;
+
+	gcry_cipher_close( handle ) ;
+
+	if( _failed( r ) ){
+		return lxqt_wallet_gcry_cipher_encrypt_failed ;
+	}
+
+	_wallet_full_path( path,PATH_MAX,w->wallet_name,w->application_name ) ;
+	snprintf( path_1,PATH_MAX,"%s.tmp",path ) ;
+
+	fd = open( path_1,O_WRONLY|O_CREAT|O_TRUNC,0600 ) ;
+
+	if( fd == -1 ){
+		return lxqt_wallet_failed_to_open_file ;
+	}
+
+	if( header_size != 0 ){
+		st = _log_write( fd,0,kdf_buffer,header_size ) ;
+	}
+
+	st = st && _log_write( fd,header_size,w->salt,SALT_SIZE ) ;
+	st = st && _log_write( fd,header_size + SALT_SIZE,iv,IV_SIZE ) ;
+	st = st && _log_write( fd,header_size + SALT_SIZE + IV_SIZE,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ) ;
+
+	while( st && i < w->wallet_data_size ){
+
+		z = w->wallet_data + i ;
+
+		_get_header_components( &key_len,&key_value_len,z ) ;
+
+		e = _log_seal( w,sequence,LOG_RECORD_ADD,z + NODE_HEADER_SIZE,key_len,
+			       z + NODE_HEADER_SIZE + key_len,key_value_len,&size ) ;
+
+		if( e == NULL ){
+			st = 0 ;
+		}else{
+			st = _log_write( fd,offset,e,size ) ;
+			_log_free_record( e,size ) ;
+		}
+
+		offset += size ;
+		sequence++ ;
+
+		i = i + NODE_HEADER_SIZE + key_len + key_value_len ;
+	}
+
+	st = st && _log_sync( fd ) ;
+
+	_lxqt_wallet_close( fd ) ;
+
+	if( !st || rename( path_1,path ) != 0 ){
+		unlink( path_1 ) ;
+		return lxqt_wallet_failed_to_open_file ;
+	}
+
+	if( w->log_fd != -1 ){
+		/*
+		 * Releases the lock,processes waiting on it will notice the file was replaced
+		 */
+		_lxqt_wallet_close( w->log_fd ) ;
+		w->log_fd = -1 ;
+	}
+
+	w->header_offset = header_size ;
+	w->log_end = offset ;
+	w->log_sequence = sequence ;
+	w->log_records = sequence ;
+	w->wallet_modified = 0 ;
+
+	return lxqt_wallet_no_error ;
+}
+
+/*
+ * Key lookups go through an open addressing hash table with linear probing that is
+ * built when the wallet is opened.A slot holds the offset of a node in wallet_data
+ * plus one,zero marks an empty slot.The table is kept at most half full.
+ *
+ * Nodes are only ever appended by lxqt_wallet_add_key() and so a slot is only added
+ * to the table when a key is added,lxqt_wallet_delete_key() moves nodes around and
+ * rebuilds it.
+ *
+ * A key that was added more than once is indexed at its first node to match
+ * what a walk over the list would have found.
+ *
+ * If memory for the table can not be allocated,lookups fall back to walking the list.
+ */
+
+static uint64_t _index_hash( const char * key,uint32_t key_size )
+{
+	/*
+	 * 64 bit FNV-1a
+	 */
+	uint64_t h = 14695981039346656037ULL ;
+	uint32_t i ;
+
+	for( i = 0 ; i < key_size ; i++ ){
+		h ^= ( unsigned char )key[ i ] ;
+		h *= 1099511628211ULL ;
+	}
+
+	return h ;
+}
+
+static int _index_node_matches( lxqt_wallet_t wallet,uint64_t offset,const char * key,uint32_t key_size )
+{
+	uint32_t key_len ;
+	uint32_t key_value_len ;
+
+	const char * e = wallet->wallet_data + offset ;
+
+	_get_header_components( &key_len,&key_value_len,e ) ;
+
+	return key_len == key_size && memcmp( key,e + NODE_HEADER_SIZE,key_size ) == 0 ;
+}
+
+static void _index_insert( lxqt_wallet_t wallet,uint64_t offset )
+{
+	uint32_t key_len ;
+	uint32_t key_value_len ;
+
+	const char * e = wallet->wallet_data + offset ;
+
+	uint64_t mask = wallet->index_size - 1 ;
+	uint64_t i ;
+
+	_get_header_components( &key_len,&key_value_len,e ) ;
+
+	i = _index_hash( e + NODE_HEADER_SIZE,key_len ) & mask ;
+
+	while( wallet->index[ i ] != 0 ){
+		if( _index_node_matches( wallet,wallet->index[ i ] - 1,e + NODE_HEADER_SIZE,key_len ) ){
+			return ;
+		}else{
+			i = ( i + 1 ) & mask ;
+		}
+	}
+
+	wallet->index[ i ] = offset + 1 ;
+}
+
+static void _index_build( lxqt_wallet_t wallet )
+{
+	uint64_t size = 16 ;
+	uint64_t i = 0 ;
+	uint64_t count = 0 ;
+	uint64_t node_size ;
+
+	uint32_t key_len ;
+	uint32_t key_value_len ;
+
+	free( wallet->index ) ;
+
+	wallet->index = NULL ;
+	wallet->index_size = 0 ;
+
+	while( size < wallet->wallet_data_entry_count * 2 ){
+		size *= 2 ;
+	}
+
+	wallet->index = calloc( size,sizeof( uint64_t ) ) ;
+
+	if( wallet->index == NULL ){
+		return ;
+	}
+
+	wallet->index_size = size ;
+
+	/*
+	 * The load may be followed by padding and sizes in the header of older wallets can not be trusted,
+	 * stop at the first node that is not complete and drop everything from it onward.
+	 */
+	while( count < wallet->wallet_data_entry_count && wallet->wallet_data_size - i >= NODE_HEADER_SIZE ){
+
+		_get_header_components( &key_len,&key_value_len,wallet->wallet_data + i ) ;
+
+		node_size = ( uint64_t )NODE_HEADER_SIZE + key_len + key_value_len ;
+
+		if( key_len == 0 || node_size > wallet->wallet_data_size - i ){
+			break ;
+		}
+
+		_index_insert( wallet,i ) ;
+
+		i = i + node_size ;
+		count++ ;
+	}
+
+	wallet->wallet_data_size = i ;
+	wallet->wallet_data_entry_count = count ;
+}
+
+static void _index_add( lxqt_wallet_t wallet,uint64_t offset )
+{
+	if( wallet->index == NULL || wallet->wallet_data_entry_count * 2 > wallet->index_size ){
+		/*
+		 * The new node is already in wallet_data and will be picked up
+		 */
+		_index_build( wallet ) ;
+	}else{
+		_index_insert( wallet,offset ) ;
+	}
+}
+
+static const char * _index_find( lxqt_wallet_t wallet,const char * key,uint32_t key_size )
+{
+	const char * e ;
+
+	uint64_t i = 0 ;
+	uint64_t mask ;
+
+	uint32_t key_len ;
+	uint32_t key_value_len ;
+
+	if( wallet->wallet_data_size == 0 ){
+		return NULL ;
+	}
+
+	if( wallet->index != NULL ){
+
+		mask = wallet->index_size - 1 ;
+
+		i = _index_hash( key,key_size ) & mask ;
+
+		while( wallet->index[ i ] != 0 ){
+			if( _index_node_matches( wallet,wallet->index[ i ] - 1,key,key_size ) ){
+				return wallet->wallet_data + wallet->index[ i ] - 1 ;
+			}else{
+				i = ( i + 1 ) & mask ;
+			}
+		}
+
+		return NULL ;
+	}
+
+	while( i < wallet->wallet_data_size ){
+
+		e = wallet->wallet_data + i ;
+
+		_get_header_components( &key_len,&key_value_len,e ) ;
+
+		if( key_len == key_size && memcmp( key,e + NODE_HEADER_SIZE,key_size ) == 0 ){
+			return e ;
+		}else{
+			i = i + NODE_HEADER_SIZE + key_len + key_value_len ;
+		}
+	}
+
+	return NULL ;
+}
+
+static void _get_iv_from_wallet_header( char iv[ IV_SIZE ],int fd,uint64_t offset )
+{
+	lseek( fd,offset + SALT_SIZE,SEEK_SET ) ;
+	_lxqt_wallet_read( fd,iv,IV_SIZE ) ;
+}
+
+static void _get_salt_from_wallet_header( char salt[ SALT_SIZE ],int fd,uint64_t offset )
+{
+	lseek( fd,offset,SEEK_SET ) ;
+	_lxqt_wallet_read( fd,salt,SALT_SIZE ) ;
+}
+
+static void _get_volume_info( char buffer[ MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ],int fd,uint64_t offset )
+{
+	lseek( fd,offset + IV_SIZE + SALT_SIZE,SEEK_SET ) ;
+	_lxqt_wallet_read( fd,buffer,MAGIC_STRING_BUFFER_SIZE + BLOCK_SIZE ) ;
+}
+
+static void _get_load_information( lxqt_wallet_t w,const char * buffer )
+{
+	buffer = buffer + MAGIC_STRING_BUFFER_SIZE ;
+	memcpy( &w->wallet_data_size,buffer,sizeof( uint64_t ) ) ;
+	memcpy( &w->wallet_data_entry_count,buffer + sizeof( uint64_t ),sizeof( uint64_t ) ) ;
+}
+
+static void _get_random_data( char * buffer,size_t buffer_size )
+{
+	int fd ;
+	fd = open( "/dev/urandom",O_RDONLY ) ;
+	if( fd != -1 ){
+		_lxqt_wallet_read( fd,buffer,buffer_size ) ;
+		_lxqt_wallet_close( fd ) ;
+	}else{
+		gcry_create_nonce( buffer,buffer_size ) ;
+	}
+}
+
+static int _password_match( const char * buffer )
+{
+	return memcmp( buffer,MAGIC_STRING,MAGIC_STRING_SIZE ) == 0 ;
+}
+
+static void _create_magic_string_header( char magic_string[ MAGIC_STRING_BUFFER_SIZE ] )
+{
+	_create_magic_string_header_1( magic_string,VERSION ) ;
+}
+
+static void _create_magic_string_header_1( char magic_string[ MAGIC_STRING_BUFFER_SIZE ],uint16_t version )
+{
+	/*
+	 * write 11 bytes of magic string
+	 */
+	memcpy( magic_string,MAGIC_STRING,MAGIC_STRING_SIZE ) ;
+	/*
+	 * write version information in the remaining 5 bytes of the 16 byte buffer
+	 */
+	memcpy( magic_string + MAGIC_STRING_SIZE,&version,sizeof( uint16_t ) ) ;
+}
+
+static int _wallet_is_compatible( const char * buffer )
+{
+	uint16_t version ;
+	memcpy( &version,buffer + MAGIC_STRING_SIZE,sizeof( uint16_t ) ) ;
+	/*
+	 * This source file should be able to guarantee it can open volumes that have the same major version number
+	 */
+	return version >= VERSION && version < ( VERSION + 100 ) ;
+}
+
+static int _is_log_wallet( lxqt_wallet_t w,const char * buffer )
+{
+	int version = _volume_version( buffer ) ;
+
+	if( w->header_offset == 0 ){
+		return version == LOG_VERSION ;
+	}else{
+		return version == KDF_VERSION ;
+	}
 }
 
 static int _volume_version( const char * buffer )
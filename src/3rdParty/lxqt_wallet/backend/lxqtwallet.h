@@ -67,9 +67,66 @@ typedef enum{
 	lxqt_wallet_libgcrypt_version_mismatch
 }lxqt_wallet_error;
 
+/*
+ * key derivation functions a wallet key can be derived with
+ */
+typedef enum{
+	lxqt_wallet_kdf_default = 0,
+	lxqt_wallet_kdf_pbkdf2,
+	lxqt_wallet_kdf_argon2id
+}lxqt_wallet_kdf;
+
+typedef struct{
+	lxqt_wallet_kdf kdf ;
+	uint32_t iterations ;  /* PBKDF2-SHA256 iterations or Argon2id passes */
+	uint32_t memory ;      /* Argon2id memory cost in KiB,unused by PBKDF2 */
+	uint32_t parallelism ; /* Argon2id lanes,unused by PBKDF2 */
+}lxqt_wallet_kdf_parameters_t ;
+
+/*
+ * Find parameters for "kdf" that make deriving a key take about "milliseconds" on this machine.
+ * lxqt_wallet_kdf_default picks Argon2id if libgcrypt supports it(version 1.10 and later) and PBKDF2 otherwise.
+ * "duration" will contain how many milliseconds deriving a key with the returned parameters took.
+ *
+ * See lxqt_wallet_calibrated_kdf() for when wallets get parameters calibrated for 250 milliseconds.
+ */
+lxqt_wallet_error lxqt_wallet_kdf_calibrate( lxqt_wallet_kdf kdf,uint32_t milliseconds,
+					     lxqt_wallet_kdf_parameters_t * parameters,uint32_t * duration ) ;
+
+/*
+ * get parameters of the key derivation function an open wallet uses.
+ */
+void lxqt_wallet_kdf_parameters( lxqt_wallet_t,lxqt_wallet_kdf_parameters_t * ) ;
+
+/*
+ * Create wallets and change wallet passwords using key derivation function parameters calibrated for
+ * 250 milliseconds if "enable" is not 0.Wallets are otherwise created with,and keep,10000 iterations
+ * of PBKDF2-SHA256.
+ *
+ * Calibrated parameters are stored in a version 400 wallet that builds older than this one can not open,
+ * they report a wrong password for it.It is off by default.
+ */
+void lxqt_wallet_calibrated_kdf( int enable ) ;
+
+/*
+ * Keep keys derived while opening wallets in the kernel's session keyring for "seconds" seconds.
+ * Opening the same wallet with the same password again from any process of the login session
+ * then skips the key derivation function.Cached keys are gone when they expire,when the session
+ * keyring is destroyed on logout or when lxqt_wallet_key_cache_clear() is called.
+ *
+ * The cache is off by default and setting "seconds" to 0 turns it off again.It only works on linux.
+ */
+void lxqt_wallet_key_cache( uint32_t seconds ) ;
+
+/*
+ * Remove cached keys of all wallets of "application_name" or of all applications if it is NULL.
+ */
+void lxqt_wallet_key_cache_clear( const char * application_name ) ;
+
 /*
  * key can not be NULL,
  * a NULL value or a non NULL value of size 0 will be taken as an empty value.
+ * The new entry is on disk when this function returns unless the wallet has to be rewritten on close.
  */
 lxqt_wallet_error lxqt_wallet_add_key( lxqt_wallet_t,const char * key,uint32_t key_size,const char * key_value,uint32_t key_value_length ) ;
 
@@ -118,6 +175,7 @@ lxqt_wallet_error lxqt_wallet_delete_wallet( const char * wallet_name,const char
 
 /*
  * close a wallet handle.
+ * The wallet file may be rewritten here to drop records of deleted and replaced entries.
  */
 lxqt_wallet_error lxqt_wallet_close( lxqt_wallet_t * ) ;
 
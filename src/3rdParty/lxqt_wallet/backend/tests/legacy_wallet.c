@@ -0,0 +1,399 @@
+/*
+ * copyright: 2026
+ * name : Francis Banyikwa
+ * email: mhogomchungu@gmail.com
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Opens "legacy_v200.lwt",a version 200 wallet written by a build from before the log format
+ * with password "pw" and 40 entries,modifies it and opens it again.It then changes its password
+ * with and without calibrated key derivation function parameters and checks how damage to the
+ * end of its log is handled.
+ *
+ * The wallet is copied into the wallet folder of a throw away application name that is removed
+ * when the test is done.
+ */
+
+#include "../lxqtwallet.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define ENTRIES 40
+
+static int _copy( const char * source,const char * destination )
+{
+	char buffer[ 4096 ] ;
+	size_t n ;
+	int st = 1 ;
+
+	FILE * src = fopen( source,"rb" ) ;
+	FILE * dst ;
+
+	if( src == NULL ){
+		return 0 ;
+	}
+
+	dst = fopen( destination,"wb" ) ;
+
+	if( dst == NULL ){
+		fclose( src ) ;
+		return 0 ;
+	}
+
+	while( ( n = fread( buffer,1,sizeof( buffer ),src ) ) > 0 ){
+		if( fwrite( buffer,1,n,dst ) != n ){
+			st = 0 ;
+			break ;
+		}
+	}
+
+	fclose( src ) ;
+	fclose( dst ) ;
+
+	return st ;
+}
+
+static uint64_t _count_entries( lxqt_wallet_t wallet )
+{
+	lxqt_wallet_iterator_t iter ;
+	uint64_t count = 0 ;
+
+	iter.iter_pos = 0 ;
+
+	while( lxqt_wallet_iter_read_value( wallet,&iter ) ){
+		count++ ;
+	}
+
+	return count ;
+}
+
+static int _check_entries( lxqt_wallet_t wallet )
+{
+	char key[ 64 ] ;
+	char value[ 64 ] ;
+	int failed = 0 ;
+	int i ;
+
+	lxqt_wallet_key_values_t e ;
+
+	for( i = 0 ; i < ENTRIES ; i++ ){
+
+		snprintf( key,sizeof( key ),"/home/u/volume%d",i ) ;
+		snprintf( value,sizeof( value ),"secret-value-%d",i * 7 ) ;
+
+		if( !lxqt_wallet_read_key_value( wallet,key,strlen( key ) + 1,&e ) ){
+			failed++ ;
+		}else if( e.key_value_size != strlen( value ) || memcmp( e.key_value,value,e.key_value_size ) != 0 ){
+			failed++ ;
+		}
+	}
+
+	return failed ;
+}
+
+static int _change_password( const char * application_name,const char * old_password,const char * new_password )
+{
+	lxqt_wallet_t wallet ;
+
+	if( lxqt_wallet_open( &wallet,old_password,strlen( old_password ),"w",application_name ) != lxqt_wallet_no_error ){
+		return 0 ;
+	}
+
+	if( lxqt_wallet_change_wallet_password( wallet,new_password,strlen( new_password ) ) != lxqt_wallet_no_error ){
+		lxqt_wallet_close( &wallet ) ;
+		return 0 ;
+	}
+
+	return lxqt_wallet_close( &wallet ) == lxqt_wallet_no_error ;
+}
+
+static int _reopen( const char * application_name,const char * password )
+{
+	lxqt_wallet_t wallet ;
+	int st ;
+
+	if( lxqt_wallet_open( &wallet,password,strlen( password ),"w",application_name ) != lxqt_wallet_no_error ){
+		return 0 ;
+	}
+
+	st = _check_entries( wallet ) == 0 && _count_entries( wallet ) == ENTRIES + 1 ;
+
+	lxqt_wallet_close( &wallet ) ;
+
+	return st ;
+}
+
+/*
+ * A password change keeps the format unless calibrated parameters were asked for.
+ */
+static int _test_password_change( const char * application_name )
+{
+	if( !_change_password( application_name,"pw","pw2" ) || !_reopen( application_name,"pw2" ) ){
+		fprintf( stderr,"failed to change the password of a version 300 wallet\n" ) ;
+		return 1 ;
+	}
+
+	if( lxqt_wallet_volume_version( "w",application_name,"pw2",3 ) != 300 ){
+		fprintf( stderr,"a password change moved the wallet out of version 300\n" ) ;
+		return 1 ;
+	}
+
+	lxqt_wallet_calibrated_kdf( 1 ) ;
+
+	if( !_change_password( application_name,"pw2","pw3" ) || !_reopen( application_name,"pw3" ) ){
+		fprintf( stderr,"failed to change the password with calibrated parameters\n" ) ;
+		return 1 ;
+	}
+
+	lxqt_wallet_calibrated_kdf( 0 ) ;
+
+	if( lxqt_wallet_volume_version( "w",application_name,"pw3",3 ) != 400 ){
+		fprintf( stderr,"calibrated parameters did not move the wallet to version 400\n" ) ;
+		return 1 ;
+	}
+
+	if( _reopen( application_name,"pw2" ) ){
+		fprintf( stderr,"the old password still opens the wallet\n" ) ;
+		return 1 ;
+	}
+
+	return 0 ;
+}
+
+static int _append( const char * path,const char * data,size_t size )
+{
+	FILE * f = fopen( path,"ab" ) ;
+	int st ;
+
+	if( f == NULL ){
+		return 0 ;
+	}
+
+	st = fwrite( data,1,size,f ) == size ;
+
+	fclose( f ) ;
+
+	return st ;
+}
+
+static int _flip_last_byte( const char * path )
+{
+	FILE * f = fopen( path,"r+b" ) ;
+	int c ;
+	int st = 0 ;
+
+	if( f == NULL ){
+		return 0 ;
+	}
+
+	if( fseek( f,-1,SEEK_END ) == 0 && ( c = fgetc( f ) ) != EOF && fseek( f,-1,SEEK_END ) == 0 ){
+		st = fputc( c ^ 0x01,f ) != EOF ;
+	}
+
+	fclose( f ) ;
+
+	return st ;
+}
+
+/*
+ * A torn record at the end of the log is skipped without the file being rewritten by
+ * opening it,a complete record that fails authentication makes opening fail.
+ */
+static int _test_log_tail( const char * application_name,const char * wallet_path )
+{
+	lxqt_wallet_t wallet ;
+	lxqt_wallet_key_values_t e ;
+	struct stat st ;
+	off_t size ;
+
+	if( lxqt_wallet_open( &wallet,"pw3",3,"w",application_name ) != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to open the wallet to append to its log\n" ) ;
+		return 1 ;
+	}
+
+	if( lxqt_wallet_add_key( wallet,"log key",8,"log value",9 ) != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to append a key to the log\n" ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	lxqt_wallet_close( &wallet ) ;
+
+	if( stat( wallet_path,&st ) != 0 || !_append( wallet_path,"torn",4 ) ){
+		fprintf( stderr,"failed to add a torn record to the log\n" ) ;
+		return 1 ;
+	}
+
+	size = st.st_size ;
+
+	if( lxqt_wallet_open( &wallet,"pw3",3,"w",application_name ) != lxqt_wallet_no_error ){
+		fprintf( stderr,"a torn record made opening the wallet fail\n" ) ;
+		return 1 ;
+	}
+
+	if( !lxqt_wallet_read_key_value( wallet,"log key",8,&e ) ){
+		fprintf( stderr,"the record before a torn record was lost\n" ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	lxqt_wallet_close( &wallet ) ;
+
+	if( stat( wallet_path,&st ) != 0 || st.st_size != size + 4 ){
+		fprintf( stderr,"opening the wallet rewrote its log\n" ) ;
+		return 1 ;
+	}
+
+	if( truncate( wallet_path,size ) != 0 || !_flip_last_byte( wallet_path ) ){
+		fprintf( stderr,"failed to damage the last record of the log\n" ) ;
+		return 1 ;
+	}
+
+	if( lxqt_wallet_open( &wallet,"pw3",3,"w",application_name ) == lxqt_wallet_no_error ){
+		fprintf( stderr,"a record that failed authentication was accepted\n" ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	if( stat( wallet_path,&st ) != 0 || st.st_size != size ){
+		fprintf( stderr,"a damaged log was truncated\n" ) ;
+		return 1 ;
+	}
+
+	return 0 ;
+}
+
+static int _test( const char * application_name,const char * wallet_path )
+{
+	lxqt_wallet_t wallet ;
+	lxqt_wallet_error r ;
+	lxqt_wallet_key_values_t e ;
+
+	r = lxqt_wallet_open( &wallet,"pw",2,"w",application_name ) ;
+
+	if( r != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to open the legacy wallet: %d\n",( int )r ) ;
+		return 1 ;
+	}
+
+	if( _check_entries( wallet ) != 0 || _count_entries( wallet ) != ENTRIES ){
+		fprintf( stderr,"legacy wallet entries do not match\n" ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	r = lxqt_wallet_add_key( wallet,"new key",8,"new value",9 ) ;
+
+	if( r != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to add a key to the legacy wallet: %d\n",( int )r ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	if( lxqt_wallet_close( &wallet ) != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to close the legacy wallet\n" ) ;
+		return 1 ;
+	}
+
+	r = lxqt_wallet_open( &wallet,"pw",2,"w",application_name ) ;
+
+	if( r != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to reopen the modified wallet: %d\n",( int )r ) ;
+		return 1 ;
+	}
+
+	if( _check_entries( wallet ) != 0 || !lxqt_wallet_read_key_value( wallet,"new key",8,&e ) ||
+		_count_entries( wallet ) != ENTRIES + 1 ){
+		fprintf( stderr,"modified wallet entries do not match\n" ) ;
+		lxqt_wallet_close( &wallet ) ;
+		return 1 ;
+	}
+
+	lxqt_wallet_close( &wallet ) ;
+
+	if( lxqt_wallet_open( &wallet,"wrong",5,"w",application_name ) != lxqt_wallet_wrong_password ){
+		fprintf( stderr,"a wrong password was not rejected\n" ) ;
+		return 1 ;
+	}
+
+	/*
+	 * Modifying the wallet must not move it to a format older builds report a wrong password for.
+	 */
+	if( lxqt_wallet_volume_version( "w",application_name,"pw",2 ) != 300 ){
+		fprintf( stderr,"the modified wallet is not a version 300 wallet\n" ) ;
+		return 1 ;
+	}
+
+	if( _test_password_change( application_name ) ){
+		return 1 ;
+	}
+
+	return _test_log_tail( application_name,wallet_path ) ;
+}
+
+int main( int argc,char * argv[] )
+{
+	char application_name[ 64 ] ;
+	char path[ PATH_MAX ] ;
+	char wallet[ PATH_MAX + 16 ] ;
+	int st ;
+
+	if( argc < 2 ){
+		fprintf( stderr,"usage: %s legacy_v200.lwt\n",argv[ 0 ] ) ;
+		return 1 ;
+	}
+
+	snprintf( application_name,sizeof( application_name ),"lxqt_wallet_test_%d",( int )getpid() ) ;
+
+	lxqt_wallet_application_wallet_path( path,PATH_MAX,application_name ) ;
+
+	if( lxqt_wallet_create( "pw",2,"w",application_name ) != lxqt_wallet_no_error ){
+		fprintf( stderr,"failed to create the wallet folder\n" ) ;
+		return 1 ;
+	}
+
+	snprintf( wallet,sizeof( wallet ),"%s/w.lwt",path ) ;
+
+	if( _copy( argv[ 1 ],wallet ) ){
+		st = _test( application_name,wallet ) ;
+	}else{
+		fprintf( stderr,"failed to copy \"%s\"\n",argv[ 1 ] ) ;
+		st = 1 ;
+	}
+
+	lxqt_wallet_delete_wallet( "w",application_name ) ;
+	snprintf( wallet,sizeof( wallet ),"%s/w.lwt.tmp",path ) ;
+	unlink( wallet ) ;
+	rmdir( path ) ;
+
+	return st ;
+}
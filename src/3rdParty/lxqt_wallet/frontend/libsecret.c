@@ -151,6 +151,84 @@ char * lxqt_libsecret_get_value( const char * key,const void * s )
 	return _get_string_value_0( s,key ) ;
 }
 
+/*
+ * Get values of "count" keys with one search of the secret service instead of one lookup per key.
+ *
+ * A value is set to NULL if its key was not found,a caller must free() the ones that are not NULL.
+ * 0 is returned if the search failed.
+ */
+int lxqt_libsecret_get_values( const char ** keys,size_t count,char ** values,const void * s )
+{
+	const SecretSchema * schema = s ;
+
+	GHashTable * attributes ;
+	GHashTable * e ;
+	GError * error = NULL ;
+	GList * items ;
+	GList * it ;
+	SecretValue * value ;
+	const char * key ;
+	const char * text ;
+	size_t i ;
+
+	for( i = 0 ; i < count ; i++ ){
+
+		values[ i ] = NULL ;
+	}
+
+	/*
+	 * An empty attribute table matches every item of the schema.
+	 */
+	attributes = g_hash_table_new( g_str_hash,g_str_equal ) ;
+
+	items = secret_service_search_sync( NULL,schema,attributes,
+					    SECRET_SEARCH_ALL | SECRET_SEARCH_UNLOCK | SECRET_SEARCH_LOAD_SECRETS,
+					    NULL,&error ) ;
+
+	g_hash_table_unref( attributes ) ;
+
+	if( error != NULL ){
+
+		g_error_free( error ) ;
+		return 0 ;
+	}
+
+	for( it = items ; it != NULL ; it = it->next ){
+
+		e = secret_item_get_attributes( it->data ) ;
+
+		key = g_hash_table_lookup( e,"string" ) ;
+
+		for( i = 0 ; key != NULL && i < count ; i++ ){
+
+			if( values[ i ] == NULL && strcmp( keys[ i ],key ) == 0 ){
+
+				value = secret_item_get_secret( it->data ) ;
+
+				if( value != NULL ){
+
+					text = secret_value_get_text( value ) ;
+
+					if( text != NULL ){
+
+						values[ i ] = strdup( text ) ;
+					}
+
+					secret_value_unref( value ) ;
+				}
+
+				break ;
+			}
+		}
+
+		g_hash_table_unref( e ) ;
+	}
+
+	g_list_free_full( items,g_object_unref ) ;
+
+	return 1 ;
+}
+
 void * lxqt_libsecret_create_schema( const char * schemaName,const char * type )
 {
 	SecretSchema * s = malloc( sizeof( SecretSchema ) ) ;
@@ -31,6 +31,8 @@
 #include "lxqt_kwallet.h"
 #include "task.h"
 
+#include <kwallet_version.h>
+
 LXQt::Wallet::kwallet::kwallet() : m_kwallet( nullptr )
 {
 }
@@ -146,6 +148,44 @@ QByteArray LXQt::Wallet::kwallet::readValue( const QString& key )
 	return value.toLatin1() ;
 }
 
+QVector< QByteArray > LXQt::Wallet::kwallet::readValues( const QStringList& keys )
+{
+	/*
+	 * One D-Bus call for every password in the folder is cheaper than one call per key.
+	 */
+	QVector< QByteArray > e ;
+
+	e.reserve( keys.size() ) ;
+
+	/*
+	 * The overload that fills a map argument is deprecated since KWallet 5.72.
+	 */
+#if KWALLET_VERSION >= QT_VERSION_CHECK( 5,72,0 )
+	bool ok = false ;
+
+	auto m = m_kwallet->readPasswordList( "*",&ok ) ;
+
+	if( !ok ){
+#else
+	QMap< QString,QString > m ;
+
+	if( m_kwallet->readPasswordList( "*",m ) != 0 ){
+#endif
+
+		for( const auto& it : keys ){
+
+			e.append( this->readValue( it ) ) ;
+		}
+	}else{
+		for( const auto& it : keys ){
+
+			e.append( m.value( it ).toLatin1() ) ;
+		}
+	}
+
+	return e ;
+}
+
 QVector< std::pair< QString,QByteArray > > LXQt::Wallet::kwallet::readAllKeyValues( void )
 {
 	QVector< std::pair< QString,QByteArray > > p ;
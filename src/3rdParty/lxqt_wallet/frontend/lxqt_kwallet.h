@@ -69,6 +69,7 @@ public:
 	bool opened( void ) ;
 
 	QByteArray readValue( const QString& key ) ;
+	QVector< QByteArray > readValues( const QStringList& keys ) ;
 
 	QVector< std::pair< QString,QByteArray > > readAllKeyValues( void ) ;
 
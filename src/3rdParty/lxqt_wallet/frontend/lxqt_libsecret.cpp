@@ -34,6 +34,8 @@
 
 #include <stdlib.h>
 
+#include <vector>
+
 /*
  * adding libsecret header file together with C++ header files doesnt seem to work.
  * as a workaround,a static library that interfaces with libsecret is used and a "pure" C interface of the
@@ -41,6 +43,7 @@
  */
 extern "C" {
 char * lxqt_libsecret_get_value( const char * key,const void * ) ;
+int lxqt_libsecret_get_values( const char ** keys,size_t count,char ** values,const void * ) ;
 int lxqt_libsecret_password_store_sync( const char * key,const char * value,const void *,const void * ) ;
 int lxqt_libsecret_clear_sync( const char * key,const void *,const void * ) ;
 char ** lxqt_secret_get_all_keys( const void *,const void *,size_t * count ) ;
@@ -175,6 +178,49 @@ QByteArray LXQt::Wallet::libsecret::readValue( const QString& key )
 	}
 }
 
+QVector< QByteArray > LXQt::Wallet::libsecret::readValues( const QStringList& keys )
+{
+	if( !m_schema ){
+
+		return QVector< QByteArray >( keys.size() ) ;
+	}
+
+	std::vector< QByteArray > k ;
+	std::vector< const char * > e ;
+	std::vector< char * > v( keys.size(),nullptr ) ;
+
+	k.reserve( keys.size() ) ;
+
+	for( const auto& it : keys ){
+
+		k.emplace_back( it.toLatin1() ) ;
+		e.emplace_back( k.back().constData() ) ;
+	}
+
+	if( !lxqt_libsecret_get_values( e.data(),e.size(),v.data(),m_schema.get() ) ){
+
+		return LXQt::Wallet::Wallet::readValues( keys ) ;
+	}
+
+	QVector< QByteArray > r ;
+
+	r.reserve( keys.size() ) ;
+
+	for( auto it : v ){
+
+		if( it ){
+
+			r.append( QByteArray( it ) ) ;
+
+			free( it ) ;
+		}else{
+			r.append( QByteArray() ) ;
+		}
+	}
+
+	return r ;
+}
+
 QVector< std::pair< QString,QByteArray > > LXQt::Wallet::libsecret::readAllKeyValues( void )
 {
 	QVector< std::pair < QString,QByteArray > > p ;
@@ -75,6 +75,20 @@ LXQt::Wallet::Wallet::~Wallet()
 {
 }
 
+QVector< QByteArray > LXQt::Wallet::Wallet::readValues( const QStringList& keys )
+{
+	QVector< QByteArray > e ;
+
+	e.reserve( keys.size() ) ;
+
+	for( const auto& it : keys ){
+
+		e.append( this->readValue( it ) ) ;
+	}
+
+	return e ;
+}
+
 LXQt::Wallet::Wallet * LXQt::Wallet::getWalletBackend( LXQt::Wallet::BackEnd bk )
 {
 	if( bk == LXQt::Wallet::BackEnd::internal ){
@@ -244,3 +258,61 @@ QStringList LXQt::Wallet::walletList( LXQt::Wallet::BackEnd bk )
 		return QStringList() ;
 	}
 }
+
+QString LXQt::Wallet::internalWalletKdfBenchmark( int milliseconds )
+{
+	QString s ;
+
+	auto _benchmark = [ & ]( lxqt_wallet_kdf kdf,const char * name ){
+
+		lxqt_wallet_kdf_parameters_t e ;
+		uint32_t duration ;
+
+		auto r = lxqt_wallet_kdf_calibrate( kdf,static_cast< uint32_t >( milliseconds ),&e,&duration ) ;
+
+		if( r != lxqt_wallet_no_error ){
+
+			s += QString( "%1: not supported\n" ).arg( name ) ;
+
+		}else if( kdf == lxqt_wallet_kdf_argon2id ){
+
+			auto m = QString( "%1: passes=%2 memory=%3KiB lanes=%4 time=%5ms\n" ) ;
+
+			s += m.arg( name ).arg( e.iterations ).arg( e.memory ).arg( e.parallelism ).arg( duration ) ;
+		}else{
+			auto m = QString( "%1: iterations=%2 time=%3ms\n" ) ;
+
+			s += m.arg( name ).arg( e.iterations ).arg( duration ) ;
+		}
+	} ;
+
+	_benchmark( lxqt_wallet_kdf_argon2id,"Argon2id" ) ;
+	_benchmark( lxqt_wallet_kdf_pbkdf2,"PBKDF2-SHA256" ) ;
+
+	return s ;
+}
+
+void LXQt::Wallet::setInternalWalletCalibratedKdf( bool e )
+{
+	lxqt_wallet_calibrated_kdf( e ? 1 : 0 ) ;
+}
+
+void LXQt::Wallet::setInternalWalletKeyCache( int minutes )
+{
+	if( minutes > 0 ){
+
+		lxqt_wallet_key_cache( static_cast< uint32_t >( minutes ) * 60 ) ;
+	}else{
+		lxqt_wallet_key_cache( 0 ) ;
+	}
+}
+
+void LXQt::Wallet::clearInternalWalletKeyCache( const QString& applicationName )
+{
+	if( applicationName.isEmpty() ){
+
+		lxqt_wallet_key_cache_clear( nullptr ) ;
+	}else{
+		lxqt_wallet_key_cache_clear( applicationName.toLatin1().constData() ) ;
+	}
+}
@@ -88,6 +88,32 @@ Q_DECL_EXPORT LXQt::Wallet::Wallet * getWalletBackend( LXQt::Wallet::BackEnd ) ;
  */
 QStringList walletList( LXQt::Wallet::BackEnd ) ;
 
+/*
+ * Find parameters of each key derivation function the internal backend supports that make
+ * opening a wallet take about "milliseconds" on this machine and return a report of them.
+ */
+Q_DECL_EXPORT QString internalWalletKdfBenchmark( int milliseconds = 250 ) ;
+
+/*
+ * Create internal wallets and change their passwords using key derivation function parameters
+ * calibrated for this machine.Wallets written this way can not be opened by older versions of
+ * the library.Off by default.
+ */
+Q_DECL_EXPORT void setInternalWalletCalibratedKdf( bool ) ;
+
+/*
+ * Keep keys of internal wallets in the kernel's session keyring for "minutes" minutes so that
+ * reopening a wallet in this or another process of the login session skips key derivation.
+ * 0 turns the cache off,which is the default.Only supported on linux.
+ */
+Q_DECL_EXPORT void setInternalWalletKeyCache( int minutes ) ;
+
+/*
+ * Remove cached keys of all internal wallets of "applicationName" or of all applications
+ * if it is empty.
+ */
+Q_DECL_EXPORT void clearInternalWalletKeyCache( const QString& applicationName = QString() ) ;
+
 /*
  * Below class is the interface that implements various backends.
  * See example at the end of this header file to see an example of how to use the interface.
@@ -117,6 +143,15 @@ public:
 	 */
 	virtual QByteArray readValue( const QString& key ) = 0 ;
 
+	/*
+	 * Get values of a list of keys,the returned values are in the same order as the keys
+	 * and a key that is not in the wallet gets an empty value.
+	 *
+	 * libsecret and kwallet backends fetch all values in one request to their services,
+	 * the default implementation calls readValue() for each key.
+	 */
+	virtual QVector< QByteArray > readValues( const QStringList& keys ) ;
+
 	/*
 	 * Get all keys and their respective values from the wallet.
 	 * First argument of std::pair is the key.
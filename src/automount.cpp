@@ -0,0 +1,392 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "automount.h"
+#include "utility.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QObject>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#endif
+
+static QStringList _components( const QString& e )
+{
+	return e.split( '/',QString::SkipEmptyParts ) ;
+}
+
+static bool _configFileExists( const favorites::entry& e )
+{
+	if( e.configFilePath != "N/A" && !e.configFilePath.isEmpty() ){
+
+		return utility::pathExists( e.configFilePath ) ;
+	}
+
+	const auto& m = e.volumePath ;
+
+	return utility::atLeastOnePathExists( m + "/cryfs.config",
+					      m + "/gocryptfs.conf",
+					      m + "/.securefs.json",
+					      m + "/.ecryptfs.config",
+					      m + "/.encfs6.xml",
+					      m + "/.encfs5",
+					      m + "/.encfs4" ) ;
+}
+
+static QString _nearestExistingPath( const favorites::entry& e )
+{
+	QString m ;
+
+	if( e.configFilePath != "N/A" && !e.configFilePath.isEmpty() ){
+
+		m = QFileInfo( e.configFilePath ).absolutePath() ;
+	}else{
+		m = e.volumePath ;
+	}
+
+	while( !m.isEmpty() && m != "/" ){
+
+		if( QFileInfo( m ).isDir() ){
+
+			return m ;
+		}
+
+		m = QFileInfo( m ).absolutePath() ;
+	}
+
+	return "/" ;
+}
+
+automount::automount( std::function< void( std::vector< favorites::entry > ) > e ) :
+	m_function( std::move( e ) )
+{
+#ifdef Q_OS_LINUX
+	m_inotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) ;
+
+	if( m_inotify != -1 ){
+
+		m_notifier = std::make_unique< QSocketNotifier >( m_inotify,QSocketNotifier::Read ) ;
+
+		QObject::connect( m_notifier.get(),&QSocketNotifier::activated,[ this ]( int ){
+
+			this->inotifyEvent() ;
+		} ) ;
+	}
+#endif
+}
+
+automount::~automount()
+{
+	m_notifier.reset() ;
+
+	if( m_inotify != -1 ){
+
+		::close( m_inotify ) ;
+	}
+}
+
+void automount::mounted( const QString& e )
+{
+	this->refresh() ;
+
+	auto m = _components( QString( e ).replace( "\\040"," " ) ) ;
+
+	const node * n = &m_root ;
+
+	for( const auto& it : m ){
+
+		auto s = n->children.find( it ) ;
+
+		if( s == n->children.end() ){
+
+			/*
+			 * No auto mount favorite lives under the new mount point and
+			 * hence none of the watches are affected by it.
+			 */
+			return ;
+		}
+
+		n = s->second.get() ;
+	}
+
+	std::vector< favorites::entry > s ;
+
+	this->collect( *n,s ) ;
+
+	/*
+	 * Only favorites under the new mount point may have become reachable,
+	 * re-evaluate their watches and leave the rest alone.
+	 */
+	this->watch( s ) ;
+
+	if( !s.empty() ){
+
+		m_function( std::move( s ) ) ;
+	}
+}
+
+void automount::favoritesChanged()
+{
+	m_generation = 0 ;
+
+	this->refresh() ;
+}
+
+void automount::refresh()
+{
+	auto e = utility::favoritesGeneration() ;
+
+	if( e != m_generation ){
+
+		m_generation = e ;
+
+		this->rebuild() ;
+		this->watch() ;
+	}
+}
+
+void automount::rebuild()
+{
+	m_root.children.clear() ;
+	m_root.entries.clear() ;
+
+	for( auto&& it : utility::readAutoMountFavorites() ){
+
+		node * n = &m_root ;
+
+		for( const auto& e : _components( it.volumePath ) ){
+
+			auto& s = n->children[ e ] ;
+
+			if( !s ){
+
+				s = std::make_unique< node >() ;
+			}
+
+			n = s.get() ;
+		}
+
+		n->entries.emplace_back( std::move( it ) ) ;
+	}
+}
+
+void automount::collect( const node& n,std::vector< favorites::entry >& e )
+{
+	for( const auto& it : n.entries ){
+
+		e.emplace_back( it ) ;
+	}
+
+	for( const auto& it : n.children ){
+
+		this->collect( *it.second,e ) ;
+	}
+}
+
+void automount::unwatch()
+{
+#ifdef Q_OS_LINUX
+	for( const auto& it : m_watches ){
+
+		inotify_rm_watch( m_inotify,it.first ) ;
+	}
+#endif
+	m_watches.clear() ;
+	m_pending.clear() ;
+}
+
+void automount::unwatch( const QString& volumePath )
+{
+	auto it = m_pending.find( volumePath ) ;
+
+	if( it == m_pending.end() ){
+
+		return ;
+	}
+
+	auto s = m_watches.find( it->second.wd ) ;
+
+	if( s != m_watches.end() && --s->second == 0 ){
+#ifdef Q_OS_LINUX
+		inotify_rm_watch( m_inotify,s->first ) ;
+#endif
+		m_watches.erase( s ) ;
+	}
+
+	m_pending.erase( it ) ;
+}
+
+void automount::watch()
+{
+	this->unwatch() ;
+
+	std::vector< favorites::entry > e ;
+
+	this->collect( m_root,e ) ;
+
+	this->watch( e ) ;
+}
+
+void automount::watch( const std::vector< favorites::entry >& e )
+{
+#ifdef Q_OS_LINUX
+	if( m_inotify == -1 || !utility::autoMountFavoritesOnAvailable() ){
+
+		return ;
+	}
+
+	auto flags = IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR ;
+
+	for( const auto& it : e ){
+
+		if( it.volumePath.startsWith( "sshfs " ) || _configFileExists( it ) ){
+
+			this->unwatch( it.volumePath ) ;
+
+			continue ;
+		}
+
+		auto m = _nearestExistingPath( it ) ;
+
+		auto s = m_pending.find( it.volumePath ) ;
+
+		if( s != m_pending.end() && s->second.path == m ){
+
+			/*
+			 * Removing and adding back the same watch would queue an
+			 * IN_IGNORED event and wake us up again.
+			 */
+			s->second.entry = it ;
+
+			continue ;
+		}
+
+		this->unwatch( it.volumePath ) ;
+
+		/*
+		 * inotify returns the same watch descriptor for a path that is
+		 * already watched.
+		 */
+		auto wd = inotify_add_watch( m_inotify,m.toLocal8Bit().constData(),flags ) ;
+
+		if( wd != -1 ){
+
+			m_watches[ wd ]++ ;
+
+			m_pending[ it.volumePath ] = { it,m,wd } ;
+		}
+	}
+#else
+	Q_UNUSED( e ) ;
+#endif
+}
+
+void automount::inotifyEvent()
+{
+#ifdef Q_OS_LINUX
+	alignas( struct inotify_event ) char buffer[ 4096 ] ;
+
+	bool relevant = false ;
+
+	while( true ){
+
+		auto n = read( m_inotify,buffer,sizeof( buffer ) ) ;
+
+		if( n <= 0 ){
+
+			break ;
+		}
+
+		for( decltype( n ) i = 0 ; i + static_cast< decltype( n ) >( sizeof( struct inotify_event ) ) <= n ; ){
+
+			auto ev = reinterpret_cast< const struct inotify_event * >( buffer + i ) ;
+
+			/*
+			 * IN_IGNORED follows the removal of a watch.Watches we removed
+			 * ourselves are already gone from m_watches,one that is still
+			 * there was removed by the kernel because its folder was deleted.
+			 */
+			auto w = m_watches.find( ev->wd ) ;
+
+			if( w != m_watches.end() ){
+
+				relevant = true ;
+
+				if( ev->mask & IN_IGNORED ){
+
+					m_watches.erase( w ) ;
+
+					for( auto& it : m_pending ){
+
+						if( it.second.wd == ev->wd ){
+
+							/*
+							 * Makes watch() add a new watch.
+							 */
+							it.second.path.clear() ;
+						}
+					}
+				}
+			}
+
+			i += static_cast< decltype( n ) >( sizeof( struct inotify_event ) + ev->len ) ;
+		}
+	}
+
+	if( !relevant || !utility::autoMountFavoritesOnAvailable() ){
+
+		return ;
+	}
+
+	this->refresh() ;
+
+	std::vector< favorites::entry > e ;
+
+	std::vector< favorites::entry > pending ;
+
+	for( const auto& it : m_pending ){
+
+		if( _configFileExists( it.second.entry ) ){
+
+			e.emplace_back( it.second.entry ) ;
+		}
+
+		pending.emplace_back( it.second.entry ) ;
+	}
+
+	/*
+	 * A path component we were waiting for may have been created,move the
+	 * watches of waiting favorites as close as possible to their cipher folders.
+	 */
+	this->watch( pending ) ;
+
+	if( !e.empty() ){
+
+		m_function( std::move( e ) ) ;
+	}
+#endif
+}
@@ -0,0 +1,97 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AUTOMOUNT_H
+#define AUTOMOUNT_H
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "favorites.h"
+
+class QSocketNotifier ;
+
+/*
+ * This class decides what auto mount favorites should be unlocked when a new volume
+ * is mounted or when a cipher folder shows up on an already mounted file system.
+ *
+ * Auto mount favorites are kept in a trie keyed by path components and hence finding
+ * favorites that live under a new mount point costs O(length of the mount point path)
+ * regardless of how many favorites there are.
+ *
+ * On linux,inotify watches are placed on the nearest existing ancestor of every auto
+ * mount favorite whose config file is missing and the favorite is unlocked when its
+ * config file appears.
+ */
+class automount
+{
+public:
+	automount( std::function< void( std::vector< favorites::entry > ) > ) ;
+
+	void mounted( const QString& mountPoint ) ;
+
+	void favoritesChanged() ;
+
+	~automount() ;
+private:
+	struct node
+	{
+		std::map< QString,std::unique_ptr< node > > children ;
+		std::vector< favorites::entry > entries ;
+	};
+
+	struct pending
+	{
+		favorites::entry entry ;
+		QString path ;
+		int wd ;
+	};
+
+	void refresh() ;
+	void rebuild() ;
+	void watch() ;
+	void watch( const std::vector< favorites::entry >& ) ;
+	void unwatch() ;
+	void unwatch( const QString& volumePath ) ;
+	void inotifyEvent() ;
+	void collect( const node&,std::vector< favorites::entry >& ) ;
+
+	std::function< void( std::vector< favorites::entry > ) > m_function ;
+
+	node m_root ;
+	quint64 m_generation = 0 ;
+
+	/*
+	 * Favorites waiting for their config file keyed by their volume path and
+	 * the number of favorites sharing each inotify watch.
+	 */
+	std::map< QString,pending > m_pending ;
+	std::map< int,int > m_watches ;
+
+	int m_inotify = -1 ;
+	std::unique_ptr< QSocketNotifier > m_notifier ;
+};
+
+#endif // AUTOMOUNT_H
@@ -0,0 +1,495 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "backendresources.h"
+
+#include <QObject>
+
+#ifdef Q_OS_LINUX
+
+#include "openfiles.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <algorithm>
+#include <string>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * IOPRIO_WHO_PROCESS and io scheduling classes,glibc does not export them.
+ */
+static const int _ioprio_who_process = 1 ;
+static const int _ioprio_class_shift = 13 ;
+static const int _ioprio_class_be    = 2 ;
+static const int _ioprio_class_idle  = 3 ;
+
+static QByteArray _read( const QString& path )
+{
+	QFile f( path ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		return f.readAll().trimmed() ;
+	}else{
+		return QByteArray() ;
+	}
+}
+
+static bool _write( const QString& path,const QByteArray& e )
+{
+	QFile f( path ) ;
+
+	return f.open( QIODevice::WriteOnly ) && f.write( e ) == e.size() ;
+}
+
+/*
+ * The cgroup of the user's service manager,systemd delegates it to the user.
+ */
+static QString _delegated_root()
+{
+	if( !QFile::exists( "/sys/fs/cgroup/cgroup.controllers" ) ){
+
+		return QString() ;
+	}
+
+	for( const auto& it : _read( "/proc/self/cgroup" ).split( '\n' ) ){
+
+		if( !it.startsWith( "0::" ) ){
+
+			continue ;
+		}
+
+		auto path = QString::fromUtf8( it.mid( 3 ) ) ;
+
+		auto m = path.indexOf( "/user@" ) ;
+
+		if( m == -1 ){
+
+			return QString() ;
+		}
+
+		auto n = path.indexOf( ".service",m ) ;
+
+		if( n == -1 ){
+
+			return QString() ;
+		}
+
+		auto root = "/sys/fs/cgroup" + path.left( n + 8 ) ;
+
+		QFileInfo procs( root + "/cgroup.procs" ) ;
+		QFileInfo control( root + "/cgroup.subtree_control" ) ;
+
+		if( procs.isWritable() && control.isWritable() ){
+
+			return root ;
+		}else{
+			return QString() ;
+		}
+	}
+
+	return QString() ;
+}
+
+static QString _slice( const QString& root )
+{
+	return root + "/sirikali.slice" ;
+}
+
+static QString _cgroup_name( const QString& mountPoint )
+{
+	auto m = QDir::cleanPath( mountPoint ).toUtf8() ;
+
+	auto e = QCryptographicHash::hash( m,QCryptographicHash::Sha256 ) ;
+
+	return "volume-" + e.toHex().left( 16 ) ;
+}
+
+static QString _cgroup( const QString& mountPoint,const favorites::entry::resources& e )
+{
+	if( e.memoryMax.isEmpty() && e.cpuMax <= 0 ){
+
+		return QString() ;
+	}
+
+	auto root = _delegated_root() ;
+
+	if( root.isEmpty() ){
+
+		return QString() ;
+	}
+
+	auto slice = _slice( root ) ;
+
+	QDir().mkpath( slice ) ;
+
+	auto available = _read( slice + "/cgroup.controllers" ).split( ' ' ) ;
+
+	QByteArray controllers ;
+
+	if( !e.memoryMax.isEmpty() && available.contains( "memory" ) ){
+
+		controllers += "+memory " ;
+	}
+
+	if( e.cpuMax > 0 && available.contains( "cpu" ) ){
+
+		controllers += "+cpu " ;
+	}
+
+	if( controllers.isEmpty() || !_write( slice + "/cgroup.subtree_control",controllers.trimmed() ) ){
+
+		return QString() ;
+	}
+
+	auto m = slice + "/" + _cgroup_name( mountPoint ) ;
+
+	QDir().mkpath( m ) ;
+
+	if( !e.memoryMax.isEmpty() ){
+
+		_write( m + "/memory.max",e.memoryMax.toLatin1() ) ;
+	}
+
+	if( e.cpuMax > 0 ){
+
+		_write( m + "/cpu.max",QString( "%1 100000" ).arg( e.cpuMax * 1000 ).toLatin1() ) ;
+	}
+
+	return m ;
+}
+
+static bool _cpu_set( const QString& e,cpu_set_t& s )
+{
+	CPU_ZERO( &s ) ;
+
+	bool ok = false ;
+
+	for( const auto& it : e.split( ',',QString::SkipEmptyParts ) ){
+
+		auto m = it.split( '-' ) ;
+
+		bool a ;
+		bool b = true ;
+
+		int first = m.at( 0 ).trimmed().toInt( &a ) ;
+		int last  = m.size() > 1 ? m.at( 1 ).trimmed().toInt( &b ) : first ;
+
+		if( !a || !b || m.size() > 2 || first < 0 || last < first || last >= CPU_SETSIZE ){
+
+			return false ;
+		}
+
+		for( int i = first ; i <= last ; i++ ){
+
+			CPU_SET( i,&s ) ;
+
+			ok = true ;
+		}
+	}
+
+	return ok ;
+}
+
+std::function< void() > backendResources::childSetup( const favorites::entry::resources& e,
+						      const QString& mountPoint )
+{
+	if( !e.isSet() ){
+
+		return [](){} ;
+	}
+
+	struct setup
+	{
+		int nice ;
+		int ioprio ;
+		bool affinity ;
+		cpu_set_t cpus ;
+		std::string procs ;
+	} s ;
+
+	s.nice = e.nice ;
+
+	if( e.ioClass == "idle" ){
+
+		s.ioprio = _ioprio_class_idle << _ioprio_class_shift ;
+
+	}else if( e.ioClass == "best-effort" ){
+
+		/*
+		 * The kernel derives the priority level within the class from the nice
+		 * level,do the same.
+		 */
+		auto level = std::min( 7,std::max( 0,( e.nice + 20 ) / 5 ) ) ;
+
+		s.ioprio = ( _ioprio_class_be << _ioprio_class_shift ) | level ;
+	}else{
+		s.ioprio = -1 ;
+	}
+
+	s.affinity = _cpu_set( e.cpuAffinity,s.cpus ) ;
+
+	auto cgroup = _cgroup( mountPoint,e ) ;
+
+	if( !cgroup.isEmpty() ){
+
+		s.procs = QFile::encodeName( cgroup + "/cgroup.procs" ).constData() ;
+	}
+
+	return [ s ](){
+
+		if( s.nice != 0 ){
+
+			setpriority( PRIO_PROCESS,0,s.nice ) ;
+		}
+
+		if( s.ioprio != -1 ){
+
+			syscall( SYS_ioprio_set,_ioprio_who_process,0,s.ioprio ) ;
+		}
+
+		if( s.affinity ){
+
+			sched_setaffinity( 0,sizeof( s.cpus ),&s.cpus ) ;
+		}
+
+		if( !s.procs.empty() ){
+
+			int fd = open( s.procs.c_str(),O_WRONLY | O_CLOEXEC ) ;
+
+			if( fd != -1 ){
+
+				auto r = write( fd,"0",1 ) ;
+
+				Q_UNUSED( r ) ;
+
+				close( fd ) ;
+			}
+		}
+	} ;
+}
+
+qint64 backendResources::release( const QString& mountPoint )
+{
+	auto root = _delegated_root() ;
+
+	if( root.isEmpty() ){
+
+		return -1 ;
+	}
+
+	auto cgroup = _slice( root ) + "/" + _cgroup_name( mountPoint ) ;
+
+	if( !QFile::exists( cgroup ) || QDir().rmdir( cgroup ) ){
+
+		return -1 ;
+	}
+
+	/*
+	 * A cgroup can not be removed while it has processes.
+	 */
+	for( const auto& it : _read( cgroup + "/cgroup.procs" ).split( '\n' ) ){
+
+		bool ok ;
+
+		auto pid = it.trimmed().toLongLong( &ok ) ;
+
+		if( ok ){
+
+			return pid ;
+		}
+	}
+
+	return -1 ;
+}
+
+static QString _cpu_list( const cpu_set_t& s )
+{
+	QStringList e ;
+
+	for( int i = 0 ; i < CPU_SETSIZE ; i++ ){
+
+		if( !CPU_ISSET( i,&s ) ){
+
+			continue ;
+		}
+
+		int j = i ;
+
+		while( j + 1 < CPU_SETSIZE && CPU_ISSET( j + 1,&s ) ){
+
+			j++ ;
+		}
+
+		if( i == j ){
+
+			e.append( QString::number( i ) ) ;
+		}else{
+			e.append( QString( "%1-%2" ).arg( QString::number( i ),QString::number( j ) ) ) ;
+		}
+
+		i = j ;
+	}
+
+	return e.join( "," ) ;
+}
+
+static QString _megabytes( qint64 e )
+{
+	return QString::number( double( e ) / ( 1024 * 1024 ),'f',1 ) + " MiB" ;
+}
+
+QString backendResources::usage( const QString& mountPoint )
+{
+	QStringList e ;
+
+	auto pid = openFiles::backend( mountPoint ) ;
+
+	if( pid != -1 ){
+
+		auto proc = "/proc/" + QString::number( pid ) ;
+
+		e.append( QObject::tr( "Backend Pid: %1" ).arg( pid ) ) ;
+
+		/*
+		 * Fields after the command name,which may contain spaces,starting with
+		 * the process state in the third field.
+		 */
+		auto stat = _read( proc + "/stat" ) ;
+
+		auto m = stat.mid( stat.lastIndexOf( ')' ) + 2 ).split( ' ' ) ;
+
+		if( m.size() > 16 ){
+
+			auto ticks = double( sysconf( _SC_CLK_TCK ) ) ;
+
+			auto cpu = ( m.at( 11 ).toLongLong() + m.at( 12 ).toLongLong() ) / ticks ;
+
+			e.append( QObject::tr( "CPU Time: %1 Seconds" ).arg( QString::number( cpu,'f',2 ) ) ) ;
+			e.append( QObject::tr( "Nice Level: %1" ).arg( QString( m.at( 16 ) ) ) ) ;
+		}
+
+		for( const auto& it : _read( proc + "/status" ).split( '\n' ) ){
+
+			if( it.startsWith( "VmRSS:" ) ){
+
+				e.append( QObject::tr( "Resident Memory: %1" ).arg( QString( it.mid( 6 ).trimmed() ) ) ) ;
+			}
+		}
+
+		auto io = syscall( SYS_ioprio_get,_ioprio_who_process,static_cast< int >( pid ) ) ;
+
+		if( io >= 0 ){
+
+			auto s = io >> _ioprio_class_shift ;
+
+			if( s == _ioprio_class_idle ){
+
+				e.append( QObject::tr( "IO Priority Class: Idle" ) ) ;
+
+			}else if( s == _ioprio_class_be ){
+
+				e.append( QObject::tr( "IO Priority Class: Best Effort" ) ) ;
+			}
+		}
+
+		cpu_set_t cpus ;
+
+		if( sched_getaffinity( static_cast< pid_t >( pid ),sizeof( cpus ),&cpus ) == 0 ){
+
+			e.append( QObject::tr( "CPU Affinity: %1" ).arg( _cpu_list( cpus ) ) ) ;
+		}
+	}else{
+		e.append( QObject::tr( "Backend Process Not Found." ) ) ;
+	}
+
+	auto root = _delegated_root() ;
+
+	auto cgroup = _slice( root ) + "/" + _cgroup_name( mountPoint ) ;
+
+	if( !root.isEmpty() && QFile::exists( cgroup ) ){
+
+		e.append( QString() ) ;
+		e.append( QObject::tr( "Cgroup: %1" ).arg( cgroup ) ) ;
+
+		auto memory = _read( cgroup + "/memory.current" ) ;
+
+		if( !memory.isEmpty() ){
+
+			e.append( QObject::tr( "Memory Used: %1" ).arg( _megabytes( memory.toLongLong() ) ) ) ;
+			e.append( QObject::tr( "Memory Limit: %1" ).arg( QString( _read( cgroup + "/memory.max" ) ) ) ) ;
+		}
+
+		for( const auto& it : _read( cgroup + "/cpu.stat" ).split( '\n' ) ){
+
+			if( it.startsWith( "usage_usec " ) ){
+
+				auto s = it.mid( 11 ).toLongLong() / 1000000.0 ;
+
+				e.append( QObject::tr( "CPU Used: %1 Seconds" ).arg( QString::number( s,'f',2 ) ) ) ;
+			}
+		}
+
+		auto cpu = _read( cgroup + "/cpu.max" ) ;
+
+		if( !cpu.isEmpty() ){
+
+			e.append( QObject::tr( "CPU Limit: %1" ).arg( QString( cpu ) ) ) ;
+		}
+	}
+
+	return e.join( "\n" ) ;
+}
+
+#else
+
+std::function< void() > backendResources::childSetup( const favorites::entry::resources& e,
+						      const QString& mountPoint )
+{
+	Q_UNUSED( e ) ;
+	Q_UNUSED( mountPoint ) ;
+
+	return [](){} ;
+}
+
+qint64 backendResources::release( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	return -1 ;
+}
+
+QString backendResources::usage( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	return QObject::tr( "Not Supported On This Platform." ) ;
+}
+
+#endif
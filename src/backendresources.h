@@ -0,0 +1,58 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKEND_RESOURCES_H
+#define BACKEND_RESOURCES_H
+
+#include <QString>
+
+#include <functional>
+
+#include "favorites.h"
+
+/*
+ * Applies per favorite resource limits to backend processes.Nice level,io priority
+ * and cpu affinity are set directly on the backend and are inherited when it forks
+ * to the background.Memory and cpu caps are enforced by moving the backend into
+ * its own cgroup under "sirikali.slice" in the user's delegated cgroup v2 tree and
+ * they are skipped when there is no such tree.Only implemented on linux.
+ */
+namespace backendResources
+{
+	/*
+	 * Returns a function to run in the backend process between fork() and exec().
+	 * Cgroups are created here,the returned function only makes async signal safe
+	 * calls.
+	 */
+	std::function< void() > childSetup( const favorites::entry::resources&,const QString& mountPoint ) ;
+
+	/*
+	 * Removes the cgroup of a volume.A cgroup that still has a process in it is
+	 * left alone and the pid of the process is returned,-1 is returned otherwise.
+	 */
+	qint64 release( const QString& mountPoint ) ;
+
+	/*
+	 * A human readable summary of resources used by the backend of a volume.
+	 */
+	QString usage( const QString& mountPoint ) ;
+}
+
+#endif
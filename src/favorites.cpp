@@ -20,6 +20,7 @@
 #include "favorites.h"
 #include "ui_favorites.h"
 #include <iostream>
+#include <algorithm>
 
 #include <QTableWidgetItem>
 #include <QCloseEvent>
@@ -27,10 +28,18 @@
 #include <QMessageBox>
 #include <QAction>
 #include <QMenu>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QFormLayout>
+#include <QSpinBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QThread>
 
 #include "utility.h"
 #include "dialogmsg.h"
 #include "tablewidget.h"
+#include "favoritesstore.h"
 
 favorites::favorites( QWidget * parent,favorites::type type ) : QDialog( parent ),
 	m_ui( new Ui::favorites )
@@ -88,6 +97,18 @@ favorites::favorites( QWidget * parent,favorites::type type ) : QDialog( parent
 
 	this->installEventFilter( this ) ;
 
+	connect( &favoritesStore::instance(),&favoritesStore::changed,this,[ this ](){
+
+		/*
+		 * Only reload when somebody else changed favorites,our own changes
+		 * are already in the table.
+		 */
+		if( m_generation != favoritesStore::instance().generation() ){
+
+			this->loadEntries() ;
+		}
+	} ) ;
+
 	utility::setParent( parent,&m_parentWidget,this ) ;
 
 	utility::setWindowOptions( this ) ;
@@ -162,20 +183,7 @@ void favorites::ShowUI( favorites::type type )
 	m_ui->tableWidget->setColumnWidth( 0,285 ) ;
 	m_ui->tableWidget->setColumnWidth( 1,285 ) ;
 
-	tablewidget::clearTable( m_ui->tableWidget ) ;
-
-	auto _add_entry = [ this ]( const QStringList& l ){
-
-		if( l.size() > 1 ){
-
-			this->addEntries( l ) ;
-		}
-	} ;
-
-	for( const auto& it : utility::readFavorites() ){
-
-		_add_entry( it.list() ) ;
-	}
+	this->loadEntries() ;
 
 	m_ui->lineEditEncryptedFolderPath->clear() ;
 
@@ -202,6 +210,26 @@ void favorites::ShowUI( favorites::type type )
 	this->activateWindow() ;
 }
 
+void favorites::loadEntries()
+{
+	tablewidget::clearTable( m_ui->tableWidget ) ;
+
+	auto _add_entry = [ this ]( const QStringList& l ){
+
+		if( l.size() > 1 ){
+
+			this->addEntries( l ) ;
+		}
+	} ;
+
+	for( const auto& it : favoritesStore::instance().entries() ){
+
+		_add_entry( it.list() ) ;
+	}
+
+	m_generation = favoritesStore::instance().generation() ;
+}
+
 void favorites::HideUI()
 {
 	this->hide() ;
@@ -249,6 +277,31 @@ void favorites::itemClicked( QTableWidgetItem * current,bool clicked )
 		connect( m.addAction( tr( "Toggle AutoMount" ) ),
 			 SIGNAL( triggered() ),this,SLOT( toggleAutoMount() ) ) ;
 
+		auto ac = m.addAction( tr( "Lazy Unmount When Busy" ) ) ;
+
+		auto volume = m_ui->tableWidget->item( current->row(),0 )->text() ;
+
+		ac->setCheckable( true ) ;
+		ac->setChecked( favoritesStore::instance().volumePath( volume ).lazyUnmount ) ;
+
+		connect( ac,SIGNAL( triggered( bool ) ),this,SLOT( toggleLazyUnmount( bool ) ) ) ;
+
+		auto rm = m.addAction( tr( "Remount If The Backend Dies" ) ) ;
+
+		rm->setCheckable( true ) ;
+		rm->setChecked( favoritesStore::instance().volumePath( volume ).autoRemount ) ;
+
+		connect( rm,SIGNAL( triggered( bool ) ),this,SLOT( toggleAutoRemount( bool ) ) ) ;
+
+		connect( m.addAction( tr( "Set Tags" ) ),
+			 SIGNAL( triggered() ),this,SLOT( setTags() ) ) ;
+
+		connect( m.addAction( tr( "Set Warm Up Depth" ) ),
+			 SIGNAL( triggered() ),this,SLOT( setWarmUpDepth() ) ) ;
+
+		connect( m.addAction( tr( "Set Resource Limits" ) ),
+			 SIGNAL( triggered() ),this,SLOT( setResourceLimits() ) ) ;
+
 		m.addSeparator() ;
 
 		connect( m.addAction( tr( "Edit" ) ),
@@ -313,6 +366,194 @@ void favorites::toggleAutoMount()
 		auto f = this->getEntry( row ) ;
 
 		utility::replaceFavorite( e,f ) ;
+
+		m_generation = favoritesStore::instance().generation() ;
+	}
+}
+
+void favorites::toggleLazyUnmount( bool e )
+{
+	auto table = m_ui->tableWidget ;
+
+	if( table->rowCount() > 0 ){
+
+		auto volume = table->item( table->currentRow(),0 )->text() ;
+
+		favoritesStore::instance().modify( volume,[ e ]( favorites::entry& s ){
+
+			s.lazyUnmount = e ;
+		} ) ;
+
+		m_generation = favoritesStore::instance().generation() ;
+	}
+}
+
+void favorites::toggleAutoRemount( bool e )
+{
+	auto table = m_ui->tableWidget ;
+
+	if( table->rowCount() > 0 ){
+
+		auto volume = table->item( table->currentRow(),0 )->text() ;
+
+		favoritesStore::instance().modify( volume,[ e ]( favorites::entry& s ){
+
+			s.autoRemount = e ;
+		} ) ;
+
+		m_generation = favoritesStore::instance().generation() ;
+	}
+}
+
+void favorites::setTags()
+{
+	auto table = m_ui->tableWidget ;
+
+	if( table->rowCount() > 0 ){
+
+		auto volume = table->item( table->currentRow(),0 )->text() ;
+
+		auto& store = favoritesStore::instance() ;
+
+		auto tags = store.volumePath( volume ).tags.join( "," ) ;
+
+		bool ok ;
+
+		tags = QInputDialog::getText( this,
+					      tr( "Set Tags" ),
+					      tr( "Comma Separated List Of Tags:" ),
+					      QLineEdit::Normal,
+					      tags,
+					      &ok ) ;
+		if( ok ){
+
+			store.modify( volume,[ & ]( favorites::entry& s ){
+
+				s.tags.clear() ;
+
+				for( const auto& it : tags.split( ',',QString::SkipEmptyParts ) ){
+
+					auto e = it.trimmed() ;
+
+					if( !e.isEmpty() ){
+
+						s.tags.append( e ) ;
+					}
+				}
+			} ) ;
+
+			m_generation = store.generation() ;
+		}
+	}
+}
+
+void favorites::setWarmUpDepth()
+{
+	auto table = m_ui->tableWidget ;
+
+	if( table->rowCount() > 0 ){
+
+		auto volume = table->item( table->currentRow(),0 )->text() ;
+
+		auto& store = favoritesStore::instance() ;
+
+		bool ok ;
+
+		auto depth = QInputDialog::getInt( this,
+						   tr( "Set Warm Up Depth" ),
+						   tr( "Folder Levels To Read After Unlocking(0 Disables It):" ),
+						   store.volumePath( volume ).warmUpDepth,
+						   0,
+						   64,
+						   1,
+						   &ok ) ;
+		if( ok ){
+
+			store.modify( volume,[ depth ]( favorites::entry& s ){
+
+				s.warmUpDepth = depth ;
+			} ) ;
+
+			m_generation = store.generation() ;
+		}
+	}
+}
+
+void favorites::setResourceLimits()
+{
+	auto table = m_ui->tableWidget ;
+
+	if( table->rowCount() == 0 ){
+
+		return ;
+	}
+
+	auto volume = table->item( table->currentRow(),0 )->text() ;
+
+	auto& store = favoritesStore::instance() ;
+
+	auto r = store.volumePath( volume ).resources ;
+
+	QDialog d( this ) ;
+
+	d.setWindowTitle( tr( "Set Resource Limits" ) ) ;
+
+	auto layout = new QFormLayout( &d ) ;
+
+	auto nice = new QSpinBox( &d ) ;
+
+	nice->setRange( -20,19 ) ;
+	nice->setValue( r.nice ) ;
+
+	auto ioClass = new QComboBox( &d ) ;
+
+	ioClass->addItem( tr( "Default" ),QString() ) ;
+	ioClass->addItem( tr( "Best Effort" ),QString( "best-effort" ) ) ;
+	ioClass->addItem( tr( "Idle" ),QString( "idle" ) ) ;
+	ioClass->setCurrentIndex( std::max( 0,ioClass->findData( r.ioClass ) ) ) ;
+
+	auto cpuAffinity = new QLineEdit( r.cpuAffinity,&d ) ;
+
+	cpuAffinity->setPlaceholderText( "0-3,6" ) ;
+
+	auto memoryMax = new QLineEdit( r.memoryMax,&d ) ;
+
+	memoryMax->setPlaceholderText( "512M" ) ;
+
+	auto cpuMax = new QSpinBox( &d ) ;
+
+	cpuMax->setRange( 0,100 * std::max( 1,QThread::idealThreadCount() ) ) ;
+	cpuMax->setSuffix( "%" ) ;
+	cpuMax->setSpecialValueText( tr( "No Limit" ) ) ;
+	cpuMax->setValue( r.cpuMax ) ;
+
+	layout->addRow( tr( "Nice Level:" ),nice ) ;
+	layout->addRow( tr( "IO Priority Class:" ),ioClass ) ;
+	layout->addRow( tr( "CPU Affinity:" ),cpuAffinity ) ;
+	layout->addRow( tr( "Memory Limit:" ),memoryMax ) ;
+	layout->addRow( tr( "CPU Limit:" ),cpuMax ) ;
+
+	auto buttons = new QDialogButtonBox( QDialogButtonBox::Ok | QDialogButtonBox::Cancel,&d ) ;
+
+	connect( buttons,SIGNAL( accepted() ),&d,SLOT( accept() ) ) ;
+	connect( buttons,SIGNAL( rejected() ),&d,SLOT( reject() ) ) ;
+
+	layout->addRow( buttons ) ;
+
+	if( d.exec() == QDialog::Accepted ){
+
+		r.nice        = nice->value() ;
+		r.ioClass     = ioClass->currentData().toString() ;
+		r.cpuAffinity = cpuAffinity->text().trimmed() ;
+		r.memoryMax   = memoryMax->text().trimmed() ;
+		r.cpuMax      = cpuMax->value() ;
+
+		store.modify( volume,[ & ]( favorites::entry& s ){
+
+			s.resources = r ;
+		} ) ;
+
+		m_generation = store.generation() ;
 	}
 }
 
@@ -328,6 +569,8 @@ void favorites::removeEntryFromFavoriteList()
 
 		utility::removeFavoriteEntry( this->getEntry( row ) ) ;
 
+		m_generation = favoritesStore::instance().generation() ;
+
 		tablewidget::deleteRow( table,row ) ;
 
 		table->setEnabled( true ) ;
@@ -402,6 +645,8 @@ void favorites::add()
 
 			utility::replaceFavorite( f,e ) ;
 
+			m_generation = favoritesStore::instance().generation() ;
+
 			tablewidget::updateRow( m_ui->tableWidget,e,row ) ;
 
 			m_ui->pbAdd->setText( tr( "Add" ) ) ;
@@ -415,6 +660,7 @@ void favorites::add()
 	}else{
 		tablewidget::addRow( m_ui->tableWidget,e ) ;
 		utility::addToFavorite( e ) ;
+		m_generation = favoritesStore::instance().generation() ;
 		m_ui->lineEditEncryptedFolderPath->clear() ;
 		m_ui->lineEditMountPath->clear() ;
 	}
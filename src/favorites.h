@@ -59,7 +59,22 @@ public:
 		{
 			if( e ){
 
-				return this->configString().split( '\t',QString::SkipEmptyParts ) ;
+				auto _opt = [ ]( const QString& e )->QString{
+
+					if( e.isEmpty() ){
+
+						return "N/A" ;
+					}else{
+						return e ;
+					}
+				} ;
+
+				return { volumePath,
+					 mountPointPath,
+					 autoMountVolume,
+					 _opt( configFilePath ),
+					 _opt( idleTimeOut ),
+					 _opt( mountOptions ) } ;
 			}else{
 				return { volumePath,
 					 mountPointPath,
@@ -124,6 +139,36 @@ public:
 		QString idleTimeOut ;
 		QString mountOptions ;
 
+		/*
+		 * Options below are not shown in the favorites table and are not
+		 * part of the comparison above.
+		 */
+		bool lazyUnmount = false ;
+		bool autoRemount = false ;
+		QStringList tags ;
+		int warmUpDepth = 0 ;
+
+		/*
+		 * Applied to the backend process of the volume,the memory and cpu
+		 * caps need a delegated cgroup v2 tree.
+		 */
+		struct resources
+		{
+			bool isSet() const
+			{
+				return nice != 0 ||
+				       !ioClass.isEmpty() ||
+				       !cpuAffinity.isEmpty() ||
+				       !memoryMax.isEmpty() ||
+				       cpuMax > 0 ;
+			}
+			int nice = 0 ;
+			QString ioClass ;     // empty,"best-effort" or "idle"
+			QString cpuAffinity ; // a cpu list like "0-3,6"
+			QString memoryMax ;   // bytes with an optional K,M or G suffix
+			int cpuMax = 0 ;      // percent of one cpu,0 means no cap
+		} resources ;
+
 	private:
 		void config( const QStringList& e )
 		{
@@ -163,6 +208,11 @@ signals:
 	void ShowPartitionUI( void ) ;
 private slots:
 	void toggleAutoMount( void ) ;
+	void toggleLazyUnmount( bool ) ;
+	void toggleAutoRemount( bool ) ;
+	void setTags( void ) ;
+	void setWarmUpDepth( void ) ;
+	void setResourceLimits( void ) ;
 	void edit( void ) ;
 	void configPath( void ) ;
 	void removeEntryFromFavoriteList( void ) ;
@@ -185,8 +235,10 @@ private:
 	void closeEvent( QCloseEvent * ) ;
 	bool eventFilter( QObject * watched,QEvent * event ) ;
 	void addEntries( const QStringList& ) ;
+	void loadEntries( void ) ;
 	Ui::favorites * m_ui ;
 	QWidget * m_parentWidget ;
+	quint64 m_generation = 0 ;
 };
 
 #endif // MANAGEDEVICENAMES_H
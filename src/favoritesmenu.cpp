@@ -0,0 +1,236 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "favoritesmenu.h"
+#include "favoritesstore.h"
+
+#include <QMenu>
+#include <QAction>
+#include <QLineEdit>
+#include <QWidgetAction>
+#include <QTimer>
+
+/*
+ * Lists with more entries than this get a filter field.
+ */
+static const int _filter_threshold = 10 ;
+
+favoritesMenu::favoritesMenu( QMenu * m,QObject * parent ) : QObject( parent ),m_menu( m )
+{
+	connect( m_menu,&QMenu::aboutToShow,this,&favoritesMenu::aboutToShow ) ;
+
+	connect( m_menu,&QMenu::aboutToHide,this,[ this ](){
+
+		if( m_filter ){
+
+			m_filter->clear() ;
+		}
+	} ) ;
+
+	connect( m_menu,&QMenu::triggered,this,[ this ]( QAction * ac ){
+
+		/*
+		 * Clicking a checkable entry toggles it,keep it showing mount state.
+		 */
+		auto e = ac->objectName() ;
+
+		if( m_actions.contains( e ) ){
+
+			ac->setChecked( m_mounted.contains( e ) ) ;
+		}
+	} ) ;
+
+	connect( &favoritesStore::instance(),&favoritesStore::changed,
+		 this,&favoritesMenu::favoritesChanged ) ;
+}
+
+void favoritesMenu::aboutToShow()
+{
+	if( !m_built ){
+
+		this->build() ;
+	}
+
+	if( m_filterAction->isVisible() ){
+
+		QTimer::singleShot( 0,m_filter,SLOT( setFocus() ) ) ;
+	}
+}
+
+void favoritesMenu::build()
+{
+	m_built = true ;
+
+	m_menu->clear() ;
+	m_actions.clear() ;
+
+	auto _add_action = [ this ]( const QString& e,const QString& s ){
+
+		auto ac = new QAction( m_menu ) ;
+
+		ac->setText( e ) ;
+		ac->setObjectName( s ) ;
+
+		return ac ;
+	} ;
+
+	m_menu->addAction( _add_action( QObject::tr( "Manage Favorites" ),"Manage Favorites" ) ) ;
+	m_menu->addAction( _add_action( QObject::tr( "Mount All" ),"Mount All" ) ) ;
+
+	m_menu->addSeparator() ;
+
+	m_filter = new QLineEdit( m_menu ) ;
+
+	m_filter->setPlaceholderText( QObject::tr( "Filter" ) ) ;
+	m_filter->setClearButtonEnabled( true ) ;
+
+	connect( m_filter,&QLineEdit::textChanged,this,&favoritesMenu::filter ) ;
+
+	m_filterAction = new QWidgetAction( m_menu ) ;
+
+	m_filterAction->setDefaultWidget( m_filter ) ;
+
+	m_menu->addAction( m_filterAction ) ;
+
+	for( const auto& it : favoritesStore::instance().entries() ){
+
+		this->addEntry( it.volumePath ) ;
+	}
+
+	this->setFilterVisibility() ;
+}
+
+void favoritesMenu::addEntry( const QString& e )
+{
+	if( m_actions.contains( e ) ){
+
+		return ;
+	}
+
+	auto ac = new QAction( m_menu ) ;
+
+	ac->setText( e ) ;
+	ac->setObjectName( e ) ;
+	ac->setCheckable( true ) ;
+	ac->setChecked( m_mounted.contains( e ) ) ;
+
+	if( m_filter && !m_filter->text().isEmpty() ){
+
+		ac->setVisible( e.contains( m_filter->text(),Qt::CaseInsensitive ) ) ;
+	}
+
+	m_menu->addAction( ac ) ;
+
+	m_actions.insert( e,ac ) ;
+}
+
+void favoritesMenu::favoritesChanged()
+{
+	if( !m_built ){
+
+		return ;
+	}
+
+	QSet< QString > e ;
+
+	const auto& s = favoritesStore::instance().entries() ;
+
+	e.reserve( static_cast< int >( s.size() ) ) ;
+
+	for( const auto& it : s ){
+
+		e.insert( it.volumePath ) ;
+	}
+
+	for( auto it = m_actions.begin() ; it != m_actions.end() ; ){
+
+		if( e.contains( it.key() ) ){
+
+			it++ ;
+		}else{
+			m_menu->removeAction( it.value() ) ;
+
+			it.value()->deleteLater() ;
+
+			it = m_actions.erase( it ) ;
+		}
+	}
+
+	for( const auto& it : s ){
+
+		this->addEntry( it.volumePath ) ;
+	}
+
+	this->setFilterVisibility() ;
+}
+
+void favoritesMenu::mountedVolumes( const std::vector< volumeInfo >& e )
+{
+	QSet< QString > m ;
+
+	for( const auto& it : e ){
+
+		m.insert( it.volumePath() ) ;
+	}
+
+	if( m_built ){
+
+		auto _set = [ this ]( const QString& e,bool s ){
+
+			auto it = m_actions.find( e ) ;
+
+			if( it != m_actions.end() ){
+
+				it.value()->setChecked( s ) ;
+			}
+		} ;
+
+		for( const auto& it : m_mounted ){
+
+			if( !m.contains( it ) ){
+
+				_set( it,false ) ;
+			}
+		}
+
+		for( const auto& it : m ){
+
+			if( !m_mounted.contains( it ) ){
+
+				_set( it,true ) ;
+			}
+		}
+	}
+
+	m_mounted = std::move( m ) ;
+}
+
+void favoritesMenu::filter( const QString& e )
+{
+	for( auto it = m_actions.begin() ; it != m_actions.end() ; it++ ){
+
+		it.value()->setVisible( e.isEmpty() || it.key().contains( e,Qt::CaseInsensitive ) ) ;
+	}
+}
+
+void favoritesMenu::setFilterVisibility()
+{
+	m_filterAction->setVisible( m_actions.size() > _filter_threshold ) ;
+}
@@ -0,0 +1,70 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAVORITES_MENU_H
+#define FAVORITES_MENU_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+
+#include <vector>
+
+#include "volumeinfo.h"
+
+class QMenu ;
+class QAction ;
+class QLineEdit ;
+class QWidgetAction ;
+
+/*
+ * This class manages a menu with favorites.
+ *
+ * The menu is built the first time it is about to be shown and after that,entries
+ * are added and removed individually as favorites change and are marked as checked
+ * when their volumes are mounted.A filter field is shown on top of long lists.
+ */
+class favoritesMenu : public QObject
+{
+	Q_OBJECT
+public:
+	favoritesMenu( QMenu *,QObject * parent ) ;
+
+	void mountedVolumes( const std::vector< volumeInfo >& ) ;
+private:
+	void aboutToShow( void ) ;
+	void build( void ) ;
+	void favoritesChanged( void ) ;
+	void filter( const QString& ) ;
+	void addEntry( const QString& ) ;
+	void setFilterVisibility( void ) ;
+
+	QMenu * m_menu ;
+	QLineEdit * m_filter = nullptr ;
+	QWidgetAction * m_filterAction = nullptr ;
+
+	QHash< QString,QAction * > m_actions ;
+	QSet< QString > m_mounted ;
+
+	bool m_built = false ;
+};
+
+#endif // FAVORITES_MENU_H
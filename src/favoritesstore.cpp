@@ -0,0 +1,653 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "favoritesstore.h"
+#include "utility.h"
+#include "json.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+static const int _format_version = 1 ;
+
+using positionedEntries = std::vector< std::pair< size_t,favorites::entry > > ;
+
+static std::string _header( size_t autoMountCount )
+{
+	nlohmann::json json ;
+
+	json[ "version" ]        = _format_version ;
+	json[ "autoMountCount" ] = autoMountCount ;
+
+	return json.dump() ;
+}
+
+static bool _auto_mount_count( const QByteArray& e,size_t& count )
+{
+	count = 0 ;
+
+	try{
+		auto json = nlohmann::json::parse( e.constData() ) ;
+
+		auto version = json.value( "version",0 ) ;
+
+		if( version > _format_version ){
+
+			utility::debug( false ) << "Favorites file was written by a newer version,unknown fields will be lost" ;
+		}
+
+		count = json.value( "autoMountCount",size_t( 0 ) ) ;
+
+		return true ;
+
+	}catch( ... ){
+
+		utility::debug( false ) << "Failed To Parse Favorites File Header" ;
+
+		return false ;
+	}
+}
+
+static std::string _record( const favorites::entry& e,size_t position )
+{
+	nlohmann::json json ;
+
+	auto _add = [ & ]( const char * key,const QString& e ){
+
+		if( !e.isEmpty() && e != "N/A" ){
+
+			json[ key ] = e.toStdString() ;
+		}
+	} ;
+
+	json[ "position" ]  = position ;
+	json[ "autoMount" ] = e.autoMount() ;
+
+	_add( "volumePath",e.volumePath ) ;
+	_add( "mountPointPath",e.mountPointPath ) ;
+	_add( "configFilePath",e.configFilePath ) ;
+	_add( "idleTimeOut",e.idleTimeOut ) ;
+	_add( "mountOptions",e.mountOptions ) ;
+
+	if( e.lazyUnmount ){
+
+		json[ "lazyUnmount" ] = true ;
+	}
+
+	if( e.autoRemount ){
+
+		json[ "autoRemount" ] = true ;
+	}
+
+	if( !e.tags.isEmpty() ){
+
+		auto& tags = json[ "tags" ] = nlohmann::json::array() ;
+
+		for( const auto& it : e.tags ){
+
+			tags.push_back( it.toStdString() ) ;
+		}
+	}
+
+	if( e.warmUpDepth > 0 ){
+
+		json[ "warmUpDepth" ] = e.warmUpDepth ;
+	}
+
+	if( e.resources.isSet() ){
+
+		auto& r = json[ "resources" ] ;
+
+		r[ "nice" ]        = e.resources.nice ;
+		r[ "ioClass" ]     = e.resources.ioClass.toStdString() ;
+		r[ "cpuAffinity" ] = e.resources.cpuAffinity.toStdString() ;
+		r[ "memoryMax" ]   = e.resources.memoryMax.toStdString() ;
+		r[ "cpuMax" ]      = e.resources.cpuMax ;
+	}
+
+	return json.dump() ;
+}
+
+static bool _entry( const QByteArray& line,positionedEntries& m )
+{
+	try{
+		auto json = nlohmann::json::parse( line.constData() ) ;
+
+		auto _get = [ & ]( const char * key ){
+
+			auto it = json.find( key ) ;
+
+			if( it != json.end() && it->is_string() ){
+
+				return QString::fromStdString( it->get< std::string >() ) ;
+			}else{
+				return QString() ;
+			}
+		} ;
+
+		favorites::entry e ;
+
+		e.volumePath      = _get( "volumePath" ) ;
+		e.mountPointPath  = _get( "mountPointPath" ) ;
+		e.autoMountVolume = json.value( "autoMount",false ) ? "true" : "false" ;
+		e.configFilePath  = _get( "configFilePath" ) ;
+		e.idleTimeOut     = _get( "idleTimeOut" ) ;
+		e.mountOptions    = _get( "mountOptions" ) ;
+		e.lazyUnmount     = json.value( "lazyUnmount",false ) ;
+		e.autoRemount     = json.value( "autoRemount",false ) ;
+		e.warmUpDepth     = json.value( "warmUpDepth",0 ) ;
+
+		auto resources = json.find( "resources" ) ;
+
+		if( resources != json.end() && resources->is_object() ){
+
+			auto& r = *resources ;
+
+			e.resources.nice        = r.value( "nice",0 ) ;
+			e.resources.ioClass     = QString::fromStdString( r.value( "ioClass",std::string() ) ) ;
+			e.resources.cpuAffinity = QString::fromStdString( r.value( "cpuAffinity",std::string() ) ) ;
+			e.resources.memoryMax   = QString::fromStdString( r.value( "memoryMax",std::string() ) ) ;
+			e.resources.cpuMax      = r.value( "cpuMax",0 ) ;
+		}
+
+		auto tags = json.find( "tags" ) ;
+
+		if( tags != json.end() && tags->is_array() ){
+
+			for( const auto& it : *tags ){
+
+				if( it.is_string() ){
+
+					e.tags.append( QString::fromStdString( it.get< std::string >() ) ) ;
+				}
+			}
+		}
+
+		if( e.volumePath.isEmpty() ){
+
+			return false ;
+		}
+
+		m.emplace_back( json.value( "position",m.size() ),std::move( e ) ) ;
+
+		return true ;
+
+	}catch( ... ){
+
+		utility::debug( false ) << "Failed To Parse A Favorites Entry" ;
+
+		return false ;
+	}
+}
+
+static std::vector< favorites::entry > _sorted( positionedEntries& m )
+{
+	std::stable_sort( m.begin(),m.end(),[]( const positionedEntries::value_type& a,
+						 const positionedEntries::value_type& b ){
+		return a.first < b.first ;
+	} ) ;
+
+	std::vector< favorites::entry > e ;
+
+	e.reserve( m.size() ) ;
+
+	for( auto& it : m ){
+
+		e.emplace_back( std::move( it.second ) ) ;
+	}
+
+	return e ;
+}
+
+static bool _write( const QString& path,const std::vector< favorites::entry >& e )
+{
+	QDir().mkpath( QFileInfo( path ).absolutePath() ) ;
+
+	QSaveFile f( path ) ;
+
+	if( !f.open( QIODevice::WriteOnly ) ){
+
+		utility::debug( false ) << "Failed To Open Favorites File For Writing: " + path ;
+
+		return false ;
+	}
+
+	auto autoMountCount = std::count_if( e.begin(),e.end(),[]( const favorites::entry& e ){
+
+		return e.autoMount() ;
+	} ) ;
+
+	auto _write_line = [ & ]( const std::string& e ){
+
+		f.write( e.data(),static_cast< qint64 >( e.size() ) ) ;
+		f.write( "\n",1 ) ;
+	} ;
+
+	_write_line( _header( static_cast< size_t >( autoMountCount ) ) ) ;
+
+	/*
+	 * Auto mount favorites go first so that they can be read at startup
+	 * without reading the rest of the file.
+	 */
+	for( size_t i = 0 ; i < e.size() ; i++ ){
+
+		if( e[ i ].autoMount() ){
+
+			_write_line( _record( e[ i ],i ) ) ;
+		}
+	}
+
+	for( size_t i = 0 ; i < e.size() ; i++ ){
+
+		if( !e[ i ].autoMount() ){
+
+			_write_line( _record( e[ i ],i ) ) ;
+		}
+	}
+
+	return f.commit() ;
+}
+
+favoritesStore& favoritesStore::instance()
+{
+	static favoritesStore m ;
+	return m ;
+}
+
+static QString _default_path()
+{
+	return QStandardPaths::writableLocation( QStandardPaths::GenericConfigLocation ) +
+		"/SiriKali/favorites.jsonl" ;
+}
+
+/*
+ * The file goes next to the settings file so that it follows it when the
+ * settings are kept somewhere else,settings on windows are in the registry.
+ */
+static QString _path()
+{
+#ifdef Q_OS_WIN
+	return _default_path() ;
+#else
+	auto m = QFileInfo( utility::settingsObject().fileName() ).absolutePath() ;
+
+	return m + "/favorites.jsonl" ;
+#endif
+}
+
+favoritesStore::favoritesStore() : m_path( _path() )
+{
+	m_flushTimer.setSingleShot( true ) ;
+	m_flushTimer.setInterval( 1000 ) ;
+
+	m_changedTimer.setSingleShot( true ) ;
+	m_changedTimer.setInterval( 0 ) ;
+
+	connect( &m_flushTimer,&QTimer::timeout,[ this ](){ this->flush() ; } ) ;
+
+	connect( &m_changedTimer,&QTimer::timeout,[ this ](){ emit changed() ; } ) ;
+
+	connect( qApp,&QCoreApplication::aboutToQuit,[ this ](){ this->flush() ; } ) ;
+}
+
+void favoritesStore::migrate()
+{
+	if( QFile::exists( m_path ) ){
+
+		return ;
+	}
+
+	/*
+	 * Earlier builds kept the file in the generic config folder,it is only
+	 * somewhere else when the settings file is.
+	 */
+	auto old = _default_path() ;
+
+	if( QFile::exists( old ) ){
+
+		QDir().mkpath( QFileInfo( m_path ).absolutePath() ) ;
+
+		if( QFile::copy( old,m_path ) ){
+
+			return ;
+		}
+	}
+
+	auto& s = utility::settingsObject() ;
+
+	if( !s.contains( "FavoritesVolumes" ) ){
+
+		return ;
+	}
+
+	std::vector< favorites::entry > e ;
+
+	for( const auto& it : s.value( "FavoritesVolumes" ).toStringList() ){
+
+		e.emplace_back( it ) ;
+	}
+
+	/*
+	 * The old entry is left alone so that older versions still find favorites
+	 * as they were at the time of the migration.
+	 */
+	_write( m_path,e ) ;
+}
+
+void favoritesStore::loadAutoMount()
+{
+	if( m_state != favoritesStore::state::notLoaded ){
+
+		return ;
+	}
+
+	this->migrate() ;
+
+	QFile f( m_path ) ;
+
+	positionedEntries m ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		size_t count ;
+
+		_auto_mount_count( f.readLine(),count ) ;
+
+		for( ; count > 0 && !f.atEnd() ; count-- ){
+
+			_entry( f.readLine(),m ) ;
+		}
+	}
+
+	m_autoMountEntries = _sorted( m ) ;
+
+	m_state = favoritesStore::state::autoMountLoaded ;
+}
+
+void favoritesStore::load()
+{
+	if( m_state == favoritesStore::state::loaded ){
+
+		return ;
+	}
+
+	this->migrate() ;
+
+	QFile f( m_path ) ;
+
+	positionedEntries m ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		size_t count ;
+
+		auto header = f.readLine() ;
+
+		auto ok = header.trimmed().isEmpty() || _auto_mount_count( header,count ) ;
+
+		while( !f.atEnd() ){
+
+			auto e = f.readLine() ;
+
+			if( !e.trimmed().isEmpty() && !_entry( e,m ) ){
+
+				ok = false ;
+			}
+		}
+
+		m_unreadable = !ok ;
+	}
+
+	m_entries = _sorted( m ) ;
+
+	m_autoMountEntries.clear() ;
+
+	m_state = favoritesStore::state::loaded ;
+
+	this->reIndex() ;
+}
+void favoritesStore::reIndex()
+{
+	m_volumePaths.clear() ;
+	m_mountPointPaths.clear() ;
+
+	m_volumePaths.reserve( static_cast< int >( m_entries.size() ) ) ;
+	m_mountPointPaths.reserve( static_cast< int >( m_entries.size() ) ) ;
+
+	/*
+	 * Go backwards so that the first entry wins when there are duplicates.
+	 */
+	for( auto i = m_entries.size() ; i > 0 ; i-- ){
+
+		const auto& e = m_entries[ i - 1 ] ;
+
+		m_volumePaths.insert( e.volumePath,i - 1 ) ;
+		m_mountPointPaths.insert( e.mountPointPath,i - 1 ) ;
+	}
+}
+
+void favoritesStore::update()
+{
+	m_dirty = true ;
+
+	m_generation++ ;
+
+	m_flushTimer.start() ;
+	m_changedTimer.start() ;
+}
+
+const std::vector< favorites::entry >& favoritesStore::entries()
+{
+	this->load() ;
+
+	return m_entries ;
+}
+
+std::vector< favorites::entry > favoritesStore::autoMountEntries()
+{
+	if( m_state == favoritesStore::state::loaded ){
+
+		std::vector< favorites::entry > e ;
+
+		for( const auto& it : m_entries ){
+
+			if( it.autoMount() ){
+
+				e.emplace_back( it ) ;
+			}
+		}
+
+		return e ;
+	}else{
+		this->loadAutoMount() ;
+
+		return m_autoMountEntries ;
+	}
+}
+
+favorites::entry favoritesStore::volumePath( const QString& e )
+{
+	this->load() ;
+
+	auto it = m_volumePaths.find( e ) ;
+
+	if( it != m_volumePaths.end() ){
+
+		return m_entries[ it.value() ] ;
+	}else{
+		return {} ;
+	}
+}
+
+favorites::entry favoritesStore::mountPointPath( const QString& e )
+{
+	this->load() ;
+
+	auto it = m_mountPointPaths.find( e ) ;
+
+	if( it != m_mountPointPaths.end() ){
+
+		return m_entries[ it.value() ] ;
+	}else{
+		return {} ;
+	}
+}
+
+void favoritesStore::add( const favorites::entry& e )
+{
+	this->load() ;
+
+	m_entries.emplace_back( e ) ;
+
+	auto s = m_entries.size() - 1 ;
+
+	if( !m_volumePaths.contains( e.volumePath ) ){
+
+		m_volumePaths.insert( e.volumePath,s ) ;
+	}
+
+	if( !m_mountPointPaths.contains( e.mountPointPath ) ){
+
+		m_mountPointPaths.insert( e.mountPointPath,s ) ;
+	}
+
+	this->update() ;
+}
+
+void favoritesStore::replace( const favorites::entry& e,const favorites::entry& f )
+{
+	this->load() ;
+
+	bool found = false ;
+
+	for( auto& it : m_entries ){
+
+		if( it == e ){
+
+			auto lazyUnmount = it.lazyUnmount ;
+			auto autoRemount = it.autoRemount ;
+			auto tags        = it.tags ;
+			auto warmUpDepth = it.warmUpDepth ;
+			auto resources   = it.resources ;
+
+			it = f ;
+
+			it.lazyUnmount = lazyUnmount ;
+			it.autoRemount = autoRemount ;
+			it.tags        = tags ;
+			it.warmUpDepth = warmUpDepth ;
+			it.resources   = resources ;
+
+			found = true ;
+		}
+	}
+
+	if( found ){
+
+		this->reIndex() ;
+		this->update() ;
+	}
+}
+
+void favoritesStore::modify( const QString& volumePath,
+			     const std::function< void( favorites::entry& ) >& function )
+{
+	this->load() ;
+
+	auto it = m_volumePaths.find( volumePath ) ;
+
+	if( it != m_volumePaths.end() ){
+
+		function( m_entries[ it.value() ] ) ;
+
+		this->update() ;
+	}
+}
+
+void favoritesStore::remove( const favorites::entry& e )
+{
+	this->load() ;
+
+	auto s = m_entries.size() ;
+
+	m_entries.erase( std::remove( m_entries.begin(),m_entries.end(),e ),m_entries.end() ) ;
+
+	if( s != m_entries.size() ){
+
+		this->reIndex() ;
+		this->update() ;
+	}
+}
+
+void favoritesStore::clear()
+{
+	m_state = favoritesStore::state::loaded ;
+
+	m_entries.clear() ;
+	m_autoMountEntries.clear() ;
+
+	this->reIndex() ;
+	this->update() ;
+}
+
+int favoritesStore::entrySize()
+{
+	/*
+	 * Entries have explicit fields and always have all of them.
+	 */
+	return favorites::entry().list( false ).size() ;
+}
+
+quint64 favoritesStore::generation() const
+{
+	return m_generation ;
+}
+
+void favoritesStore::flush()
+{
+	if( !m_dirty ){
+
+		return ;
+	}
+
+	m_flushTimer.stop() ;
+
+	this->load() ;
+
+	if( m_unreadable ){
+
+		utility::debug( false ) << "Favorites File Has Entries That Could Not Be Read,Changes Are Not Saved: " + m_path ;
+
+		return ;
+	}
+
+	if( _write( m_path,m_entries ) ){
+
+		m_dirty = false ;
+	}else{
+		utility::debug( false ) << "Failed To Save Favorites To: " + m_path ;
+	}
+}
@@ -0,0 +1,114 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAVORITES_STORE_H
+#define FAVORITES_STORE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QTimer>
+
+#include <functional>
+#include <vector>
+
+#include "favorites.h"
+
+/*
+ * Favorites are kept in a JSON Lines file next to the settings file.The first line
+ * is a header with the format version and the number of auto mount favorites,the
+ * auto mount favorites come next and the rest follow.Auto mount favorites are all
+ * that is needed at startup and they are loaded without reading the rest of the file.
+ * Everything else is loaded on first use.
+ *
+ * Favorites stored under "FavoritesVolumes" in settings by older versions are
+ * migrated the first time favorites are read.
+ *
+ * The file is not written to if any of its lines could not be read so that
+ * entries this version does not understand are not lost.
+ *
+ * Once loaded,favorites are kept in memory together with indexes by volume path and
+ * by mount point path.Changes are written back shortly after the last change in a
+ * batch and interested parties are told about changes through the "changed" signal.
+ *
+ * This object is meant to be used from the GUI thread only.
+ */
+class favoritesStore : public QObject
+{
+	Q_OBJECT
+public:
+	static favoritesStore& instance() ;
+
+	const std::vector< favorites::entry >& entries() ;
+
+	std::vector< favorites::entry > autoMountEntries() ;
+
+	favorites::entry volumePath( const QString& ) ;
+	favorites::entry mountPointPath( const QString& ) ;
+
+	void add( const favorites::entry& ) ;
+	void replace( const favorites::entry&,const favorites::entry& ) ;
+	void remove( const favorites::entry& ) ;
+	void clear() ;
+
+	/*
+	 * Changes options of a favorite that are not shown in the favorites table.
+	 */
+	void modify( const QString& volumePath,const std::function< void( favorites::entry& ) >& ) ;
+
+	int entrySize() ;
+
+	quint64 generation() const ;
+
+	void flush() ;
+signals:
+	void changed( void ) ;
+private:
+	enum class state{ notLoaded,autoMountLoaded,loaded } ;
+
+	favoritesStore() ;
+	void load() ;
+	void loadAutoMount() ;
+	void migrate() ;
+	void reIndex() ;
+	void update() ;
+
+	QString m_path ;
+
+	std::vector< favorites::entry > m_entries ;
+	std::vector< favorites::entry > m_autoMountEntries ;
+
+	QHash< QString,size_t > m_volumePaths ;
+	QHash< QString,size_t > m_mountPointPaths ;
+
+	QTimer m_flushTimer ;
+	QTimer m_changedTimer ;
+
+	favoritesStore::state m_state = favoritesStore::state::notLoaded ;
+
+	bool m_dirty = false ;
+
+	bool m_unreadable = false ;
+
+	quint64 m_generation = 1 ;
+};
+
+#endif // FAVORITES_STORE_H
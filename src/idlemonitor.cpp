@@ -0,0 +1,430 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "idlemonitor.h"
+#include "utility.h"
+
+#ifdef Q_OS_LINUX
+
+#include "siritask.h"
+#include "mountinfo.h"
+#include "openfiles.h"
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/*
+ * fanotify could see activity anywhere in a volume but it needs root and every
+ * queued event holds a reference to a file in the volume,which would make
+ * unmounting fail with EBUSY between two samples.
+ */
+class idleVolume
+{
+public:
+	idleVolume( const QString& mountPoint,int minutes,bool lazyUnmount ) :
+		m_mountPoint( mountPoint ),
+		m_timeOut( minutes ),
+		m_lazyUnmount( lazyUnmount ),
+		m_lastActive( std::chrono::steady_clock::now() ),
+		m_pid( openFiles::backend( mountPoint ) ),
+		m_io( this->io() ),
+		m_ignored( 0 ),
+		m_inotify( inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) )
+	{
+		if( m_inotify != -1 ){
+
+			auto m = IN_ACCESS | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE |
+				 IN_MOVE | IN_OPEN | IN_CLOSE ;
+
+			if( inotify_add_watch( m_inotify,QFile::encodeName( mountPoint ).constData(),m ) == -1 ){
+
+				close( m_inotify ) ;
+
+				m_inotify = -1 ;
+			}
+		}
+	}
+	idleVolume( idleVolume&& e ) :
+		m_mountPoint( std::move( e.m_mountPoint ) ),
+		m_timeOut( e.m_timeOut ),
+		m_lazyUnmount( e.m_lazyUnmount ),
+		m_lastActive( e.m_lastActive ),
+		m_pid( e.m_pid ),
+		m_io( e.m_io ),
+		m_ignored( e.m_ignored ),
+		m_inotify( e.m_inotify )
+	{
+		e.m_inotify = -1 ;
+	}
+	idleVolume& operator=( idleVolume&& e )
+	{
+		std::swap( m_mountPoint,e.m_mountPoint ) ;
+		std::swap( m_timeOut,e.m_timeOut ) ;
+		std::swap( m_lazyUnmount,e.m_lazyUnmount ) ;
+		std::swap( m_lastActive,e.m_lastActive ) ;
+		std::swap( m_pid,e.m_pid ) ;
+		std::swap( m_io,e.m_io ) ;
+		std::swap( m_ignored,e.m_ignored ) ;
+		std::swap( m_inotify,e.m_inotify ) ;
+
+		return *this ;
+	}
+	~idleVolume()
+	{
+		if( m_inotify != -1 ){
+
+			close( m_inotify ) ;
+		}
+	}
+	bool watchable() const
+	{
+		return m_pid != -1 || m_inotify != -1 ;
+	}
+	const QString& mountPoint() const
+	{
+		return m_mountPoint ;
+	}
+	int minutes() const
+	{
+		return m_timeOut ;
+	}
+	bool lazyUnmount() const
+	{
+		return m_lazyUnmount ;
+	}
+	/*
+	 * Returns true if the volume was not used for longer than its timeout.
+	 */
+	bool idle()
+	{
+		auto now = std::chrono::steady_clock::now() ;
+
+		auto io = this->io() ;
+
+		io = io >= m_ignored ? io - m_ignored : 0 ;
+
+		if( io != m_io || this->events() ){
+
+			m_io = io ;
+
+			m_lastActive = now ;
+
+			return false ;
+		}else{
+			return now - m_lastActive >= std::chrono::minutes( m_timeOut ) ;
+		}
+	}
+	void active()
+	{
+		m_lastActive = std::chrono::steady_clock::now() ;
+	}
+	std::chrono::steady_clock::duration idleFor() const
+	{
+		return std::chrono::steady_clock::now() - m_lastActive ;
+	}
+	/*
+	 * I/O the backend did on our behalf and that does not count as activity.
+	 */
+	void ignore( quint64 e )
+	{
+		m_ignored += e ;
+	}
+	quint64 io() const
+	{
+		if( m_pid == -1 ){
+
+			return 0 ;
+		}
+
+		QFile f( "/proc/" + QString::number( m_pid ) + "/io" ) ;
+
+		if( !f.open( QIODevice::ReadOnly ) ){
+
+			return 0 ;
+		}
+
+		quint64 s = 0 ;
+
+		for( const auto& it : f.readAll().split( '\n' ) ){
+
+			if( it.startsWith( "rchar:" ) || it.startsWith( "wchar:" ) ){
+
+				s += it.mid( 6 ).trimmed().toULongLong() ;
+			}
+		}
+
+		return s ;
+	}
+private:
+	bool events() const
+	{
+		if( m_inotify == -1 ){
+
+			return false ;
+		}
+
+		alignas( struct inotify_event ) char buffer[ 4096 ] ;
+
+		bool s = false ;
+
+		while( read( m_inotify,buffer,sizeof( buffer ) ) > 0 ){
+
+			s = true ;
+		}
+
+		return s ;
+	}
+
+	QString m_mountPoint ;
+	int m_timeOut ;
+	bool m_lazyUnmount ;
+	std::chrono::steady_clock::time_point m_lastActive ;
+	qint64 m_pid ;
+	quint64 m_io ;
+	quint64 m_ignored ;
+	int m_inotify ;
+};
+
+static std::mutex _mutex ;
+
+static std::vector< idleVolume > _volumes ;
+
+static bool _running = false ;
+
+static volumeInfo _mounted( const QString& mountPoint )
+{
+	for( const auto& it : *mountinfo::unlockedVolumesSnapshot() ){
+
+		if( it.mountPoint() == mountPoint ){
+
+			return it ;
+		}
+	}
+
+	return {} ;
+}
+
+static void _unmount( idleVolume e )
+{
+	auto s = _mounted( e.mountPoint() ) ;
+
+	if( s.isNotValid() ){
+
+		return ;
+	}
+
+	const auto& a = s.volumePath() ;
+	const auto& b = s.mountPoint() ;
+	const auto& c = s.fileSystem() ;
+
+	if( siritask::encryptedFolderUnMount( a,b,c,e.lazyUnmount() ).get() ){
+
+		siritask::deleteMountFolder( b ) ;
+
+		if( utility::debugEnabled() ){
+
+			auto m = QObject::tr( "Unmounted \"%1\" After %2 Minutes Of Inactivity." ) ;
+
+			utility::debug() << m.arg( a,QString::number( e.minutes() ) ) ;
+		}
+	}else{
+		/*
+		 * Something is keeping it busy,try again after another timeout.
+		 */
+		e.active() ;
+
+		std::lock_guard< std::mutex > lock( _mutex ) ;
+
+		_volumes.emplace_back( std::move( e ) ) ;
+	}
+}
+
+static void _monitor()
+{
+	while( true ){
+
+		std::this_thread::sleep_for( std::chrono::seconds( 30 ) ) ;
+
+		std::vector< idleVolume > idle ;
+
+		std::unique_lock< std::mutex > lock( _mutex ) ;
+
+		for( auto it = _volumes.begin() ; it != _volumes.end() ; ){
+
+			if( _mounted( it->mountPoint() ).isNotValid() ){
+
+				it = _volumes.erase( it ) ;
+
+			}else if( it->idle() ){
+
+				idle.emplace_back( std::move( *it ) ) ;
+
+				it = _volumes.erase( it ) ;
+			}else{
+				it++ ;
+			}
+		}
+
+		lock.unlock() ;
+
+		for( auto& it : idle ){
+
+			_unmount( std::move( it ) ) ;
+		}
+
+		lock.lock() ;
+
+		if( _volumes.empty() ){
+
+			_running = false ;
+
+			return ;
+		}
+	}
+}
+
+void idleMonitor::watch( const QString& mountPoint,int minutes,bool lazyUnmount )
+{
+	if( minutes <= 0 ){
+
+		return ;
+	}
+
+	idleVolume e( QDir::cleanPath( mountPoint ),minutes,lazyUnmount ) ;
+
+	if( !e.watchable() ){
+
+		return ;
+	}
+
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	for( auto& it : _volumes ){
+
+		if( it.mountPoint() == e.mountPoint() ){
+
+			it = std::move( e ) ;
+
+			return ;
+		}
+	}
+
+	_volumes.emplace_back( std::move( e ) ) ;
+
+	if( !_running ){
+
+		_running = true ;
+
+		std::thread( _monitor ).detach() ;
+	}
+}
+
+bool idleMonitor::quiet( const QString& mountPoint,int seconds )
+{
+	auto m = QDir::cleanPath( mountPoint ) ;
+
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	for( const auto& it : _volumes ){
+
+		if( it.mountPoint() == m ){
+
+			return it.idleFor() >= std::chrono::seconds( seconds ) ;
+		}
+	}
+
+	return false ;
+}
+
+void idleMonitor::unobserved( const QString& mountPoint,const std::function< void() >& function )
+{
+	auto m = QDir::cleanPath( mountPoint ) ;
+
+	auto _io = [ & ]()->qint64{
+
+		std::lock_guard< std::mutex > lock( _mutex ) ;
+
+		for( const auto& it : _volumes ){
+
+			if( it.mountPoint() == m ){
+
+				return static_cast< qint64 >( it.io() ) ;
+			}
+		}
+
+		return -1 ;
+	} ;
+
+	auto before = _io() ;
+
+	function() ;
+
+	if( before == -1 ){
+
+		return ;
+	}
+
+	auto after = _io() ;
+
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	for( auto& it : _volumes ){
+
+		if( it.mountPoint() == m && after >= before ){
+
+			it.ignore( static_cast< quint64 >( after - before ) ) ;
+		}
+	}
+}
+
+#else
+
+bool idleMonitor::quiet( const QString& mountPoint,int seconds )
+{
+	Q_UNUSED( mountPoint ) ;
+	Q_UNUSED( seconds ) ;
+
+	return false ;
+}
+
+void idleMonitor::unobserved( const QString& mountPoint,const std::function< void() >& function )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	function() ;
+}
+
+void idleMonitor::watch( const QString& mountPoint,int minutes,bool lazyUnmount )
+{
+	Q_UNUSED( mountPoint ) ;
+	Q_UNUSED( minutes ) ;
+	Q_UNUSED( lazyUnmount ) ;
+}
+
+#endif
@@ -0,0 +1,52 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDLE_MONITOR_H
+#define IDLE_MONITOR_H
+
+#include <QString>
+
+#include <functional>
+
+/*
+ * Unmounts volumes that were not used for a given number of minutes,for backends
+ * that can not do it themselves.A volume is considered used when its backend
+ * reads or writes anything,as reported in /proc/<pid>/io,or when inotify reports
+ * activity in the root folder of the volume.Volumes are sampled every 30 seconds
+ * and it is only implemented on linux.lazyUnmount is the setting of the favorite
+ * of the volume,the monitor runs in its own thread and can not read favorites.
+ */
+namespace idleMonitor
+{
+	void watch( const QString& mountPoint,int minutes,bool lazyUnmount ) ;
+
+	/*
+	 * Returns true if a watched volume was not used for at least "seconds".
+	 */
+	bool quiet( const QString& mountPoint,int seconds ) ;
+
+	/*
+	 * Runs "function" and keeps the I/O the backend of the volume does while it
+	 * runs from counting as activity,the watchdog probes volumes through it.
+	 */
+	void unobserved( const QString& mountPoint,const std::function< void() >& function ) ;
+}
+
+#endif
@@ -90,6 +90,21 @@ keyDialog::keyDialog( QWidget * parent,
 	}
 }
 
+keyDialog::keyDialog( QWidget * parent,
+		      secrets& s,
+		      const QString& q,
+		      utility::volumeList z,
+		      std::function< void( std::vector< siritask::options > ) > f ) :
+	keyDialog( parent,s,false,q,std::move( z ),[](){} )
+{
+	m_collectKeys = true ;
+
+	m_done = [ this,f = std::move( f ) ](){
+
+		f( std::move( m_collected ) ) ;
+	} ;
+}
+
 void keyDialog::unlockVolume()
 {
 	if( this->mountedAll() ){
@@ -847,8 +862,6 @@ void keyDialog::openMountPoint( const QString& m )
 
 void keyDialog::reportErrorMessage( const siritask::cmdStatus& s )
 {
-	QString msg ;
-
 	if( s == siritask::status::cryfsMigrateFileSystem ){
 
 		m_ui->checkBoxOpenReadOnly->setText( tr( "Upgrade File System" ) ) ;
@@ -856,6 +869,13 @@ void keyDialog::reportErrorMessage( const siritask::cmdStatus& s )
 		m_ui->checkBoxOpenReadOnly->setText( m_checkBoxOriginalText ) ;
 	}
 
+	this->showErrorMessage( { s,keyDialog::errorMessage( s ) } ) ;
+}
+
+QString keyDialog::errorMessage( const siritask::cmdStatus& s )
+{
+	QString msg ;
+
 	switch( s.status() ){
 
 	case siritask::status::success :
@@ -970,7 +990,7 @@ void keyDialog::reportErrorMessage( const siritask::cmdStatus& s )
 		}() ;
 	}
 
-	this->showErrorMessage( { s,msg } ) ;
+	return msg ;
 }
 
 void keyDialog::showErrorMessage( const QString& e )
@@ -1255,10 +1275,21 @@ void keyDialog::encryptedFolderMount()
 		}
 	}
 
-	m_working = true ;
-
 	siritask::options s{ m_path,m,m_key,m_idleTimeOut,m_configFile,m_exe,ro,m_mountOptions,QString() } ;
 
+	s.setFavoriteOptions( utility::readFavorite( m_path ) ) ;
+
+	if( m_collectKeys ){
+
+		m_collected.emplace_back( std::move( s ) ) ;
+
+		this->enableAll() ;
+
+		return this->unlockVolume() ;
+	}
+
+	m_working = true ;
+
 	auto e = siritask::encryptedFolderMount( s ).await() ;
 
 	m_working = false ;
@@ -101,6 +101,7 @@ class keyDialog : public QDialog
 	Q_OBJECT
 public:
 	static QString keyFileError() ;
+	static QString errorMessage( const siritask::cmdStatus& ) ;
 
 	static void instance( QWidget * parent,
 			      secrets& s,
@@ -122,12 +123,29 @@ public:
 	{
 		new keyDialog( parent,s,o,m,std::move( e ),std::move( function ) ) ;
 	}
+	/*
+	 * Prompts for keys of all volumes in the list without unlocking them and
+	 * the function is called with what was entered when the dialog closes.
+	 */
+	static void instance( QWidget * parent,
+			      secrets& s,
+			      const QString& m,
+			      utility::volumeList e,
+			      std::function< void( std::vector< siritask::options > ) > function )
+	{
+		new keyDialog( parent,s,m,std::move( e ),std::move( function ) ) ;
+	}
 	keyDialog( QWidget * parent,
 		   secrets&,
 		   bool,
 		   const QString&,
 		   utility::volumeList,
 		   std::function< void() > ) ;
+	keyDialog( QWidget * parent,
+		   secrets&,
+		   const QString&,
+		   utility::volumeList,
+		   std::function< void( std::vector< siritask::options > ) > ) ;
 	keyDialog( QWidget * parent,
 		   secrets&,
 		   const volumeInfo&,
@@ -214,6 +232,7 @@ private :
 	bool m_checked = false ;
 	bool m_hmac ;
 	bool m_closeGUI = false ;
+	bool m_collectKeys = false ;
 
 	secrets& m_secrets ;
 
@@ -230,6 +249,8 @@ private :
 
 	utility::volumeList m_volumes ;
 
+	std::vector< siritask::options > m_collected ;
+
 	decltype( m_volumes.size() ) m_counter = 0 ;
 };
 
@@ -22,16 +22,42 @@
 
 #include "sirikali.h"
 #include "utility.h"
+#include "rpc.h"
 
 int main( int argc,char * argv[] )
 {
 	QSettings settings( "SiriKali","SiriKali" ) ;
 	utility::setSettingsObject( &settings ) ;
 
+	int exitCode ;
+
+	if( rpc::cliCommand( argc,argv,exitCode ) ){
+
+		return exitCode ;
+	}
+
 	utility::initGlobals() ;
 
 	utility::scaleGUI() ;
 
+	/*
+	 * The daemon keeps a QApplication so that it can show the GUI when another
+	 * instance asks for it,without a display server it runs on the offscreen
+	 * platform plugin and hence needs no display.
+	 */
+	for( int i = 1 ; i < argc ; i++ ){
+
+		if( qstrcmp( argv[ i ],"--daemon" ) == 0 ){
+
+			if( qgetenv( "DISPLAY" ).isEmpty() && qgetenv( "WAYLAND_DISPLAY" ).isEmpty() ){
+
+				qputenv( "QT_QPA_PLATFORM","offscreen" ) ;
+			}
+
+			break ;
+		}
+	}
+
 	QApplication SiriKali( argc,argv ) ;
 
 	return sirikali().start( SiriKali ) ;
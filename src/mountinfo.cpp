@@ -22,14 +22,30 @@
 #include "siritask.h"
 #include "task.hpp"
 #include "winfsp.h"
+#include "openfiles.h"
+#include "backendresources.h"
 
 #include <QMetaObject>
 #include <QtGlobal>
 
+#include <QDir>
 #include <QFile>
+#include <QHash>
 
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef Q_OS_MACOS
+
+#include <sys/param.h>
+#include <sys/mount.h>
+
+#endif
 
 enum class background_thread{ True,False } ;
 
@@ -183,11 +199,445 @@ static QStringList _windows_volumes( background_thread thread )
 	return s ;
 }
 
+#ifdef Q_OS_LINUX
+
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+/*
+ * listmount() and statmount() are available since linux 6.8 but the fields we need
+ * to reconstruct a mountinfo entry(sb_source and fs_subtype) were only added in
+ * linux 6.15.Build machines usually have older kernel headers than the kernels we
+ * run on and hence we carry our own definitions and check at runtime what the
+ * running kernel supports.
+ */
+namespace linux_mount_api
+{
+	const long statmount_syscall = 457 ;
+	const long listmount_syscall = 458 ;
+
+	const quint64 lsmt_root = 0xffffffffffffffff ;
+
+	const quint64 sb_basic       = 0x00000001 ;
+	const quint64 mnt_basic      = 0x00000002 ;
+	const quint64 mnt_root       = 0x00000008 ;
+	const quint64 mnt_point      = 0x00000010 ;
+	const quint64 fs_type        = 0x00000020 ;
+	const quint64 mnt_opts       = 0x00000080 ;
+	const quint64 fs_subtype     = 0x00000100 ;
+	const quint64 sb_source      = 0x00000200 ;
+	const quint64 supported_mask = 0x00001000 ;
+
+	const quint64 mount_attr_rdonly     = 0x00000001 ;
+	const quint64 mount_attr_nosuid     = 0x00000002 ;
+	const quint64 mount_attr_nodev      = 0x00000004 ;
+	const quint64 mount_attr_noexec     = 0x00000008 ;
+	const quint64 mount_attr__atime     = 0x00000070 ;
+	const quint64 mount_attr_noatime    = 0x00000010 ;
+	const quint64 mount_attr_nodiratime = 0x00000080 ;
+
+	const unsigned int statx_mnt_id_unique = 0x00004000 ;
+
+	struct mnt_id_req
+	{
+		quint32 size ;
+		quint32 spare ;
+		quint64 mnt_id ;
+		quint64 param ;
+	};
+
+	struct statmount
+	{
+		quint32 size ;
+		quint32 mnt_opts ;
+		quint64 mask ;
+		quint32 sb_dev_major ;
+		quint32 sb_dev_minor ;
+		quint64 sb_magic ;
+		quint32 sb_flags ;
+		quint32 fs_type ;
+		quint64 mnt_id ;
+		quint64 mnt_parent_id ;
+		quint32 mnt_id_old ;
+		quint32 mnt_parent_id_old ;
+		quint64 mnt_attr ;
+		quint64 mnt_propagation ;
+		quint64 mnt_peer_group ;
+		quint64 mnt_master ;
+		quint64 propagate_from ;
+		quint32 mnt_root ;
+		quint32 mnt_point ;
+		quint64 mnt_ns_id ;
+		quint32 fs_subtype ;
+		quint32 sb_source ;
+		quint32 opt_num ;
+		quint32 opt_array ;
+		quint32 opt_sec_num ;
+		quint32 opt_sec_array ;
+		quint64 supported_mask ;
+		quint32 mnt_uidmap_num ;
+		quint32 mnt_uidmap ;
+		quint32 mnt_gidmap_num ;
+		quint32 mnt_gidmap ;
+		quint64 spare[ 43 ] ;
+	};
+
+	static_assert( sizeof( statmount ) == 512,"unexpected struct statmount size" ) ;
+}
+
+class linuxMounts
+{
+public:
+	static linuxMounts& instance()
+	{
+		static linuxMounts m ;
+		return m ;
+	}
+	bool supported() const
+	{
+		return m_supported ;
+	}
+	/*
+	 * Returns entries in /proc/self/mountinfo format.Only mounts we have not
+	 * seen before are queried with statmount(),the rest come from the cache.
+	 */
+	bool volumes( QStringList& e )
+	{
+		std::vector< quint64 > ids ;
+
+		if( !this->listmount( ids ) ){
+
+			return false ;
+		}
+
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		std::map< quint64,QString > cache ;
+
+		for( const auto& it : ids ){
+
+			auto s = m_cache.find( it ) ;
+
+			if( s != m_cache.end() ){
+
+				cache.emplace( it,std::move( s->second ) ) ;
+			}else{
+				auto m = this->entry( it ) ;
+
+				if( !m.isEmpty() ){
+
+					cache.emplace( it,std::move( m ) ) ;
+				}
+			}
+		}
+
+		m_cache = std::move( cache ) ;
+
+		for( const auto& it : m_cache ){
+
+			e.append( it.second ) ;
+		}
+
+		return true ;
+	}
+	/*
+	 * Returns an entry in /proc/self/mountinfo format of a mount whose mount
+	 * point is "path" or an empty string if "path" is not a mount point or
+	 * the entry could not be confirmed to be of the mount at "path".
+	 */
+	QString volume( const QString& path )
+	{
+		struct statx m ;
+
+		auto flags = AT_NO_AUTOMOUNT | AT_STATX_DONT_SYNC ;
+		auto mask  = linux_mount_api::statx_mnt_id_unique ;
+		auto s     = path.toLocal8Bit() ;
+
+		if( statx( AT_FDCWD,s.constData(),flags,mask,&m ) != 0 ){
+
+			return QString() ;
+		}
+
+		if( !( m.stx_mask & linux_mount_api::statx_mnt_id_unique ) ){
+
+			return QString() ;
+		}
+
+		if( !( m.stx_attributes_mask & STATX_ATTR_MOUNT_ROOT ) ||
+		    !( m.stx_attributes & STATX_ATTR_MOUNT_ROOT ) ){
+
+			return QString() ;
+		}
+
+		auto e = [ & ](){
+
+			std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+			auto it = m_cache.find( m.stx_mnt_id ) ;
+
+			if( it != m_cache.end() ){
+
+				return it->second ;
+			}else{
+				return this->entry( m.stx_mnt_id ) ;
+			}
+		}() ;
+
+		/*
+		 * The entry must be of the mount statx() found at "path",it is not
+		 * when "path" goes through a symlink or when the mount changed in
+		 * between and the caller then has to go through all mounts.
+		 */
+		auto k = e.split( ' ' ) ;
+
+		auto dev = QString( "%1:%2" ).arg( QString::number( m.stx_dev_major ),
+						   QString::number( m.stx_dev_minor ) ) ;
+
+		if( k.size() > 4 && k.at( 2 ) == dev && k.at( 4 ) == this->escape( QDir::cleanPath( path ) ) ){
+
+			return e ;
+		}else{
+			return QString() ;
+		}
+	}
+private:
+	linuxMounts()
+	{
+		using namespace linux_mount_api ;
+
+		std::vector< quint64 > ids ;
+
+		if( this->listmount( ids ) && !ids.empty() ){
+
+			if( this->statmount( ids.front(),supported_mask ) ){
+
+				auto s = reinterpret_cast< const linux_mount_api::statmount * >( m_buffer.data() ) ;
+
+				auto m = sb_source | fs_subtype ;
+
+				m_supported = ( s->mask & supported_mask ) && ( s->supported_mask & m ) == m ;
+			}
+		}
+	}
+	bool listmount( std::vector< quint64 >& e )
+	{
+		linux_mount_api::mnt_id_req req ;
+
+		std::memset( &req,0,sizeof( req ) ) ;
+
+		req.size   = sizeof( req ) ;
+		req.mnt_id = linux_mount_api::lsmt_root ;
+
+		std::array< quint64,512 > buffer ;
+
+		while( true ){
+
+			auto s = syscall( linux_mount_api::listmount_syscall,
+					  &req,buffer.data(),buffer.size(),0 ) ;
+			if( s < 0 ){
+
+				return false ;
+			}
+
+			e.insert( e.end(),buffer.begin(),buffer.begin() + s ) ;
+
+			if( static_cast< size_t >( s ) < buffer.size() ){
+
+				return true ;
+			}
+
+			req.param = buffer[ static_cast< size_t >( s ) - 1 ] ;
+		}
+	}
+	bool statmount( quint64 id,quint64 mask )
+	{
+		linux_mount_api::mnt_id_req req ;
+
+		std::memset( &req,0,sizeof( req ) ) ;
+
+		req.size   = sizeof( req ) ;
+		req.mnt_id = id ;
+		req.param  = mask ;
+
+		while( true ){
+
+			auto s = syscall( linux_mount_api::statmount_syscall,
+					  &req,m_buffer.data(),m_buffer.size(),0 ) ;
+			if( s == 0 ){
+
+				return true ;
+
+			}else if( errno == EOVERFLOW && m_buffer.size() < 1024 * 1024 ){
+
+				m_buffer.resize( m_buffer.size() * 2 ) ;
+			}else{
+				return false ;
+			}
+		}
+	}
+	QString entry( quint64 id )
+	{
+		using namespace linux_mount_api ;
+
+		auto mask = sb_basic | mnt_basic | mnt_root | mnt_point |
+			    fs_type | mnt_opts | fs_subtype | sb_source ;
+
+		if( !this->statmount( id,mask ) ){
+
+			return QString() ;
+		}
+
+		auto s = reinterpret_cast< const linux_mount_api::statmount * >( m_buffer.data() ) ;
+
+		auto str = m_buffer.data() + sizeof( linux_mount_api::statmount ) ;
+
+		auto _string = [ & ]( quint64 flag,quint32 offset,const char * def ){
+
+			if( s->mask & flag ){
+
+				return QString::fromLocal8Bit( str + offset ) ;
+			}else{
+				return QString( def ) ;
+			}
+		} ;
+
+		if( !( s->mask & mnt_point ) || !( s->mask & fs_type ) ){
+
+			return QString() ;
+		}
+
+		auto fs = _string( fs_type,s->fs_type,"" ) ;
+
+		if( s->mask & fs_subtype ){
+
+			fs += "." + _string( fs_subtype,s->fs_subtype,"" ) ;
+		}
+
+		QString mntOpts = s->mnt_attr & mount_attr_rdonly ? "ro" : "rw" ;
+
+		if( s->mnt_attr & mount_attr_nosuid ){
+
+			mntOpts += ",nosuid" ;
+		}
+		if( s->mnt_attr & mount_attr_nodev ){
+
+			mntOpts += ",nodev" ;
+		}
+		if( s->mnt_attr & mount_attr_noexec ){
+
+			mntOpts += ",noexec" ;
+		}
+		if( ( s->mnt_attr & mount_attr__atime ) == mount_attr_noatime ){
+
+			mntOpts += ",noatime" ;
+
+		}else if( ( s->mnt_attr & mount_attr__atime ) == 0 ){
+
+			mntOpts += ",relatime" ;
+		}
+		if( s->mnt_attr & mount_attr_nodiratime ){
+
+			mntOpts += ",nodiratime" ;
+		}
+
+		QString sbOpts = s->sb_flags & 1 ? "ro" : "rw" ;
+
+		auto opts = _string( mnt_opts,s->mnt_opts,"" ) ;
+
+		if( !opts.isEmpty() ){
+
+			sbOpts += "," + opts ;
+		}
+
+		QString e = "%1 %2 %3:%4 %5 %6 %7 - %8 %9 %10" ;
+
+		return e.arg( QString::number( s->mnt_id_old ),
+			      QString::number( s->mnt_parent_id_old ),
+			      QString::number( s->sb_dev_major ),
+			      QString::number( s->sb_dev_minor ),
+			      this->escape( _string( mnt_root,s->mnt_root,"/" ) ),
+			      this->escape( _string( mnt_point,s->mnt_point,"" ) ),
+			      mntOpts,
+			      this->escape( fs ),
+			      this->escape( _string( sb_source,s->sb_source,"none" ) ),
+			      this->escape( sbOpts ) ) ;
+	}
+	QString escape( QString e )
+	{
+		/*
+		 * Make the same substitutions linux makes in /proc/self/mountinfo
+		 */
+		e.replace( "\\","\\134" ) ;
+		e.replace( " ","\\040" ) ;
+		e.replace( "\t","\\011" ) ;
+		e.replace( "\n","\\012" ) ;
+
+		return e ;
+	}
+
+	bool m_supported = false ;
+	std::vector< char > m_buffer = std::vector< char >( 4096 ) ;
+	std::map< quint64,QString > m_cache ;
+	std::mutex m_mutex ;
+};
+
+static QStringList _linux_volumes()
+{
+	auto& m = linuxMounts::instance() ;
+
+	if( m.supported() ){
+
+		QStringList e ;
+
+		if( m.volumes( e ) ){
+
+			return e ;
+		}
+	}
+
+	return utility::split( utility::fileContents( "/proc/self/mountinfo" ) ) ;
+}
+
+static QString _linux_volume( const QString& e )
+{
+	auto& m = linuxMounts::instance() ;
+
+	if( m.supported() ){
+
+		return m.volume( e ) ;
+	}else{
+		return QString() ;
+	}
+}
+
+#else
+
+static QStringList _linux_volumes()
+{
+	return QStringList() ;
+}
+
+static QString _linux_volume( const QString& e )
+{
+	Q_UNUSED( e ) ;
+	return QString() ;
+}
+
+#endif
+
 static QStringList _unlocked_volumes( background_thread thread )
 {
 	if( utility::platformIsLinux() ){
 
-		return utility::split( utility::fileContents( "/proc/self/mountinfo" ) ) ;
+		return _linux_volumes() ;
 
 	}else if( utility::platformIsOSX() ){
 
@@ -197,6 +647,101 @@ static QStringList _unlocked_volumes( background_thread thread )
 	}
 }
 
+static QString _hash( const QString& e )
+{
+	/*
+	 * jenkins one at a time hash function.
+	 *
+	 * https://en.wikipedia.org/wiki/Jenkins_hash_function
+	 */
+
+	uint32_t hash = 0 ;
+
+	auto p = e.toLatin1() ;
+
+	auto key = p.constData() ;
+
+	auto l = p.size() ;
+
+	for( decltype( l ) i = 0 ; i < l ; i++ ){
+
+		hash += *( key + i ) ;
+
+		hash += ( hash << 10 ) ;
+
+		hash ^= ( hash >> 6 ) ;
+	}
+
+	hash += ( hash << 3 ) ;
+
+	hash ^= ( hash >> 11 ) ;
+
+	hash += ( hash << 15 ) ;
+
+	return QString::number( hash ) ;
+}
+
+static QString _decode( QString path,bool set_offset )
+{
+	path.replace( "\\012","\n" ) ;
+	path.replace( "\\040"," " ) ;
+	path.replace( "\\134","\\" ) ;
+	path.replace( "\\011","\\t" ) ;
+
+	if( set_offset ){
+
+		return path.mid( path.indexOf( '@' ) + 1 ) ;
+	}else{
+		return path ;
+	}
+}
+
+static bool _volume_info( const QString& e,volumeInfo::mountinfo& info )
+{
+	if( !volumeInfo::supported( e ) ){
+
+		return false ;
+	}
+
+	const auto& k = utility::split( e,' ' ) ;
+
+	const auto s = k.size() ;
+
+	if( s < 6 ){
+
+		return false ;
+	}
+
+	const auto& cf = k.at( s - 2 ) ;
+
+	const auto& m = k.at( 4 ) ;
+
+	const auto& fs = k.at( s - 3 ) ;
+
+	if( utility::startsWithAtLeastOne( cf,"encfs@",
+					   "cryfs@",
+					   "securefs@",
+					   "gocryptfs@",
+					   "sshfs@" ) ){
+
+		info.volumePath = _decode( cf,true ) ;
+
+	}else if( utility::equalsAtleastOne( fs,"fuse.gocryptfs",
+					     "ecryptfs","fuse.sshfs" ) ){
+
+		info.volumePath = _decode( cf,false ) ;
+	}else{
+		info.volumePath = _hash( m ) ;
+	}
+
+	info.mountPoint   = _decode( m,false ) ;
+	info.fileSystem   = QString( fs ).replace( "fuse.","" ) ;
+	info.mode         = k.at( 5 ).mid( 0,2 ) ;
+	info.mountOptions = k.last() ;
+
+	return true ;
+}
+
 mountinfo::mountinfo( QObject * parent,bool e,std::function< void() >&& quit ) :
 	m_parent( parent ),
 	m_quit( std::move( quit ) ),
@@ -219,120 +764,302 @@ mountinfo::~mountinfo()
 {
 }
 
-Task::future< std::vector< volumeInfo > >& mountinfo::unlockedVolumes()
+static std::vector< volumeInfo > _volumes( background_thread thread )
 {
-	return Task::run( [](){
+	std::vector< volumeInfo > e ;
 
-		auto _hash = []( const QString& e ){
+	volumeInfo::mountinfo info ;
 
-			/*
-			 * jenkins one at a time hash function.
-			 *
-			 * https://en.wikipedia.org/wiki/Jenkins_hash_function
-			 */
+	for( const auto& it : _unlocked_volumes( thread ) ){
+
+		if( _volume_info( it,info ) ){
+
+			e.emplace_back( info ) ;
+		}
+	}
+
+	return e ;
+}
+
+class volumesSnapshot
+{
+public:
+	static volumesSnapshot& instance()
+	{
+		static volumesSnapshot m ;
+		return m ;
+	}
+	void invalidate()
+	{
+		{
+			std::lock_guard< std::mutex > lock( m_changedMutex ) ;
 
-			uint32_t hash = 0 ;
+			m_generation++ ;
+		}
+
+		m_changed.notify_all() ;
+	}
+	quint64 generation()
+	{
+		return m_generation.load() ;
+	}
+	void waitForChange( quint64 generation,std::chrono::milliseconds timeOut )
+	{
+		std::unique_lock< std::mutex > lock( m_changedMutex ) ;
 
-			auto p = e.toLatin1() ;
+		m_changed.wait_for( lock,timeOut,[ & ](){ return m_generation.load() != generation ; } ) ;
+	}
+	mountinfo::snapshot get( background_thread thread )
+	{
+		auto e = std::atomic_load( &m_entry ) ;
 
-			auto key = p.constData() ;
+		if( e && e->generation == m_generation.load() ){
 
-			auto l = p.size() ;
+			return e->volumes ;
+		}
 
-			for( decltype( l ) i = 0 ; i < l ; i++ ){
+		std::unique_lock< std::mutex > lock( m_mutex,std::try_to_lock ) ;
 
-				hash += *( key + i ) ;
+		if( !lock.owns_lock() ){
 
-				hash += ( hash << 10 ) ;
+			if( thread == background_thread::False ){
 
-				hash ^= ( hash >> 6 ) ;
+				/*
+				 * Reading volumes on windows spins the event loop and we may
+				 * get here again from the same thread while the lock is held.
+				 */
+				return std::make_shared< const std::vector< volumeInfo > >( _volumes( thread ) ) ;
 			}
 
-			hash += ( hash << 3 ) ;
+			lock.lock() ;
+		}
 
-			hash ^= ( hash >> 11 ) ;
+		/*
+		 * Somebody else may have refreshed the snapshot while we were waiting
+		 * for the lock.
+		 */
+		e = std::atomic_load( &m_entry ) ;
 
-			hash += ( hash << 15 ) ;
+		auto generation = m_generation.load() ;
 
-			return QString::number( hash ) ;
-		} ;
+		if( e && e->generation == generation ){
 
-		auto _decode = []( QString path,bool set_offset ){
+			return e->volumes ;
+		}
 
-			path.replace( "\\012","\n" ) ;
-			path.replace( "\\040"," " ) ;
-			path.replace( "\\134","\\" ) ;
-			path.replace( "\\011","\\t" ) ;
+		auto m = std::make_shared< entry >() ;
 
-			if( set_offset ){
+		m->generation = generation ;
+		m->volumes    = std::make_shared< const std::vector< volumeInfo > >( _volumes( thread ) ) ;
 
-				return path.mid( path.indexOf( '@' ) + 1 ) ;
-			}else{
-				return path ;
+		std::atomic_store( &m_entry,std::shared_ptr< const entry >( std::move( m ) ) ) ;
+
+		return std::atomic_load( &m_entry )->volumes ;
+	}
+private:
+	struct entry
+	{
+		quint64 generation ;
+		mountinfo::snapshot volumes ;
+	};
+
+	std::shared_ptr< const entry > m_entry ;
+	std::atomic< quint64 > m_generation{ 1 } ;
+	std::mutex m_mutex ;
+	std::mutex m_changedMutex ;
+	std::condition_variable m_changed ;
+};
+
+mountinfo::snapshot mountinfo::unlockedVolumesSnapshot()
+{
+	return volumesSnapshot::instance().get( background_thread::False ) ;
+}
+
+static bool _wait_for( const QString& m,int timeOut,bool mounted )
+{
+	auto& s = volumesSnapshot::instance() ;
+
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeOut ) ;
+
+	auto _mounted = [ & ](){
+
+		for( const auto& it : *s.get( background_thread::True ) ){
+
+			if( it.mountPoint() == m ){
+
+				return true ;
 			}
-		} ;
+		}
 
-		auto _fs = []( QString e ){
+		return false ;
+	} ;
 
-			e.replace( "fuse.","" ) ;
+	while( true ){
 
-			return e ;
-		} ;
+		auto generation = s.generation() ;
 
-		auto _ro = []( const QStringList& l ){
+		if( _mounted() == mounted ){
 
-			return l.at( 5 ).mid( 0,2 ) ;
-		} ;
+			return true ;
+		}
 
-		std::vector< volumeInfo > e ;
+		auto now = std::chrono::steady_clock::now() ;
 
-		volumeInfo::mountinfo info ;
+		if( now >= end ){
 
-		for( const auto& it : _unlocked_volumes( background_thread::True ) ){
+			return false ;
+		}
 
-			if( volumeInfo::supported( it ) ){
+		/*
+		 * Not all monitors see every change and hence we also look again every
+		 * now and then even if the monitor is quiet.
+		 */
+		auto left = std::chrono::duration_cast< std::chrono::milliseconds >( end - now ) ;
 
-				const auto& k = utility::split( it,' ' ) ;
+		s.waitForChange( generation,std::min( left,std::chrono::milliseconds( 250 ) ) ) ;
 
-				const auto s = k.size() ;
+		if( s.generation() == generation ){
 
-				if( s < 6 ){
+			s.invalidate() ;
+		}
+	}
+}
 
-					continue ;
-				}
+bool mountinfo::waitForUnmount( const QString& m,int timeOut )
+{
+	return _wait_for( m,timeOut,false ) ;
+}
+
+bool mountinfo::waitForMount( const QString& m,int timeOut )
+{
+	return _wait_for( m,timeOut,true ) ;
+}
+
+static std::mutex _backends_mutex ;
 
-				const auto& cf = k.at( s - 2 ) ;
+static std::vector< openFiles::process > _backends ;
 
-				const auto& m = k.at( 4 ) ;
+static bool _backends_watched = false ;
 
-				const auto& fs = k.at( s - 3 ) ;
+/*
+ * One thread watches the backends of all lazily unmounted volumes and of volumes
+ * whose cgroup has to be removed and it exits when none is left.
+ */
+static void _watch_backends()
+{
+	while( true ){
 
-				if( utility::startsWithAtLeastOne( cf,"encfs@",
-								   "cryfs@",
-								   "securefs@",
-								   "gocryptfs@",
-								   "sshfs@" ) ){
+		std::this_thread::sleep_for( std::chrono::seconds( 1 ) ) ;
 
-					info.volumePath = _decode( cf,true ) ;
+		std::unique_lock< std::mutex > lock( _backends_mutex ) ;
 
-				}else if( utility::equalsAtleastOne( fs,"fuse.gocryptfs",
-								     "ecryptfs","fuse.sshfs" ) ){
+		auto e = _backends ;
 
-					info.volumePath = _decode( cf,false ) ;
-				}else{
-					info.volumePath = _hash( m ) ;
-				}
+		lock.unlock() ;
+
+		for( const auto& it : e ){
 
-				info.mountPoint   = _decode( m,false ) ;
-				info.fileSystem   = _fs( fs ) ;
-				info.mode         = _ro( k ) ;
-				info.mountOptions = k.last() ;
+			if( !openFiles::waitForExit( { it },10 ) ){
 
-				e.emplace_back( info ) ;
+				continue ;
 			}
+
+			volumesSnapshot::instance().invalidate() ;
+
+			if( utility::debugEnabled() ){
+
+				auto m = QObject::tr( "Backend Of \"%1\" With Pid %2 Has Exited." ) ;
+
+				utility::debug() << m.arg( it.path,QString::number( it.pid ) ) ;
+			}
+
+			lock.lock() ;
+
+			_backends.erase( std::remove_if( _backends.begin(),_backends.end(),[ & ]( const openFiles::process& s ){
+
+				return s.pid == it.pid ;
+
+			} ),_backends.end() ) ;
+
+			lock.unlock() ;
+
+			/*
+			 * A process the backend left behind keeps the cgroup around and it
+			 * is watched in turn.
+			 */
+			mountinfo::watchBackend( backendResources::release( it.path ),it.path ) ;
 		}
 
-		return e ;
+		lock.lock() ;
+
+		if( _backends.empty() ){
+
+			_backends_watched = false ;
+
+			return ;
+		}
+	}
+}
+
+void mountinfo::watchBackend( qint64 pid,const QString& mountPoint )
+{
+	if( pid == -1 ){
+
+		return ;
+	}
+
+	std::lock_guard< std::mutex > lock( _backends_mutex ) ;
+
+	for( const auto& it : _backends ){
+
+		if( it.pid == pid ){
+
+			return ;
+		}
+	}
+
+	_backends.emplace_back( openFiles::process{ pid,QString(),mountPoint } ) ;
+
+	if( !_backends_watched ){
+
+		_backends_watched = true ;
+
+		std::thread( _watch_backends ).detach() ;
+	}
+}
+
+Task::future< std::vector< volumeInfo > >& mountinfo::unlockedVolumes()
+{
+	return Task::run( [](){
+
+		return *volumesSnapshot::instance().get( background_thread::True ) ;
+	} ) ;
+}
+
+Task::future< volumeInfo >& mountinfo::unlockedVolume( const QString& e )
+{
+	return Task::run( [ e ](){
+
+		volumeInfo::mountinfo info ;
+
+		/*
+		 * If "e" is a mount point,we can get its entry directly on linux
+		 * without going through all mounted volumes.
+		 */
+		if( _volume_info( _linux_volume( e ),info ) ){
+
+			return volumeInfo( info ) ;
+		}
+
+		for( const auto& it : *volumesSnapshot::instance().get( background_thread::True ) ){
+
+			if( it.volumePath() == e || it.mountPoint() == e ){
+
+				return it ;
+			}
+		}
+
+		return volumeInfo() ;
 	} ) ;
 }
 
@@ -383,6 +1110,8 @@ void mountinfo::volumeUpdate()
 
 void mountinfo::updateVolume()
 {
+	volumesSnapshot::instance().invalidate() ;
+
 	QMetaObject::invokeMethod( this,"volumeUpdate",Qt::QueuedConnection ) ;
 }
 
@@ -404,8 +1133,74 @@ void mountinfo::announceEvents( bool s )
 	m_announceEvents = s ;
 }
 
+/*
+ * A cheap way of telling if the list of mounted volumes may have changed without
+ * calling QStorageInfo::mountedVolumes(),which stats every mount.
+ * Returns false if the platform gives us no cheap way of telling.
+ */
+static bool _mounts_signature( quint64& e )
+{
+#ifdef Q_OS_LINUX
+	QFile f( "/proc/self/mountinfo" ) ;
+
+	if( f.open( QIODevice::ReadOnly ) ){
+
+		auto s = f.readAll() ;
+
+		e = ( quint64( s.size() ) << 32 ) | qHash( s ) ;
+
+		return true ;
+	}else{
+		return false ;
+	}
+#elif defined( Q_OS_MACOS )
+	auto n = getfsstat( nullptr,0,MNT_NOWAIT ) ;
+
+	if( n <= 0 ){
+
+		return false ;
+	}
+
+	std::vector< struct statfs > m( static_cast< size_t >( n ) + 8 ) ;
+
+	n = getfsstat( m.data(),static_cast< int >( m.size() * sizeof( struct statfs ) ),MNT_NOWAIT ) ;
+
+	if( n <= 0 ){
+
+		return false ;
+	}
+
+	QByteArray s ;
+
+	for( int i = 0 ; i < n ; i++ ){
+
+		const auto& it = m[ static_cast< size_t >( i ) ] ;
+
+		s += it.f_mntfromname ;
+		s += '\0' ;
+		s += it.f_mntonname ;
+		s += it.f_flags & MNT_RDONLY ? "ro" : "rw" ;
+	}
+
+	e = ( quint64( n ) << 32 ) | qHash( s ) ;
+
+	return true ;
+#else
+	Q_UNUSED( e ) ;
+	return false ;
+#endif
+}
+
 void mountinfo::linuxMonitor()
 {
+	if( !utility::pathExists( "/proc/self/mountinfo" ) ){
+
+		/*
+		 * procfs is not available,fall back to polling.
+		 */
+		return this->pollForUpdates() ;
+	}
+
 	auto s = std::addressof( Task::run( [ this ](){
 
 		QFile s( "/proc/self/mountinfo" ) ;
@@ -415,10 +1210,26 @@ void mountinfo::linuxMonitor()
 		m.fd     = s.handle() ;
 		m.events = POLLPRI ;
 
+		quint64 previous = 0 ;
+		quint64 signature = 0 ;
+
+		_mounts_signature( previous ) ;
+
 		while( true ){
 
 			poll( &m,1,-1 ) ;
 
+			/*
+			 * poll() also wakes up for changes that leave the list as it was,
+			 * like a mount that is undone before we get to read the list.
+			 */
+			if( _mounts_signature( signature ) && signature == previous ){
+
+				continue ;
+			}
+
+			previous = signature ;
+
 			this->updateVolume() ;
 		}
 	} ) ) ;
@@ -428,36 +1239,145 @@ void mountinfo::linuxMonitor()
 	s->then( std::move( m_quit ) ) ;
 }
 
+class pollSchedule
+{
+public:
+	static pollSchedule& instance()
+	{
+		static pollSchedule m ;
+		return m ;
+	}
+	/*
+	 * We are about to mount or unmount a volume,poll frequently for a while
+	 * so that the change shows up quickly.
+	 */
+	void expectChange()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_burstEnd = std::chrono::steady_clock::now() + std::chrono::seconds( 15 ) ;
+
+		m_wakeUp = true ;
+
+		m_cv.notify_all() ;
+	}
+	void wakeUp()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_wakeUp = true ;
+
+		m_cv.notify_all() ;
+	}
+	bool burst()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		return std::chrono::steady_clock::now() < m_burstEnd ;
+	}
+	void wait( int milliseconds )
+	{
+		std::unique_lock< std::mutex > lock( m_mutex ) ;
+
+		m_cv.wait_for( lock,std::chrono::milliseconds( milliseconds ),[ this ](){ return m_wakeUp ; } ) ;
+
+		m_wakeUp = false ;
+	}
+private:
+	std::mutex m_mutex ;
+	std::condition_variable m_cv ;
+	std::chrono::steady_clock::time_point m_burstEnd ;
+	bool m_wakeUp = false ;
+};
+
+void mountinfo::expectChange()
+{
+	volumesSnapshot::instance().invalidate() ;
+
+	pollSchedule::instance().expectChange() ;
+}
+
 void mountinfo::pollForUpdates()
 {
 	m_exit = false ;
 
-	m_stop = [ this ](){ m_exit = true ; } ;
+	m_stop = [ this ](){
+
+		m_exit = true ;
+
+		pollSchedule::instance().wakeUp() ;
+	} ;
+
+	/*
+	 * We poll every "burstInterval" milliseconds right after we mounted or unmounted
+	 * a volume and when nothing changes,we back off exponentially from the configured
+	 * interval to the configured maximum interval.
+	 */
+	const int burstInterval = 250 ;
+
+	auto interval = utility::pollForUpdatesInterval() * 1000 ;
+	auto ceiling  = utility::pollForUpdatesMaximumInterval() * 1000 ;
+
+	if( interval < burstInterval ){
+
+		interval = burstInterval ;
+	}
+
+	if( ceiling < interval ){
+
+		ceiling = interval ;
+	}
+
+	Task::run( [ this,interval,ceiling,burstInterval ](){
 
-	auto interval = utility::pollForUpdatesInterval() ;
+		auto& schedule = pollSchedule::instance() ;
 
-	Task::run( [ &,interval ](){
+		quint64 previousSignature = 0 ;
+		quint64 signature = 0 ;
+
+		auto useSignature = _mounts_signature( previousSignature ) ;
 
 		auto previous = QStorageInfo::mountedVolumes() ;
 		auto now = previous ;
 
+		auto wait = interval ;
+
 		while( true ){
 
+			auto burst = schedule.burst() ;
+
+			schedule.wait( burst ? burstInterval : wait ) ;
+
 			if( m_exit ){
 
 				break ;
-			}else{
-				utility::Task::wait( interval ) ;
+			}
 
-				now = QStorageInfo::mountedVolumes() ;
+			bool changed ;
 
-				if( now != previous ){
+			if( useSignature && _mounts_signature( signature ) ){
 
-					this->updateVolume() ;
-				}
+				changed = signature != previousSignature ;
+
+				previousSignature = signature ;
+			}else{
+				now = QStorageInfo::mountedVolumes() ;
+
+				changed = now != previous ;
 
 				previous = std::move( now ) ;
 			}
+
+			if( changed ){
+
+				this->updateVolume() ;
+
+				wait = interval ;
+
+			}else if( !burst ){
+
+				wait = std::min( wait * 2,ceiling ) ;
+			}
 		}
 
 	} ).then( std::move( m_quit ) ) ;
@@ -27,6 +27,7 @@
 #include <QProcess>
 #include <QVector>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -39,8 +40,39 @@ class mountinfo : private QObject
 public:
 	static QString encodeMountPath( const QString& ) ;
 
+	using snapshot = std::shared_ptr< const std::vector< volumeInfo > > ;
+
+	/*
+	 * Returns the most recent list of unlocked volumes.The list is only
+	 * re-read when the monitor noticed a change since it was last read.
+	 */
+	static mountinfo::snapshot unlockedVolumesSnapshot() ;
+
 	static Task::future< std::vector< volumeInfo > >& unlockedVolumes() ;
 
+	static Task::future< volumeInfo >& unlockedVolume( const QString& volumeOrMountPoint ) ;
+
+	static void expectChange() ;
+
+	/*
+	 * Blocks until nothing is mounted at "mountPoint" or until "timeOut" milliseconds
+	 * have passed and returns true if nothing is mounted there.It wakes up as soon as
+	 * the monitor notices a change and must not be called from the GUI thread.
+	 */
+	static bool waitForUnmount( const QString& mountPoint,int timeOut ) ;
+
+	/*
+	 * Like above but waits for something to be mounted at "mountPoint".
+	 */
+	static bool waitForMount( const QString& mountPoint,int timeOut ) ;
+
+	/*
+	 * A lazily unmounted volume disappears from the list of mounted volumes right
+	 * away while its backend keeps running until it is done flushing.This watches
+	 * the backend and reports when it exits,all backends share one thread.
+	 */
+	static void watchBackend( qint64 pid,const QString& mountPoint ) ;
+
 	mountinfo( QObject * parent,bool,std::function< void() >&& ) ;
 
 	void stop() ;
@@ -0,0 +1,205 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mountorchestrator.h"
+#include "utility.h"
+
+#include <QObject>
+
+static const size_t _no_parent = static_cast< size_t >( -1 ) ;
+
+static QString _directory( const QString& e )
+{
+	auto m = e ;
+
+	while( m.size() > 1 && m.endsWith( '/' ) ){
+
+		m.chop( 1 ) ;
+	}
+
+	return m ;
+}
+
+static bool _inside( const QString& path,const QString& mountPoint )
+{
+	if( mountPoint.isEmpty() ){
+
+		return false ;
+	}
+
+	auto m = _directory( mountPoint ) ;
+	auto e = _directory( path ) ;
+
+	return e == m || e.startsWith( m + "/" ) ;
+}
+
+void mountOrchestrator::run( std::vector< siritask::options > e,function_t f )
+{
+	if( e.empty() ){
+
+		f( {} ) ;
+	}else{
+		auto m = new mountOrchestrator( std::move( e ),std::move( f ) ) ;
+
+		m->next() ;
+	}
+}
+
+mountOrchestrator::mountOrchestrator( std::vector< siritask::options > e,function_t f ) :
+	m_function( std::move( f ) ),
+	m_maximum( static_cast< size_t >( utility::mountConcurrencyLimit() ) ),
+	m_remaining( e.size() )
+{
+	for( auto&& it : e ){
+
+		m_volumes.emplace_back( volume{ std::move( it ),
+						siritask::cmdStatus(),
+						mountOrchestrator::state::waiting,
+						_no_parent } ) ;
+	}
+
+	/*
+	 * The parent of a volume is the volume with the deepest mount point
+	 * that contains the cipher folder of the volume.
+	 */
+	for( size_t i = 0 ; i < m_volumes.size() ; i++ ){
+
+		auto& s = m_volumes[ i ] ;
+
+		int length = -1 ;
+
+		for( size_t j = 0 ; j < m_volumes.size() ; j++ ){
+
+			const auto& it = m_volumes[ j ] ;
+
+			if( i != j && _inside( s.options.cipherFolder,it.options.plainFolder ) ){
+
+				if( it.options.plainFolder.size() > length ){
+
+					length = it.options.plainFolder.size() ;
+					s.parent = j ;
+				}
+			}
+		}
+	}
+}
+
+void mountOrchestrator::next()
+{
+	auto _fail = [ this ]( volume& it,const QString& e ){
+
+		it.state  = mountOrchestrator::state::done ;
+		it.status = siritask::cmdStatus( siritask::status::backendFail,e ) ;
+
+		m_remaining-- ;
+	} ;
+
+	bool changed = true ;
+
+	while( changed ){
+
+		changed = false ;
+
+		for( size_t i = 0 ; i < m_volumes.size() ; i++ ){
+
+			auto& it = m_volumes[ i ] ;
+
+			if( it.state != mountOrchestrator::state::waiting ){
+
+				continue ;
+			}
+
+			if( it.parent != _no_parent ){
+
+				const auto& p = m_volumes[ it.parent ] ;
+
+				if( p.state != mountOrchestrator::state::done ){
+
+					continue ;
+				}
+
+				if( p.status != siritask::status::success ){
+
+					auto e = QObject::tr( "Not Unlocked Because \"%1\" Failed To Unlock." ) ;
+
+					_fail( it,e.arg( p.options.cipherFolder ) ) ;
+
+					changed = true ;
+
+					continue ;
+				}
+			}
+
+			if( m_running < m_maximum ){
+
+				it.state = mountOrchestrator::state::running ;
+
+				m_running++ ;
+
+				siritask::encryptedFolderMount( it.options ).then( [ this,i ]( siritask::cmdStatus s ){
+
+					this->finished( i,s ) ;
+				} ) ;
+			}
+		}
+	}
+
+	if( m_remaining > 0 && m_running == 0 ){
+
+		/*
+		 * Remaining volumes wait on each other's mount points and none of them can
+		 * ever start.
+		 */
+		for( auto& it : m_volumes ){
+
+			if( it.state == mountOrchestrator::state::waiting ){
+
+				_fail( it,QObject::tr( "Volumes Have Circular Mount Point Dependencies." ) ) ;
+			}
+		}
+	}
+
+	if( m_remaining == 0 ){
+
+		std::vector< mountOrchestrator::result > e ;
+
+		for( const auto& it : m_volumes ){
+
+			e.emplace_back( mountOrchestrator::result{ it.options,it.status } ) ;
+		}
+
+		m_function( e ) ;
+
+		delete this ;
+	}
+}
+
+void mountOrchestrator::finished( size_t i,const siritask::cmdStatus& s )
+{
+	auto& it = m_volumes[ i ] ;
+
+	it.state  = mountOrchestrator::state::done ;
+	it.status = s ;
+
+	m_running-- ;
+	m_remaining-- ;
+
+	this->next() ;
+}
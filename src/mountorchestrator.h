@@ -0,0 +1,76 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOUNT_ORCHESTRATOR_H
+#define MOUNT_ORCHESTRATOR_H
+
+#include <functional>
+#include <vector>
+
+#include "siritask.h"
+
+/*
+ * This class unlocks a list of volumes with up to "MountConcurrencyLimit" volumes
+ * being unlocked at the same time.
+ *
+ * A volume whose cipher folder lives inside the mount point of another volume in the
+ * list is only started after the other volume is unlocked and it is reported as failed
+ * without being tried if the other volume fails to unlock.
+ *
+ * The callback is called once on the main thread when all volumes are processed.
+ */
+class mountOrchestrator
+{
+public:
+	struct result
+	{
+		siritask::options options ;
+		siritask::cmdStatus status ;
+	} ;
+
+	using function_t = std::function< void( const std::vector< mountOrchestrator::result >& ) > ;
+
+	static void run( std::vector< siritask::options >,function_t ) ;
+private:
+	enum class state{ waiting,running,done } ;
+
+	struct volume
+	{
+		siritask::options options ;
+		siritask::cmdStatus status ;
+		mountOrchestrator::state state ;
+		size_t parent ;
+	} ;
+
+	mountOrchestrator( std::vector< siritask::options >,function_t ) ;
+
+	void next() ;
+	void finished( size_t,const siritask::cmdStatus& ) ;
+
+	std::vector< volume > m_volumes ;
+
+	function_t m_function ;
+
+	size_t m_maximum ;
+	size_t m_running = 0 ;
+	size_t m_remaining ;
+} ;
+
+#endif
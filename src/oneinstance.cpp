@@ -21,6 +21,7 @@
 #include "oneinstance.h"
 #include <QDebug>
 #include "utility.h"
+#include "rpc.h"
 #include <memory>
 #include <utility>
 
@@ -60,7 +61,12 @@ void oneinstance::gotConnection()
 
 	s->waitForReadyRead() ;
 
-	m_callbacks.event( s->readAll() ) ;
+	if( rpc::isFrame( s->peek( 1 ) ) && m_callbacks.rpc ){
+
+		m_callbacks.rpc( s.release() ) ;
+	}else{
+		m_callbacks.event( s->readAll() ) ;
+	}
 }
 
 void oneinstance::errorOnConnect( QLocalSocket::LocalSocketError e )
@@ -37,6 +37,7 @@ public:
 		std::function< void( const QString& ) > start ;
 		std::function< void() > exit ;
 		std::function< void( const QString& ) > event ;
+		std::function< void( QLocalSocket * ) > rpc ;
 	};
 
 	static void instance( QObject * a,const QString& b,
@@ -0,0 +1,539 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "openfiles.h"
+
+#include <QObject>
+
+#ifdef Q_OS_LINUX
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+struct match
+{
+	pid_t pid ;
+	std::string exe ;
+	std::string path ;
+} ;
+
+static bool _under( const std::string& path,const std::string& m )
+{
+	auto s = m.size() ;
+
+	return path.compare( 0,s,m ) == 0 && ( path.size() == s || path[ s ] == '/' ) ;
+}
+
+static bool _readlinkat( int dirfd,const char * name,std::string& e )
+{
+	char buffer[ 4096 ] ;
+
+	auto n = readlinkat( dirfd,name,buffer,sizeof( buffer ) ) ;
+
+	if( n <= 0 ){
+
+		return false ;
+	}else{
+		e.assign( buffer,static_cast< size_t >( n ) ) ;
+
+		return true ;
+	}
+}
+
+static bool _fd( int dirfd,const std::string& m,std::string& path )
+{
+	int fd = openat( dirfd,"fd",O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+
+	if( fd == -1 ){
+
+		return false ;
+	}
+
+	auto d = fdopendir( fd ) ;
+
+	if( !d ){
+
+		close( fd ) ;
+
+		return false ;
+	}
+
+	bool found = false ;
+
+	while( auto e = readdir( d ) ){
+
+		if( e->d_name[ 0 ] == '.' ){
+
+			continue ;
+		}
+
+		if( _readlinkat( fd,e->d_name,path ) && _under( path,m ) ){
+
+			found = true ;
+
+			break ;
+		}
+	}
+
+	closedir( d ) ;
+
+	return found ;
+}
+
+static bool _maps( int dirfd,const std::string& m,std::string& path )
+{
+	int fd = openat( dirfd,"maps",O_RDONLY | O_CLOEXEC ) ;
+
+	if( fd == -1 ){
+
+		return false ;
+	}
+
+	std::string s ;
+
+	char buffer[ 16384 ] ;
+
+	while( true ){
+
+		auto n = read( fd,buffer,sizeof( buffer ) ) ;
+
+		if( n <= 0 ){
+
+			break ;
+		}
+
+		s.append( buffer,static_cast< size_t >( n ) ) ;
+	}
+
+	close( fd ) ;
+
+	size_t start = 0 ;
+
+	while( start < s.size() ){
+
+		auto end = s.find( '\n',start ) ;
+
+		if( end == std::string::npos ){
+
+			end = s.size() ;
+		}
+
+		/*
+		 * The path is the last column and it is the only one that starts with a '/'.
+		 */
+		auto p = s.find( '/',start ) ;
+
+		if( p < end ){
+
+			auto e = s.substr( p,end - p ) ;
+
+			if( _under( e,m ) ){
+
+				path = std::move( e ) ;
+
+				return true ;
+			}
+		}
+
+		start = end + 1 ;
+	}
+
+	return false ;
+}
+
+static bool _scan( int proc,const char * pid,const std::string& m,match& e )
+{
+	int dirfd = openat( proc,pid,O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+
+	if( dirfd == -1 ){
+
+		return false ;
+	}
+
+	auto found = [ & ](){
+
+		if( _readlinkat( dirfd,"cwd",e.path ) && _under( e.path,m ) ){
+
+			return true ;
+		}
+
+		if( _fd( dirfd,m,e.path ) ){
+
+			return true ;
+		}
+
+		return _maps( dirfd,m,e.path ) ;
+	}() ;
+
+	if( found ){
+
+		e.pid = static_cast< pid_t >( std::stol( pid ) ) ;
+
+		_readlinkat( dirfd,"exe",e.exe ) ;
+	}
+
+	close( dirfd ) ;
+
+	return found ;
+}
+
+std::vector< openFiles::process > openFiles::holders( const QString& mountPoint )
+{
+	std::vector< openFiles::process > s ;
+
+	auto m = mountPoint.toStdString() ;
+
+	while( m.size() > 1 && m.back() == '/' ){
+
+		m.pop_back() ;
+	}
+
+	if( m.empty() || m == "/" ){
+
+		return s ;
+	}
+
+	int proc = open( "/proc",O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+
+	if( proc == -1 ){
+
+		return s ;
+	}
+
+	std::vector< std::string > pids ;
+
+	auto self = std::to_string( getpid() ) ;
+
+	if( auto d = opendir( "/proc" ) ){
+
+		while( auto e = readdir( d ) ){
+
+			if( e->d_name[ 0 ] >= '1' && e->d_name[ 0 ] <= '9' && self != e->d_name ){
+
+				pids.emplace_back( e->d_name ) ;
+			}
+		}
+
+		closedir( d ) ;
+	}
+
+	/*
+	 * Every thread takes the next process from a shared counter,reading maps of
+	 * big processes takes much longer than reading the rest.
+	 */
+	size_t threads = std::max( 1u,std::min( std::thread::hardware_concurrency(),8u ) ) ;
+
+	threads = std::min( threads,pids.size() / 32 + 1 ) ;
+
+	std::atomic< size_t > next{ 0 } ;
+
+	std::vector< std::vector< match > > results( threads ) ;
+
+	auto _worker = [ & ]( size_t w ){
+
+		match e ;
+
+		for( auto i = next++ ; i < pids.size() ; i = next++ ){
+
+			if( _scan( proc,pids[ i ].c_str(),m,e ) ){
+
+				results[ w ].emplace_back( std::move( e ) ) ;
+
+				e = match() ;
+			}
+		}
+	} ;
+
+	std::vector< std::thread > workers ;
+
+	for( size_t w = 1 ; w < threads ; w++ ){
+
+		workers.emplace_back( _worker,w ) ;
+	}
+
+	_worker( 0 ) ;
+
+	for( auto& it : workers ){
+
+		it.join() ;
+	}
+
+	close( proc ) ;
+
+	for( const auto& it : results ){
+
+		for( const auto& xt : it ){
+
+			s.emplace_back( openFiles::process{ xt.pid,
+							    QString::fromStdString( xt.exe ),
+							    QString::fromStdString( xt.path ) } ) ;
+		}
+	}
+
+	std::sort( s.begin(),s.end(),[]( const openFiles::process& a,const openFiles::process& b ){
+
+		return a.pid < b.pid ;
+	} ) ;
+
+	return s ;
+}
+
+/*
+ * Other programs,file managers and shells among them,can have the mount point as
+ * an argument too.
+ */
+static bool _is_backend( const std::string& cmdline )
+{
+	auto exe = cmdline.substr( 0,cmdline.find( '\0' ) ) ;
+
+	auto m = exe.rfind( '/' ) ;
+
+	if( m != std::string::npos ){
+
+		exe = exe.substr( m + 1 ) ;
+	}
+
+	for( const char * it : { "cryfs","gocryptfs","securefs","encfs","sshfs","ecryptfs-simple" } ){
+
+		if( exe == it ){
+
+			return true ;
+		}
+	}
+
+	return false ;
+}
+
+qint64 openFiles::backend( const QString& mountPoint )
+{
+	auto m = mountPoint.toStdString() ;
+
+	auto d = opendir( "/proc" ) ;
+
+	if( !d ){
+
+		return -1 ;
+	}
+
+	qint64 pid = -1 ;
+
+	auto self = std::to_string( getpid() ) ;
+
+	std::string s ;
+
+	char buffer[ 4096 ] ;
+
+	while( auto e = readdir( d ) ){
+
+		if( e->d_name[ 0 ] < '1' || e->d_name[ 0 ] > '9' || self == e->d_name ){
+
+			continue ;
+		}
+
+		auto path = std::string( "/proc/" ) + e->d_name + "/cmdline" ;
+
+		int fd = open( path.c_str(),O_RDONLY | O_CLOEXEC ) ;
+
+		if( fd == -1 ){
+
+			continue ;
+		}
+
+		s.clear() ;
+
+		while( true ){
+
+			auto n = read( fd,buffer,sizeof( buffer ) ) ;
+
+			if( n <= 0 ){
+
+				break ;
+			}
+
+			s.append( buffer,static_cast< size_t >( n ) ) ;
+		}
+
+		close( fd ) ;
+
+		if( !_is_backend( s ) ){
+
+			continue ;
+		}
+
+		/*
+		 * Arguments are separated by '\0'.
+		 */
+		for( size_t start = 0 ; start < s.size() ; ){
+
+			auto end = s.find( '\0',start ) ;
+
+			if( end == std::string::npos ){
+
+				end = s.size() ;
+			}
+
+			if( s.compare( start,end - start,m ) == 0 ){
+
+				pid = std::stoll( e->d_name ) ;
+
+				break ;
+			}
+
+			start = end + 1 ;
+		}
+
+		if( pid != -1 ){
+
+			break ;
+		}
+	}
+
+	closedir( d ) ;
+
+	return pid ;
+}
+
+bool openFiles::waitForExit( const std::vector< openFiles::process >& e,int timeOut )
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds( timeOut ) ;
+
+	std::vector< pollfd > fds ;
+
+	/*
+	 * Processes are watched through pidfds and we fall back to checking if they
+	 * are still alive every 100ms on kernels without pidfd_open().
+	 */
+	std::vector< pid_t > polled ;
+
+	for( const auto& it : e ){
+
+		auto pid = static_cast< pid_t >( it.pid ) ;
+
+		int fd = static_cast< int >( syscall( SYS_pidfd_open,pid,0 ) ) ;
+
+		if( fd != -1 ){
+
+			fds.emplace_back( pollfd{ fd,POLLIN,0 } ) ;
+
+		}else if( errno != ESRCH ){
+
+			polled.emplace_back( pid ) ;
+		}
+	}
+
+	auto _close = [ & ](){
+
+		for( const auto& it : fds ){
+
+			close( it.fd ) ;
+		}
+	} ;
+
+	while( true ){
+
+		polled.erase( std::remove_if( polled.begin(),polled.end(),[]( pid_t pid ){
+
+			return kill( pid,0 ) == -1 && errno == ESRCH ;
+
+		} ),polled.end() ) ;
+
+		if( fds.empty() && polled.empty() ){
+
+			return true ;
+		}
+
+		auto now = std::chrono::steady_clock::now() ;
+
+		if( now >= end ){
+
+			_close() ;
+
+			return false ;
+		}
+
+		auto left = std::chrono::duration_cast< std::chrono::milliseconds >( end - now ).count() ;
+
+		int wait = static_cast< int >( polled.empty() ? left : std::min( left,decltype( left )( 100 ) ) ) ;
+
+		if( poll( fds.data(),fds.size(),wait ) > 0 ){
+
+			for( auto it = fds.begin() ; it != fds.end() ; ){
+
+				if( it->revents ){
+
+					close( it->fd ) ;
+
+					it = fds.erase( it ) ;
+				}else{
+					it++ ;
+				}
+			}
+		}
+	}
+}
+
+#else
+
+std::vector< openFiles::process > openFiles::holders( const QString& )
+{
+	return {} ;
+}
+
+qint64 openFiles::backend( const QString& )
+{
+	return -1 ;
+}
+
+bool openFiles::waitForExit( const std::vector< openFiles::process >&,int )
+{
+	return true ;
+}
+
+#endif
+
+QString openFiles::report( const std::vector< openFiles::process >& e )
+{
+	QString s ;
+
+	for( const auto& it : e ){
+
+		auto exe = it.exe.isEmpty() ? QObject::tr( "Unknown" ) : it.exe ;
+
+		s += QString( "%1 %2: \"%3\"\n" ).arg( QString::number( it.pid ),exe,it.path ) ;
+	}
+
+	return s ;
+}
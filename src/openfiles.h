@@ -0,0 +1,60 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPEN_FILES_H
+#define OPEN_FILES_H
+
+#include <QString>
+
+#include <vector>
+
+/*
+ * Finds processes that keep a mount point busy by having a file under it open,
+ * by having their working directory under it or by having a file under it mapped
+ * into memory.Only implemented on linux,other platforms get an empty list.
+ */
+namespace openFiles
+{
+	struct process
+	{
+		qint64 pid ;
+		QString exe ;
+		QString path ;
+	} ;
+
+	std::vector< openFiles::process > holders( const QString& mountPoint ) ;
+
+	QString report( const std::vector< openFiles::process >& ) ;
+
+	/*
+	 * Returns the pid of the backend process that was started with "mountPoint" as
+	 * one of its arguments,this is how backends are started.Only processes of known
+	 * backend executables are considered.Returns -1 if there is none.
+	 */
+	qint64 backend( const QString& mountPoint ) ;
+
+	/*
+	 * Blocks until all processes in the list exit or until "timeOut" milliseconds
+	 * have passed and returns true if all of them exited.
+	 */
+	bool waitForExit( const std::vector< openFiles::process >&,int timeOut ) ;
+}
+
+#endif
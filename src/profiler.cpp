@@ -0,0 +1,315 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+#include "utility.h"
+#include "json.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+struct phaseRecord
+{
+	const char * name ;
+	qint64 nanoSeconds ;
+} ;
+
+struct profileRecord
+{
+	QString volume ;
+	QString backend ;
+	qint64 startedAt ;
+	std::chrono::steady_clock::time_point start ;
+	std::vector< phaseRecord > phases ;
+	qint64 backendUser = -1 ;
+	qint64 backendSystem = -1 ;
+} ;
+
+static std::mutex _mutex ;
+
+static QString _json_file ;
+
+/*
+ * Phases of a volume whose unlocking never reached profiler::begin(),because
+ * the key could not be retrieved for example,are dropped after a while.
+ */
+struct pendingRecord
+{
+	std::chrono::steady_clock::time_point updated ;
+	std::vector< phaseRecord > phases ;
+} ;
+
+static const std::chrono::minutes _pending_lifetime( 5 ) ;
+
+static QHash< QString,pendingRecord > _pending ;
+
+static thread_local profileRecord * _current = nullptr ;
+
+static double _milliSeconds( qint64 nanoSeconds )
+{
+	return static_cast< double >( nanoSeconds ) / 1000000 ;
+}
+
+profiler::phase::phase( const char * name,const QString& volume ) :
+	m_name( name ),m_volume( volume ),m_enabled( profiler::enabled() )
+{
+	if( m_enabled ){
+
+		m_start = std::chrono::steady_clock::now() ;
+	}
+}
+
+profiler::phase::~phase()
+{
+	this->end() ;
+}
+
+void profiler::phase::end()
+{
+	if( !m_enabled ){
+
+		return ;
+	}
+
+	m_enabled = false ;
+
+	auto now = std::chrono::steady_clock::now() ;
+
+	phaseRecord r{ m_name,std::chrono::duration_cast< std::chrono::nanoseconds >( now - m_start ).count() } ;
+
+	if( m_volume.isEmpty() ){
+
+		if( _current ){
+
+			_current->phases.emplace_back( r ) ;
+		}
+	}else{
+		std::lock_guard< std::mutex > lock( _mutex ) ;
+
+		for( auto it = _pending.begin() ; it != _pending.end() ; ){
+
+			if( now - it->updated > _pending_lifetime ){
+
+				it = _pending.erase( it ) ;
+			}else{
+				it++ ;
+			}
+		}
+
+		auto& e = _pending[ m_volume ] ;
+
+		e.updated = now ;
+		e.phases.emplace_back( r ) ;
+	}
+}
+
+void profiler::setJsonFile( const QString& e )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	_json_file = e ;
+}
+
+bool profiler::enabled()
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	return utility::debugEnabled() || !_json_file.isEmpty() ;
+}
+
+void profiler::begin( const QString& volume )
+{
+	if( !profiler::enabled() ){
+
+		return ;
+	}
+
+	delete _current ;
+
+	_current = new profileRecord ;
+
+	_current->volume    = volume ;
+	_current->startedAt = QDateTime::currentMSecsSinceEpoch() ;
+	_current->start     = std::chrono::steady_clock::now() ;
+
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	_current->phases = _pending.take( volume ).phases ;
+}
+
+void profiler::backend( const QString& e )
+{
+	if( _current ){
+
+		_current->backend = e ;
+	}
+}
+
+/*
+ * User and system time in milliseconds of a process together with that of its
+ * reaped children,from fields 14 to 17 of /proc/<pid>/stat.
+ */
+static bool _cpu_times( qint64 pid,qint64& user,qint64& system )
+{
+#ifdef Q_OS_LINUX
+	QFile f( "/proc/" + QString::number( pid ) + "/stat" ) ;
+
+	if( !f.open( QIODevice::ReadOnly ) ){
+
+		return false ;
+	}
+
+	auto m = f.readAll() ;
+
+	/*
+	 * The executable name comes second and it may have spaces and brackets.
+	 */
+	auto e = m.mid( m.lastIndexOf( ')' ) + 1 ).simplified().split( ' ' ) ;
+
+	if( e.size() < 15 ){
+
+		return false ;
+	}
+
+	auto ticks = sysconf( _SC_CLK_TCK ) ;
+
+	if( ticks <= 0 ){
+
+		return false ;
+	}
+
+	auto _ms = [ & ]( int a,int b ){
+
+		return ( e.at( a ).toLongLong() + e.at( b ).toLongLong() ) * 1000 / ticks ;
+	} ;
+
+	user   = _ms( 11,13 ) ;
+	system = _ms( 12,14 ) ;
+
+	return true ;
+#else
+	Q_UNUSED( pid ) ;
+	Q_UNUSED( user ) ;
+	Q_UNUSED( system ) ;
+
+	return false ;
+#endif
+}
+
+void profiler::backendProcess( qint64 pid )
+{
+	if( _current && pid != -1 ){
+
+		_cpu_times( pid,_current->backendUser,_current->backendSystem ) ;
+	}
+}
+
+void profiler::end( bool success )
+{
+	if( !_current ){
+
+		return ;
+	}
+
+	std::unique_ptr< profileRecord > m( _current ) ;
+
+	_current = nullptr ;
+
+	/*
+	 * "total" is the time between profiler::begin() and profiler::end() and hence
+	 * it does not include phases recorded before profiler::begin().
+	 */
+	auto total = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - m->start ).count() ;
+
+	if( utility::debugEnabled() ){
+
+		auto s = QString( "Unlock Profile Of \"%1\"(%2,%3):" ) ;
+
+		s = s.arg( m->volume,m->backend,success ? "success" : "failed" ) ;
+
+		for( const auto& it : m->phases ){
+
+			s += QString( "\n  %1 %2ms" ).arg( it.name,-20 ).arg( _milliSeconds( it.nanoSeconds ),9,'f',1 ) ;
+		}
+
+		s += QString( "\n  %1 %2ms" ).arg( "total",-20 ).arg( _milliSeconds( total ),9,'f',1 ) ;
+
+		if( m->backendUser != -1 ){
+
+			auto u = QString::number( m->backendUser ) ;
+			auto e = QString::number( m->backendSystem ) ;
+
+			s += QString( "\n  backend cpu: user %1ms,system %2ms" ).arg( u,e ) ;
+		}
+
+		utility::debug() << s ;
+	}
+
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	if( _json_file.isEmpty() ){
+
+		return ;
+	}
+
+	nlohmann::json json ;
+
+	json[ "volume" ]    = m->volume.toStdString() ;
+	json[ "backend" ]   = m->backend.toStdString() ;
+	json[ "success" ]   = success ;
+	json[ "startedAt" ] = m->startedAt ;
+	json[ "totalMs" ]   = _milliSeconds( total ) ;
+
+	auto phases = nlohmann::json::array() ;
+
+	for( const auto& it : m->phases ){
+
+		nlohmann::json e ;
+
+		e[ "name" ] = it.name ;
+		e[ "ms" ]   = _milliSeconds( it.nanoSeconds ) ;
+
+		phases.push_back( std::move( e ) ) ;
+	}
+
+	json[ "phases" ] = std::move( phases ) ;
+
+	if( m->backendUser != -1 ){
+
+		json[ "backendUserMs" ]   = m->backendUser ;
+		json[ "backendSystemMs" ] = m->backendSystem ;
+	}
+
+	QFile f( _json_file ) ;
+
+	if( f.open( QIODevice::WriteOnly | QIODevice::Append ) ){
+
+		f.write( ( json.dump() + "\n" ).c_str() ) ;
+	}
+}
@@ -0,0 +1,74 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+
+#include <chrono>
+
+/*
+ * Records how long each phase of unlocking a volume takes.
+ *
+ * Unlocking a volume starts on the GUI thread where the key is retrieved and it
+ * continues on a worker thread.Phases recorded before profiler::begin() is called
+ * for a volume are kept by volume path and they are picked up by profiler::begin(),
+ * phases recorded after it go to the volume the current thread is unlocking.Phases
+ * of a volume that never gets to profiler::begin() are dropped after 5 minutes.
+ *
+ * profiler::end() prints a breakdown when "--debug" is given and appends a JSON
+ * line to the file given with "--profile-json".Nothing is recorded otherwise.
+ *
+ * CPU time of the backend is read from /proc/<pid>/stat of the backend process that
+ * serves the mount once it is usable,it covers the backend and the children it reaped
+ * but not a launcher process that exited after the backend daemonized.Only recorded
+ * on linux.
+ */
+class profiler
+{
+public:
+	class phase
+	{
+	public:
+		phase( const char * name,const QString& volume = QString() ) ;
+		/*
+		 * Ends the phase before the object goes out of scope.
+		 */
+		void end() ;
+		~phase() ;
+	private:
+		const char * m_name ;
+		QString m_volume ;
+		bool m_enabled ;
+		std::chrono::steady_clock::time_point m_start ;
+	} ;
+
+	static void setJsonFile( const QString& ) ;
+
+	static bool enabled() ;
+
+	static void begin( const QString& volume ) ;
+	static void backend( const QString& ) ;
+	static void backendProcess( qint64 pid ) ;
+	static void end( bool success ) ;
+} ;
+
+#endif
@@ -0,0 +1,833 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rpc.h"
+#include "utility.h"
+#include "siritask.h"
+#include "mountinfo.h"
+#include "openfiles.h"
+#include "keydialog.h"
+#include "secrets.h"
+#include "favorites.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDir>
+
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+#ifndef Q_OS_WIN
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#endif
+
+static const int _parse_error      = -32700 ;
+static const int _invalid_request  = -32600 ;
+static const int _method_not_found = -32601 ;
+static const int _invalid_params   = -32602 ;
+static const int _failed           = -32000 ;
+
+/*
+ * Nothing we send or expect to receive comes anywhere close to this size,a
+ * bigger message means the peer is confused and it gets disconnected.
+ */
+static const quint32 _max_message_size = 4 * 1024 * 1024 ;
+
+static const int _header_size = 5 ;
+
+QString rpc::socketPath()
+{
+	return utility::socketPath() + "/SiriKali.socket" ;
+}
+
+QByteArray rpc::frame( const nlohmann::json& e )
+{
+	auto s = e.dump() ;
+
+	auto n = static_cast< quint32 >( s.size() ) ;
+
+	QByteArray m ;
+
+	m.reserve( _header_size + static_cast< int >( s.size() ) ) ;
+
+	m.append( '\0' ) ;
+	m.append( static_cast< char >( ( n >> 24 ) & 0xff ) ) ;
+	m.append( static_cast< char >( ( n >> 16 ) & 0xff ) ) ;
+	m.append( static_cast< char >( ( n >> 8 ) & 0xff ) ) ;
+	m.append( static_cast< char >( n & 0xff ) ) ;
+	m.append( s.data(),static_cast< int >( s.size() ) ) ;
+
+	return m ;
+}
+
+bool rpc::isFrame( const QByteArray& e )
+{
+	return !e.isEmpty() && e.at( 0 ) == '\0' ;
+}
+
+static quint32 _message_size( const QByteArray& e )
+{
+	auto s = reinterpret_cast< const unsigned char * >( e.constData() ) ;
+
+	return ( quint32( s[ 1 ] ) << 24 ) | ( quint32( s[ 2 ] ) << 16 ) | ( quint32( s[ 3 ] ) << 8 ) | quint32( s[ 4 ] ) ;
+}
+
+rpc::unframed rpc::unframe( QByteArray& e,nlohmann::json& m )
+{
+	if( e.isEmpty() ){
+
+		return rpc::unframed::incomplete ;
+	}
+
+	if( !rpc::isFrame( e ) ){
+
+		return rpc::unframed::invalid ;
+	}
+
+	if( e.size() < _header_size ){
+
+		return rpc::unframed::incomplete ;
+	}
+
+	auto n = _message_size( e ) ;
+
+	if( n > _max_message_size ){
+
+		return rpc::unframed::invalid ;
+	}
+
+	if( quint32( e.size() - _header_size ) < n ){
+
+		return rpc::unframed::incomplete ;
+	}
+
+	auto s = e.mid( _header_size,static_cast< int >( n ) ) ;
+
+	e.remove( 0,_header_size + static_cast< int >( n ) ) ;
+
+	try{
+		m = nlohmann::json::parse( s.constData() ) ;
+
+	}catch( ... ){
+
+		m = nlohmann::json( nlohmann::json::value_t::discarded ) ;
+	}
+
+	return rpc::unframed::message ;
+}
+
+#ifndef Q_OS_WIN
+
+static bool _write( int fd,const QByteArray& e )
+{
+	auto s = e.constData() ;
+	auto n = static_cast< size_t >( e.size() ) ;
+
+	while( n > 0 ){
+
+		auto r = ::write( fd,s,n ) ;
+
+		if( r == -1 ){
+
+			if( errno == EINTR ){
+
+				continue ;
+			}
+
+			return false ;
+		}
+
+		s += r ;
+		n -= static_cast< size_t >( r ) ;
+	}
+
+	return true ;
+}
+
+static bool _read( int fd,nlohmann::json& response,int timeOut )
+{
+	using clock = std::chrono::steady_clock ;
+
+	auto deadline = clock::now() + std::chrono::milliseconds( timeOut ) ;
+
+	QByteArray buffer ;
+
+	char m[ 4096 ] ;
+
+	while( true ){
+
+		auto e = rpc::unframe( buffer,response ) ;
+
+		if( e == rpc::unframed::message ){
+
+			return !response.is_discarded() ;
+
+		}else if( e == rpc::unframed::invalid ){
+
+			return false ;
+		}
+
+		int wait = -1 ;
+
+		if( timeOut >= 0 ){
+
+			auto s = std::chrono::duration_cast< std::chrono::milliseconds >( deadline - clock::now() ) ;
+
+			if( s.count() <= 0 ){
+
+				return false ;
+			}
+
+			wait = static_cast< int >( s.count() ) ;
+		}
+
+		struct pollfd p ;
+
+		p.fd      = fd ;
+		p.events  = POLLIN ;
+		p.revents = 0 ;
+
+		auto r = ::poll( &p,1,wait ) ;
+
+		if( r == -1 && errno == EINTR ){
+
+			continue ;
+		}
+
+		if( r <= 0 ){
+
+			return false ;
+		}
+
+		auto n = ::read( fd,m,sizeof( m ) ) ;
+
+		if( n == -1 && errno == EINTR ){
+
+			continue ;
+		}
+
+		if( n <= 0 ){
+
+			return false ;
+		}
+
+		buffer.append( m,static_cast< int >( n ) ) ;
+	}
+}
+
+static bool _call( int fd,const nlohmann::json& request,nlohmann::json& response,int timeOut )
+{
+	auto path = rpc::socketPath().toStdString() ;
+
+	struct sockaddr_un addr ;
+
+	std::memset( &addr,0,sizeof( addr ) ) ;
+
+	if( path.size() >= sizeof( addr.sun_path ) ){
+
+		return false ;
+	}
+
+	addr.sun_family = AF_UNIX ;
+
+	std::memcpy( addr.sun_path,path.data(),path.size() ) ;
+
+	if( ::connect( fd,reinterpret_cast< struct sockaddr * >( &addr ),sizeof( addr ) ) != 0 ){
+
+		return false ;
+	}
+
+	return _write( fd,rpc::frame( request ) ) && _read( fd,response,timeOut ) ;
+}
+
+#endif
+
+bool rpc::call( const QString& method,const nlohmann::json& params,nlohmann::json& response,int timeOut )
+{
+#ifdef Q_OS_WIN
+	Q_UNUSED( method ) ;
+	Q_UNUSED( params ) ;
+	Q_UNUSED( response ) ;
+	Q_UNUSED( timeOut ) ;
+
+	return false ;
+#else
+	nlohmann::json request ;
+
+	request[ "jsonrpc" ] = "2.0" ;
+	request[ "id" ]      = 1 ;
+	request[ "method" ]  = method.toStdString() ;
+	request[ "params" ]  = params ;
+
+	int fd = ::socket( AF_UNIX,SOCK_STREAM,0 ) ;
+
+	if( fd == -1 ){
+
+		return false ;
+	}
+
+	::fcntl( fd,F_SETFD,FD_CLOEXEC ) ;
+
+	auto s = _call( fd,request,response,timeOut ) ;
+
+	::close( fd ) ;
+
+	return s ;
+#endif
+}
+
+static QString _error_message( const nlohmann::json& e )
+{
+	auto it = e.find( "error" ) ;
+
+	if( it != e.end() && it->is_object() ){
+
+		return QString::fromStdString( it->value( "message",std::string() ) ) ;
+	}else{
+		return QString() ;
+	}
+}
+
+/*
+ * The daemon runs in its own working directory,relative paths given on the
+ * command line are resolved here before they are sent to it.
+ */
+static std::string _absolute_path( const QString& e )
+{
+	if( e.isEmpty() ){
+
+		return std::string() ;
+	}else{
+		return QDir( e ).absolutePath().toStdString() ;
+	}
+}
+
+bool rpc::cliCommand( int argc,char * argv[],int& exitCode )
+{
+	QStringList l ;
+
+	for( int i = 0 ; i < argc ; i++ ){
+
+		l.append( QString::fromLocal8Bit( argv[ i ] ) ) ;
+	}
+
+	if( l.contains( "-s" ) ){
+
+		return false ;
+	}
+
+	nlohmann::json response ;
+
+	if( l.contains( "-u" ) ){
+
+		nlohmann::json params ;
+
+		params[ "volume" ] = _absolute_path( utility::cmdArgumentValue( l,"-d" ) ) ;
+
+		/*
+		 * A daemon that does not answer in time is treated as absent and the
+		 * volume is unmounted by this process.
+		 */
+		if( !rpc::call( "unmount",params,response,30000 ) ){
+
+			return false ;
+		}
+
+		if( response.find( "result" ) != response.end() ){
+
+			exitCode = 0 ;
+		}else{
+			auto e = _error_message( response ) ;
+
+			if( !e.isEmpty() ){
+
+				std::cout << e.toStdString() << std::endl ;
+			}
+
+			exitCode = 1 ;
+		}
+
+		return true ;
+	}
+
+	if( l.contains( "-p" ) ){
+
+		if( !rpc::call( "list",nlohmann::json::object(),response,5000 ) ){
+
+			return false ;
+		}
+
+		auto it = response.find( "result" ) ;
+
+		if( it == response.end() || !it->is_array() ){
+
+			exitCode = 1 ;
+
+			return true ;
+		}
+
+		for( const auto& e : *it ){
+
+			std::cout << "\"" + e.value( "volumePath",std::string() ) +
+				     "\" \"" + e.value( "mountPoint",std::string() ) +
+				     "\" \"" + e.value( "fileSystem",std::string() ) +
+				     "\"" << std::endl ;
+		}
+
+		exitCode = 0 ;
+
+		return true ;
+	}
+
+	return false ;
+}
+
+static nlohmann::json _volume( const volumeInfo& e )
+{
+	const auto& s = e.mountInfo() ;
+
+	nlohmann::json m ;
+
+	m[ "volumePath" ]   = s.volumePath.toStdString() ;
+	m[ "mountPoint" ]   = s.mountPoint.toStdString() ;
+	m[ "fileSystem" ]   = s.fileSystem.toStdString() ;
+	m[ "mode" ]         = s.mode.toStdString() ;
+	m[ "idleTimeOut" ]  = s.idleTimeout.toStdString() ;
+	m[ "mountOptions" ] = s.mountOptions.toStdString() ;
+
+	return m ;
+}
+
+static nlohmann::json _volumes()
+{
+	auto m = nlohmann::json::array() ;
+
+	for( const auto& it : *mountinfo::unlockedVolumesSnapshot() ){
+
+		m.push_back( _volume( it ) ) ;
+	}
+
+	return m ;
+}
+
+static volumeInfo _find( const QString& e )
+{
+	for( const auto& it : *mountinfo::unlockedVolumesSnapshot() ){
+
+		if( it.volumePath() == e || it.mountPoint() == e ){
+
+			return it ;
+		}
+	}
+
+	return {} ;
+}
+
+static QString _string( const nlohmann::json& e,const char * key )
+{
+	auto it = e.find( key ) ;
+
+	if( it != e.end() && it->is_string() ){
+
+		return QString::fromStdString( it->get< std::string >() ) ;
+	}else{
+		return QString() ;
+	}
+}
+
+static QString _path( const QString& e )
+{
+	auto s = QDir( e ).canonicalPath() ;
+
+	if( s.isEmpty() ){
+
+		return e ;
+	}else{
+		return s ;
+	}
+}
+
+rpc::rpc( QObject * parent,secrets& s ) : QObject( parent ),m_secrets( s )
+{
+}
+
+void rpc::addClient( QLocalSocket * s )
+{
+	s->setParent( this ) ;
+
+	m_buffers[ s ] ;
+
+	auto _read = [ this,s ](){
+
+		auto& buffer = m_buffers[ s ] ;
+
+		buffer.append( s->readAll() ) ;
+
+		std::vector< nlohmann::json > requests ;
+
+		nlohmann::json m ;
+
+		while( true ){
+
+			auto e = rpc::unframe( buffer,m ) ;
+
+			if( e == rpc::unframed::message ){
+
+				requests.emplace_back( std::move( m ) ) ;
+
+			}else if( e == rpc::unframed::invalid ){
+
+				return s->abort() ;
+			}else{
+				break ;
+			}
+		}
+
+		QPointer< QLocalSocket > p( s ) ;
+
+		for( const auto& it : requests ){
+
+			if( p ){
+
+				this->request( s,it ) ;
+			}
+		}
+	} ;
+
+	connect( s,&QLocalSocket::readyRead,_read ) ;
+
+	connect( s,&QLocalSocket::disconnected,[ this,s ](){
+
+		m_buffers.erase( s ) ;
+
+		auto it = std::find( m_subscribers.begin(),m_subscribers.end(),s ) ;
+
+		if( it != m_subscribers.end() ){
+
+			m_subscribers.erase( it ) ;
+		}
+
+		s->deleteLater() ;
+	} ) ;
+
+	_read() ;
+}
+
+void rpc::volumesChanged()
+{
+	if( m_subscribers.empty() ){
+
+		return ;
+	}
+
+	nlohmann::json m ;
+
+	m[ "jsonrpc" ] = "2.0" ;
+	m[ "method" ]  = "volumesChanged" ;
+	m[ "params" ][ "volumes" ] = _volumes() ;
+
+	auto e = rpc::frame( m ) ;
+
+	for( auto it : m_subscribers ){
+
+		it->write( e ) ;
+	}
+}
+
+void rpc::request( QLocalSocket * s,const nlohmann::json& e )
+{
+	if( e.is_discarded() ){
+
+		return this->error( s,nullptr,_parse_error,tr( "Parse Error." ) ) ;
+	}
+
+	if( !e.is_object() ){
+
+		return this->error( s,nullptr,_invalid_request,tr( "Invalid Request." ) ) ;
+	}
+
+	auto id = e.value( "id",nlohmann::json() ) ;
+
+	auto method = e.find( "method" ) ;
+
+	if( method == e.end() || !method->is_string() ){
+
+		return this->error( s,id,_invalid_request,tr( "Invalid Request." ) ) ;
+	}
+
+	auto params = e.value( "params",nlohmann::json::object() ) ;
+
+	if( !params.is_object() ){
+
+		return this->error( s,id,_invalid_params,tr( "Parameters Must Be An Object." ) ) ;
+	}
+
+	auto m = method->get< std::string >() ;
+
+	if( m == "list" ){
+
+		this->list( s,id ) ;
+
+	}else if( m == "status" ){
+
+		this->status( s,id,params ) ;
+
+	}else if( m == "mount" ){
+
+		this->mount( s,id,params ) ;
+
+	}else if( m == "unmount" ){
+
+		this->unmount( s,id,params ) ;
+
+	}else if( m == "subscribe" ){
+
+		this->subscribe( s,id ) ;
+	}else{
+		this->error( s,id,_method_not_found,tr( "Unknown Method." ) ) ;
+	}
+}
+
+void rpc::reply( const QPointer< QLocalSocket >& s,const nlohmann::json& id,nlohmann::json result )
+{
+	if( s && s->state() == QLocalSocket::ConnectedState ){
+
+		nlohmann::json m ;
+
+		m[ "jsonrpc" ] = "2.0" ;
+		m[ "id" ]      = id ;
+		m[ "result" ]  = std::move( result ) ;
+
+		s->write( rpc::frame( m ) ) ;
+	}
+}
+
+void rpc::error( const QPointer< QLocalSocket >& s,const nlohmann::json& id,int code,const QString& e )
+{
+	if( s && s->state() == QLocalSocket::ConnectedState ){
+
+		nlohmann::json m ;
+
+		m[ "jsonrpc" ] = "2.0" ;
+		m[ "id" ]      = id ;
+		m[ "error" ][ "code" ]    = code ;
+		m[ "error" ][ "message" ] = e.toStdString() ;
+
+		s->write( rpc::frame( m ) ) ;
+	}
+}
+
+void rpc::list( QLocalSocket * s,const nlohmann::json& id )
+{
+	this->reply( s,id,_volumes() ) ;
+}
+
+void rpc::status( QLocalSocket * s,const nlohmann::json& id,const nlohmann::json& params )
+{
+	auto volume = _string( params,"volume" ) ;
+
+	nlohmann::json m ;
+
+	if( volume.isEmpty() ){
+
+		m[ "pid" ]     = QCoreApplication::applicationPid() ;
+		m[ "volumes" ] = mountinfo::unlockedVolumesSnapshot()->size() ;
+	}else{
+		auto e = _find( _path( volume ) ) ;
+
+		m[ "mounted" ] = e.isValid() ;
+
+		if( e.isValid() ){
+
+			m[ "volume" ] = _volume( e ) ;
+		}
+	}
+
+	this->reply( s,id,std::move( m ) ) ;
+}
+
+void rpc::mount( QLocalSocket * s,const nlohmann::json& id,const nlohmann::json& params )
+{
+	auto volume = _string( params,"volumePath" ) ;
+
+	if( volume.isEmpty() ){
+
+		return this->error( s,id,_invalid_params,tr( "Volume Path Not Given." ) ) ;
+	}
+
+	volume = _path( volume ) ;
+
+	if( _find( volume ).isValid() ){
+
+		return this->error( s,id,_failed,tr( "Volume Is Already Unlocked." ) ) ;
+	}
+
+	auto m = utility::readFavorite( volume ) ;
+
+	m.volumePath = volume ;
+
+	auto _set = [ & ]( const char * key,QString& e ){
+
+		auto r = _string( params,key ) ;
+
+		if( !r.isEmpty() ){
+
+			e = r ;
+		}
+	} ;
+
+	_set( "mountPoint",m.mountPointPath ) ;
+	_set( "configFilePath",m.configFilePath ) ;
+	_set( "idleTimeOut",m.idleTimeOut ) ;
+	_set( "mountOptions",m.mountOptions ) ;
+
+	if( m.mountPointPath.isEmpty() ){
+
+		m.mountPointPath = utility::mountPath( utility::mountPathPostFix( volume.split( "/" ).last() ) ) ;
+	}
+
+	auto key = _string( params,"key" ) ;
+
+	if( key.isEmpty() ){
+
+		LXQt::Wallet::BackEnd bk ;
+
+		if( !utility::cliWalletBackEnd( _string( params,"wallet" ),bk ) ){
+
+			return this->error( s,id,_invalid_params,tr( "A Key Or A Wallet Backend Must Be Given." ) ) ;
+		}
+
+		QPointer< QLocalSocket > p( s ) ;
+
+		auto w = m_secrets.walletBk( bk ) ;
+
+		auto e = utility::getKey( volume,w.bk() ) ;
+
+		if( !e.opened ){
+
+			return this->error( p,id,_failed,tr( "Failed To Unlock Requested Backend." ) ) ;
+		}
+
+		if( e.key.isEmpty() ){
+
+			return this->error( p,id,_failed,tr( "Key Not Found In The Backend." ) ) ;
+		}
+
+		key = e.key ;
+	}
+
+	siritask::options opts( m,key ) ;
+
+	auto ro = params.find( "readOnly" ) ;
+
+	opts.ro = ro != params.end() && ro->is_boolean() && ro->get< bool >() ;
+
+	QPointer< QLocalSocket > p( s ) ;
+
+	auto mountPoint = opts.plainFolder ;
+
+	siritask::encryptedFolderMount( opts ).then( [ this,p,id,volume,mountPoint ]( siritask::cmdStatus e ){
+
+		if( e == siritask::status::success ){
+
+			nlohmann::json m ;
+
+			m[ "volumePath" ] = volume.toStdString() ;
+			m[ "mountPoint" ] = mountPoint.toStdString() ;
+
+			this->reply( p,id,std::move( m ) ) ;
+		}else{
+			this->error( p,id,_failed,keyDialog::errorMessage( e ) ) ;
+		}
+	} ) ;
+}
+
+void rpc::unmount( QLocalSocket * s,const nlohmann::json& id,const nlohmann::json& params )
+{
+	auto volume = _string( params,"volume" ) ;
+
+	if( volume.isEmpty() ){
+
+		return this->error( s,id,_invalid_params,tr( "Volume Path Not Given." ) ) ;
+	}
+
+	auto e = _find( _path( volume ) ) ;
+
+	if( e.isNotValid() ){
+
+		return this->error( s,id,_failed,tr( "Volume Is Not Unlocked." ) ) ;
+	}
+
+	QPointer< QLocalSocket > p( s ) ;
+
+	auto a = e.volumePath() ;
+	auto b = e.mountPoint() ;
+	auto c = e.fileSystem() ;
+
+	siritask::encryptedFolderUnMount( a,b,c ).then( [ this,p,id,a,b ]( bool r ){
+
+		if( r ){
+
+			siritask::deleteMountFolder( b ) ;
+
+			nlohmann::json m ;
+
+			m[ "volumePath" ] = a.toStdString() ;
+			m[ "mountPoint" ] = b.toStdString() ;
+
+			return this->reply( p,id,std::move( m ) ) ;
+		}
+
+		Task::run( [ b ](){ return openFiles::holders( b ) ; } ).then( [ this,p,id ]( std::vector< openFiles::process > e ){
+
+			if( e.empty() ){
+
+				this->error( p,id,_failed,tr( "Failed To Unmount Volume." ) ) ;
+			}else{
+				auto m = tr( "ERROR: Below Processes Are Using The Volume:" ) ;
+
+				this->error( p,id,_failed,m + "\n" + openFiles::report( e ).trimmed() ) ;
+			}
+		} ) ;
+	} ) ;
+}
+
+void rpc::subscribe( QLocalSocket * s,const nlohmann::json& id )
+{
+	if( std::find( m_subscribers.begin(),m_subscribers.end(),s ) == m_subscribers.end() ){
+
+		m_subscribers.emplace_back( s ) ;
+	}
+
+	nlohmann::json m ;
+
+	m[ "volumes" ] = _volumes() ;
+
+	this->reply( s,id,std::move( m ) ) ;
+}
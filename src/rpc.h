@@ -0,0 +1,103 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RPC_H
+#define RPC_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QPointer>
+#include <QtNetwork/QLocalSocket>
+
+#include <map>
+#include <vector>
+
+#include "json.h"
+
+class secrets ;
+
+/*
+ * A JSON-RPC 2.0 service on the socket owned by oneinstance.
+ *
+ * Every message is a zero byte followed by the length of the payload as a 32 bit
+ * big endian integer and then the payload.The leading zero byte is how the server
+ * tells these messages apart from a path a second instance forwards to the first.
+ *
+ * Methods are "list","status","mount","unmount" and "subscribe".Subscribed clients
+ * get a "volumesChanged" notification every time a volume is mounted or unmounted.
+ */
+class rpc : public QObject
+{
+	Q_OBJECT
+public:
+	static QString socketPath() ;
+
+	static QByteArray frame( const nlohmann::json& ) ;
+
+	static bool isFrame( const QByteArray& ) ;
+
+	enum class unframed{ message,incomplete,invalid } ;
+
+	/*
+	 * Removes one complete message from the front of the buffer.Returns
+	 * "incomplete" if the buffer does not have a complete message yet and
+	 * "invalid" if what is at the front of the buffer is not a frame or is
+	 * bigger than any message we accept,nothing is removed in both cases.
+	 */
+	static rpc::unframed unframe( QByteArray&,nlohmann::json& ) ;
+
+	/*
+	 * Sends a request to a running instance and waits for its response for up to
+	 * "timeOut" milliseconds,a negative value means wait forever.Returns false if
+	 * no instance is running.It does not need a QCoreApplication.
+	 */
+	static bool call( const QString& method,
+			  const nlohmann::json& params,
+			  nlohmann::json& response,
+			  int timeOut ) ;
+
+	/*
+	 * Handles "-p" and "-u" through a running instance so that they do not
+	 * have to start a QApplication.Returns false if there is no running instance.
+	 */
+	static bool cliCommand( int argc,char * argv[],int& exitCode ) ;
+
+	rpc( QObject * parent,secrets& ) ;
+
+	void addClient( QLocalSocket * ) ;
+
+	void volumesChanged() ;
+private:
+	void request( QLocalSocket *,const nlohmann::json& ) ;
+	void reply( const QPointer< QLocalSocket >&,const nlohmann::json& id,nlohmann::json result ) ;
+	void error( const QPointer< QLocalSocket >&,const nlohmann::json& id,int code,const QString& ) ;
+	void list( QLocalSocket *,const nlohmann::json& ) ;
+	void status( QLocalSocket *,const nlohmann::json&,const nlohmann::json& ) ;
+	void mount( QLocalSocket *,const nlohmann::json&,const nlohmann::json& ) ;
+	void unmount( QLocalSocket *,const nlohmann::json&,const nlohmann::json& ) ;
+	void subscribe( QLocalSocket *,const nlohmann::json& ) ;
+
+	secrets& m_secrets ;
+	std::map< QLocalSocket *,QByteArray > m_buffers ;
+	std::vector< QLocalSocket * > m_subscribers ;
+};
+
+#endif
@@ -39,7 +39,9 @@
 #include <QTranslator>
 #include <QMimeData>
 #include <QFile>
+#include <QMessageBox>
 
+#include <atomic>
 #include <utility>
 #include <initializer_list>
 #include <memory>
@@ -54,6 +56,15 @@
 #include "siritask.h"
 #include "checkforupdates.h"
 #include "favorites.h"
+#include "favoritesstore.h"
+#include "favoritesmenu.h"
+#include "mountorchestrator.h"
+#include "openfiles.h"
+#include "profiler.h"
+#include "rpc.h"
+#include "backendresources.h"
+#include "supervisor.h"
+#include "watchdog.h"
 #include "walletconfig.h"
 #include "plugins.h"
 #include "help.h"
@@ -76,6 +87,10 @@ static utility::volumeList _readFavorites()
 sirikali::sirikali() :
 	m_secrets( this ),
 	m_mountInfo( this,true,[ & ](){ QCoreApplication::exit( m_exitStatus ) ; } ),
+	m_autoMount( [ this ]( std::vector< favorites::entry > e ){
+
+		this->autoMountFavoritesOnAvailable( std::move( e ) ) ;
+	} ),
 	m_checkUpdates( this ),
 	m_configOptions( this,m_secrets,&m_language_menu,this->configOption() )
 {
@@ -264,9 +279,9 @@ void sirikali::setUpApp( const QString& volume )
 
 	this->disableAll() ;
 
-	auto m = mountinfo::unlockedVolumes().await() ;
+	auto m = mountinfo::unlockedVolumesSnapshot() ;
 
-	this->updateVolumeList( m ) ;
+	this->updateVolumeList( *m ) ;
 
 	if( volume.isEmpty() ) {
 
@@ -275,9 +290,15 @@ void sirikali::setUpApp( const QString& volume )
 		this->showMoungDialog( volume ) ;
 	}
 
-	this->startGUI( m ) ;
+	this->startGUI( *m ) ;
 
 	QTimer::singleShot( utility::checkForUpdateInterval(),this,SLOT( autoUpdateCheck() ) ) ;
+
+	auto timer = new QTimer( this ) ;
+
+	connect( timer,SIGNAL( timeout() ),this,SLOT( updateHealth() ) ) ;
+
+	timer->start( 5000 ) ;
 }
 
 void sirikali::showTrayIconWhenReady()
@@ -373,9 +394,16 @@ void sirikali::setUpAppMenu()
 	m->addAction( _addAction( false,false,tr( "Unmount All And Quit" ),
 				  "Unmount All And Quit",SLOT( unMountAllAndQuit() ) ) ) ;
 
-	m_ui->pbFavorites->setMenu( _addMenu( new QMenu( this ),tr( "Favorites" ),"Favorites",
-				    SLOT( favoriteClicked( QAction * ) ),
-				    SLOT( showFavorites() ) ) ) ;
+	auto favoritesMenu1 = _addMenu( new QMenu( this ),tr( "Favorites" ),"Favorites",
+					SLOT( favoriteClicked( QAction * ) ),nullptr ) ;
+
+	auto favoritesMenu2 = _addMenu( m,tr( "Favorites" ),"Favorites",
+					SLOT( favoriteClicked( QAction * ) ),nullptr ) ;
+
+	m_favoritesMenus.emplace_back( new favoritesMenu( favoritesMenu1,this ) ) ;
+	m_favoritesMenus.emplace_back( new favoritesMenu( favoritesMenu2,this ) ) ;
+
+	m_ui->pbFavorites->setMenu( favoritesMenu1 ) ;
 
 	m->addAction( _addAction( false,false,tr( "Settings" ),"Settings",
 				  SLOT( configurationOptions() ) ) ) ;
@@ -389,8 +417,6 @@ void sirikali::setUpAppMenu()
 
 	m->addAction( _addAction( false,false,tr( "Quit" ),"Quit",SLOT( closeApplication() ) ) ) ;
 
-	this->showFavorites() ;
-
 	m_ui->pbmenu->setMenu( m ) ;
 
 	m_trayIcon.setContextMenu( m ) ;
@@ -436,26 +462,22 @@ void sirikali::favoriteClicked( QAction * ac )
 	}else{
 		if( e == "Mount All" ){
 
-			this->mountMultipleVolumes( _readFavorites() ) ;
+			this->mountMultipleVolumes( this->readKeysFromWallet( _readFavorites() ),m_autoOpenFolderOnMount ) ;
 		}else{
-			for( auto&& it : _readFavorites() ){
+			auto f = utility::readFavorite( e ) ;
 
-				if( it.first.volumePath == e ){
+			if( !f.volumePath.isEmpty() ){
 
-					this->mountMultipleVolumes( this->autoUnlockVolumes( { std::move( it ) },true ) ) ;
+				utility::volumeList m ;
 
-					break ;
-				}
+				m.emplace_back( std::move( f ),QByteArray() ) ;
+
+				this->mountMultipleVolumes( this->readKeysFromWallet( std::move( m ) ),m_autoOpenFolderOnMount ) ;
 			}
 		}
 	}
 }
 
-void sirikali::showFavorites()
-{
-	utility::readFavorites( m_ui->pbFavorites->menu() ) ;
-}
-
 void sirikali::setLocalizationLanguage( bool translate )
 {
 	utility::setLocalizationLanguage( translate,&m_language_menu,m_translator ) ;
@@ -479,6 +501,13 @@ void sirikali::startGUI( const std::vector< volumeInfo >& m )
 
 		this->autoUnlockVolumes( m ) ;
 	}
+
+	connect( &favoritesStore::instance(),&favoritesStore::changed,this,[ this ](){
+
+		m_autoMount.favoritesChanged() ;
+	} ) ;
+
+	m_autoMount.favoritesChanged() ;
 }
 
 void sirikali::raiseWindow( const QString& volume )
@@ -508,6 +537,22 @@ int sirikali::start( QApplication& e )
 		}
 	}
 
+	if( l.contains( "--wallet-kdf-benchmark" ) ){
+
+		auto m = utility::cmdArgumentValue( l,"--wallet-kdf-benchmark","250" ).toInt() ;
+
+		utility::debug() << LXQt::Wallet::internalWalletKdfBenchmark( m > 0 ? m : 250 ) ;
+
+		return 0 ;
+	}
+
+	if( l.contains( "--clear-wallet-key-cache" ) ){
+
+		LXQt::Wallet::clearInternalWalletKeyCache( utility::applicationName() ) ;
+
+		return 0 ;
+	}
+
 	if( utility::printVersionOrHelpInfo( l ) ){
 
 		return 0 ;
@@ -530,8 +575,16 @@ void sirikali::start( const QStringList& l )
 	utility::enableDebug( l.contains( "--debug" ) ) ;
 	utility::enableFullDebug( l.contains( "--debug-full" ) ) ;
 
+	profiler::setJsonFile( utility::cmdArgumentValue( l,"--profile-json" ) ) ;
+
+	LXQt::Wallet::setInternalWalletKeyCache( utility::internalWalletKeyCacheTimeOut() ) ;
+
+	LXQt::Wallet::setInternalWalletCalibratedKdf( utility::internalWalletCalibratedKdf() ) ;
+
 	m_startHidden  = l.contains( "-e" ) ;
 
+	m_daemon = l.contains( "--daemon" ) ;
+
 	if( !m_startHidden ){
 
 		m_startHidden = utility::startMinimized() ;
@@ -564,14 +617,39 @@ void sirikali::start( const QStringList& l )
 
 			oneinstance::callbacks cb = {
 
-				[ this ]( const QString& e ){ this->setUpApp( e ) ; },
+				[ this ]( const QString& e ){
+
+					m_rpc = new rpc( this,m_secrets ) ;
+
+					watchdog::start() ;
+
+					if( !m_daemon ){
+
+						this->setUpApp( e ) ;
+					}
+				},
 				[ this ](){ this->closeApplication( 1 ) ; },
-				[ this ]( const QString& e ){ this->raiseWindow( e ) ; },
+				[ this ]( const QString& e ){
+
+					if( m_ui ){
+
+						this->raiseWindow( e ) ;
+					}else{
+						/*
+						 * Running as a daemon,the GUI lives in the daemon process
+						 * and is only created when it is asked for.
+						 */
+						m_startHidden = false ;
+
+						this->setUpApp( e ) ;
+					}
+				},
+				[ this ]( QLocalSocket * s ){ m_rpc->addClient( s ) ; }
 			} ;
 
 			auto x = utility::cmdArgumentValue( l,"-d" ) ;
 
-			oneinstance::instance( this,s + "/SiriKali.socket",x,std::move( cb ) ) ;
+			oneinstance::instance( this,rpc::socketPath(),x,std::move( cb ) ) ;
 		}else{
 			DialogMsg( this ).ShowUIOK( tr( "ERROR" ),tr( "\"%1\" Folder Must Be Writable" ).arg( s ) ) ;
 
@@ -602,22 +680,28 @@ void sirikali::cliCommand( const QStringList& l )
 
 		auto volume = utility::cmdArgumentValue( l,"-d" ) ;
 
-		for( const auto& it : mountinfo::unlockedVolumes().await() ){
+		auto it = mountinfo::unlockedVolume( volume ).await() ;
+
+		if( it.isValid() ){
 
 			const auto& a = it.volumePath() ;
 			const auto& b = it.mountPoint() ;
 			const auto& c = it.fileSystem() ;
 
-			if( a == volume || b == volume ){
+			if( siritask::encryptedFolderUnMount( a,b,c ).await() ){
 
-				if( siritask::encryptedFolderUnMount( a,b,c ).await() ){
+				siritask::deleteMountFolder( b ) ;
 
-					siritask::deleteMountFolder( b ) ;
+				return this->closeApplication( 0 ) ;
+			}
 
-					return this->closeApplication( 0 ) ;
-				}else{
-					break ;
-				}
+			auto e = Task::await( [ & ](){ return openFiles::holders( b ) ; } ) ;
+
+			if( !e.empty() ){
+
+				auto m = tr( "ERROR: Below Processes Are Using The Volume:" ) ;
+
+				return this->closeApplication( 1,m + "\n" + openFiles::report( e ).trimmed() ) ;
 			}
 		}
 
@@ -626,7 +710,7 @@ void sirikali::cliCommand( const QStringList& l )
 
 	if( l.contains( "-p" ) ){
 
-		for( const auto& it : mountinfo::unlockedVolumes().await() ){
+		for( const auto& it : *mountinfo::unlockedVolumesSnapshot() ){
 
 			it.printVolumeInfo() ;
 		}
@@ -636,8 +720,221 @@ void sirikali::cliCommand( const QStringList& l )
 
 	if( !utility::cmdArgumentValue( l,"-b" ).isEmpty() ){
 
-		this->unlockVolume( l ) ;
+		if( l.contains( "--batch" ) || l.contains( "--batch-tag" ) ){
+
+			this->unlockVolumes( l ) ;
+		}else{
+			this->unlockVolume( l ) ;
+		}
+	}
+}
+
+/*
+ * A manifest is a JSON array of objects using the same keys as records in the
+ * favorites file plus an optional "readOnly" boolean.
+ */
+static bool _batch_manifest( const QString& path,std::vector< siritask::options >& e )
+{
+	QFile f( path ) ;
+
+	if( !f.open( QIODevice::ReadOnly ) ){
+
+		return false ;
+	}
+
+	try{
+		auto json = nlohmann::json::parse( f.readAll().constData() ) ;
+
+		if( !json.is_array() ){
+
+			return false ;
+		}
+
+		for( const auto& it : json ){
+
+			auto _get = [ & ]( const char * key ){
+
+				auto s = it.find( key ) ;
+
+				if( s != it.end() && s->is_string() ){
+
+					return QString::fromStdString( s->get< std::string >() ) ;
+				}else{
+					return QString() ;
+				}
+			} ;
+
+			favorites::entry m ;
+
+			m.volumePath     = _get( "volumePath" ) ;
+			m.mountPointPath = _get( "mountPointPath" ) ;
+			m.configFilePath = _get( "configFilePath" ) ;
+			m.idleTimeOut    = _get( "idleTimeOut" ) ;
+			m.mountOptions   = _get( "mountOptions" ) ;
+
+			if( m.volumePath.isEmpty() ){
+
+				return false ;
+			}
+
+			e.emplace_back( m ) ;
+
+			e.back().ro = it.value( "readOnly",false ) ;
+
+			e.back().setFavoriteOptions( utility::readFavorite( m.volumePath ) ) ;
+		}
+
+		return true ;
+
+	}catch( ... ){
+
+		return false ;
+	}
+}
+
+void sirikali::unlockVolumes( const QStringList& l )
+{
+	auto backEnd  = utility::cmdArgumentValue( l,"-b" ) ;
+	auto manifest = utility::cmdArgumentValue( l,"--batch" ) ;
+	auto tag      = utility::cmdArgumentValue( l,"--batch-tag" ) ;
+
+	std::vector< siritask::options > volumes ;
+
+	if( l.contains( "--batch" ) ){
+
+		if( !_batch_manifest( manifest,volumes ) ){
+
+			return this->closeApplication( 1,tr( "ERROR: Failed To Read Manifest File." ) ) ;
+		}
+	}else{
+		for( const auto& it : utility::readFavorites() ){
+
+			if( it.tags.contains( tag ) ){
+
+				volumes.emplace_back( it ) ;
+			}
+		}
+	}
+
+	if( volumes.empty() ){
+
+		return this->closeApplication( 1,tr( "ERROR: No Volume To Unlock." ) ) ;
+	}
+
+	LXQt::Wallet::BackEnd bk ;
+
+	if( !utility::cliWalletBackEnd( backEnd,bk ) ){
+
+		return this->closeApplication( 1,tr( "ERROR: Batch Unlocking Requires A Wallet Backend." ) ) ;
+	}
+
+	auto s = m_secrets.walletBk( bk ) ;
+
+	auto& wallet = s.bk() ;
+
+	if( !wallet.opened() ){
+
+		wallet.setImage( QIcon( ":/sirikali" ) ) ;
+
+		auto walletName = [ & ](){
+
+			if( bk == LXQt::Wallet::BackEnd::internal ){
+
+				return utility::walletName() ;
+			}else{
+				return utility::walletName( bk ) ;
+			}
+		}() ;
+
+		if( !wallet.open( walletName,utility::applicationName() ) ){
+
+			return this->closeApplication( 1,tr( "ERROR: Failed To Unlock Requested Backend." ) ) ;
+		}
+	}
+
+	::Task::await( [ & ](){
+
+		QStringList keys ;
+
+		for( const auto& it : volumes ){
+
+			keys.append( it.cipherFolder ) ;
+		}
+
+		auto values = wallet.readValues( keys ) ;
+
+		for( decltype( volumes.size() ) i = 0 ; i < volumes.size() ; i++ ){
+
+			volumes[ i ].key = values.at( static_cast< int >( i ) ) ;
+		}
+	} ) ;
+
+	using result = mountOrchestrator::result ;
+
+	std::vector< result > failed ;
+
+	std::vector< siritask::options > ready ;
+
+	for( auto& it : volumes ){
+
+		if( it.plainFolder.isEmpty() ){
+
+			it.plainFolder = utility::mountPath( utility::mountPathPostFix( it.cipherFolder.split( "/" ).last() ) ) ;
+		}
+
+		if( it.key.isEmpty() ){
+
+			auto e = tr( "Key Not Found In The Backend." ) ;
+
+			failed.emplace_back( result{ it,siritask::cmdStatus( siritask::status::backendFail,e ) } ) ;
+		}else{
+			ready.emplace_back( std::move( it ) ) ;
+		}
 	}
+
+	m_mountInfo.announceEvents( false ) ;
+
+	mountOrchestrator::run( std::move( ready ),[ this,failed ]( const std::vector< result >& e ){
+
+		auto _print = []( const result& it ){
+
+			nlohmann::json json ;
+
+			auto success = it.status == siritask::status::success ;
+
+			json[ "volumePath" ] = it.options.cipherFolder.toStdString() ;
+			json[ "mountPoint" ] = it.options.plainFolder.toStdString() ;
+			json[ "success" ]    = success ;
+
+			if( !success ){
+
+				if( it.status == siritask::status::backendFail && !it.status.msg().isEmpty() ){
+
+					json[ "error" ] = it.status.msg().toStdString() ;
+				}else{
+					json[ "error" ] = keyDialog::errorMessage( it.status ).toStdString() ;
+				}
+			}
+
+			utility::debug() << json.dump() ;
+
+			return success ;
+		} ;
+
+		bool ok = failed.empty() ;
+
+		for( const auto& it : failed ){
+
+			_print( it ) ;
+		}
+
+		for( const auto& it : e ){
+
+			ok = _print( it ) && ok ;
+		}
+
+		this->closeApplication( ok ? 0 : 1 ) ;
+	} ) ;
 }
 
 void sirikali::unlockVolume( const QStringList& l )
@@ -656,8 +953,64 @@ void sirikali::unlockVolume( const QStringList& l )
 
 		this->closeApplication( 1,tr( "ERROR: Volume Path Not Given." ) ) ;
 	}else{
+		/*
+		 * A running instance does the unlocking when there is one,a wallet it opens
+		 * stays open between invocations.
+		 */
+		auto _rpc = [ & ]( const char * name,const QString& value ){
+
+			nlohmann::json params ;
+
+			auto _add = [ & ]( const char * key,const QString& e ){
+
+				if( !e.isEmpty() ){
+
+					params[ key ] = e.toStdString() ;
+				}
+			} ;
+
+			auto _absolute = []( const QString& e ){
+
+				return e.isEmpty() ? e : QDir( e ).absolutePath() ;
+			} ;
+
+			_add( "volumePath",volume ) ;
+			_add( "mountPoint",_absolute( mountPath ) ) ;
+			_add( "idleTimeOut",idleTime ) ;
+			_add( "configFilePath",_absolute( cPath ) ) ;
+			_add( "mountOptions",mOpt ) ;
+			_add( name,value ) ;
+
+			params[ "readOnly" ] = mode ;
+
+			nlohmann::json r ;
+
+			if( !rpc::call( "mount",params,r,-1 ) ){
+
+				return false ;
+			}
+
+			auto e = r.find( "error" ) ;
+
+			if( e != r.end() && e->is_object() ){
+
+				auto m = e->value( "message",std::string() ) ;
+
+				this->closeApplication( 1,"ERROR: " + QString::fromStdString( m ) ) ;
+			}else{
+				this->closeApplication( 0 ) ;
+			}
+
+			return true ;
+		} ;
+
 		auto _unlockVolume = [ & ]( const QString& key ){
 
+			if( _rpc( "key",key ) ){
+
+				return ;
+			}
+
 			auto m = [ & ]()->QString{
 
 				if( mountPath.isEmpty() ){
@@ -674,6 +1027,8 @@ void sirikali::unlockVolume( const QStringList& l )
 
 			siritask::options s = { volume,m,key,idleTime,cPath,QString(),mode,mOpt,QString() } ;
 
+			s.setFavoriteOptions( utility::readFavorite( volume ) ) ;
+
 			auto& e = siritask::encryptedFolderMount( s ) ;
 
 			if( e.await() == siritask::status::success ){
@@ -713,91 +1068,170 @@ void sirikali::unlockVolume( const QStringList& l )
 			return _unlockVolume( key ) ;
 		}
 
-		auto w = [ & ](){
+		LXQt::Wallet::BackEnd bk ;
 
-			namespace wxt = LXQt::Wallet ;
+		if( !utility::cliWalletBackEnd( backEnd,bk ) ){
 
-			auto _supported = [ & ]( wxt::BackEnd e,const char * s ){
+			return this->closeApplication( 1,tr( "ERROR: Failed To Unlock Requested Backend." ) ) ;
+		}
 
-				return backEnd == s && wxt::backEndIsSupported( e ) ;
-			} ;
+		if( _rpc( "wallet",backEnd ) ){
 
-			if( _supported( wxt::BackEnd::internal,"internal" ) ){
+			return ;
+		}
 
-				auto s = m_secrets.walletBk( wxt::BackEnd::internal ) ;
+		auto s = m_secrets.walletBk( bk ) ;
 
-				return utility::getKey( volume,s.bk() ) ;
+		auto w = utility::getKey( volume,s.bk() ) ;
 
-			}else if( _supported( wxt::BackEnd::libsecret,"gnomewallet" ) ||
-				  _supported( wxt::BackEnd::libsecret,"libsecret" ) ){
+		if( w.opened ){
 
-				auto s = m_secrets.walletBk( wxt::BackEnd::libsecret ) ;
+			if( w.key.isEmpty() ){
 
-				return utility::getKey( volume,s.bk() ) ;
+				this->closeApplication( 1,tr( "ERROR: Key Not Found In The Backend." ) ) ;
+			}else{
+				_unlockVolume( w.key ) ;
+			}
+		}else{
+			this->closeApplication( 1,tr( "ERROR: Failed To Unlock Requested Backend." ) ) ;
+		}
+	}
+}
 
-			}else if( _supported( wxt::BackEnd::kwallet,"kwallet" ) ){
+void sirikali::mountMultipleVolumes( utility::volumeList e,bool autoOpenFolderOnMount )
+{
+	if( e.empty() ){
 
-				auto s = m_secrets.walletBk( wxt::BackEnd::kwallet ) ;
+		return ;
+	}
 
-				return utility::getKey( volume,s.bk() ) ;
+	/*
+	 * Keys for volumes whose keys are not in the wallet are asked for up front and
+	 * then all volumes are unlocked together.
+	 */
 
-			}else if( _supported( wxt::BackEnd::osxkeychain,"osxkeychain" ) ){
+	auto showDialog = utility::showMountDialogWhenAutoMounting() ;
 
-				auto s = m_secrets.walletBk( wxt::BackEnd::osxkeychain ) ;
+	std::vector< siritask::options > s ;
 
-				return utility::getKey( volume,s.bk() ) ;
-			}else{
-				return utility::wallet{ false,true,"" } ;
-			}
-		}() ;
+	utility::volumeList m ;
 
-		if( w.opened ){
+	for( auto&& it : e ){
 
-			if( w.key.isEmpty() ){
+		if( it.second.isEmpty() || showDialog ){
 
-				this->closeApplication( 1,tr( "ERROR: Key Not Found In The Backend." ) ) ;
-			}else{
-				_unlockVolume( w.key ) ;
-			}
+			m.emplace_back( std::move( it ) ) ;
 		}else{
-			this->closeApplication( 1,tr( "ERROR: Failed To Unlock Requested Backend." ) ) ;
+			s.emplace_back( it.first,it.second ) ;
 		}
 	}
+
+	if( m.empty() ){
+
+		return this->mountVolumes( std::move( s ),autoOpenFolderOnMount ) ;
+	}
+
+	m_disableEnableAll = true ;
+
+	this->disableAll() ;
+
+	using list = std::vector< siritask::options > ;
+
+	keyDialog::instance( this,m_secrets,m_folderOpener,std::move( m ),[ this,s,autoOpenFolderOnMount ]( list e ){
+
+		m_disableEnableAll = false ;
+
+		this->enableAll() ;
+
+		auto m = s ;
+
+		for( auto&& it : e ){
+
+			m.emplace_back( std::move( it ) ) ;
+		}
+
+		this->mountVolumes( std::move( m ),autoOpenFolderOnMount ) ;
+	} ) ;
 }
 
-void sirikali::mountMultipleVolumes( utility::volumeList e )
+void sirikali::mountVolumes( std::vector< siritask::options > e,bool autoOpenFolderOnMount )
 {
-	if( !e.empty() ){
+	using list = std::vector< mountOrchestrator::result > ;
 
-		m_disableEnableAll = true ;
+	mountOrchestrator::run( std::move( e ),[ this,autoOpenFolderOnMount ]( const list& e ){
 
-		this->disableAll() ;
+		QString msg ;
 
-		keyDialog::instance( this,
-				     m_secrets,
-				     m_autoOpenFolderOnMount,
-				     m_folderOpener,
-				     std::move( e ),
-				     [ this ](){ m_disableEnableAll = false ; this->enableAll() ; } ) ;
-	}
+		bool failed = false ;
+
+		for( const auto& it : e ){
+
+			if( it.status == siritask::status::success ){
+
+				if( autoOpenFolderOnMount ){
+
+					this->openMountPointPath( it.options.plainFolder ) ;
+				}
+
+				msg += tr( "Unlocked: \"%1\"" ).arg( it.options.cipherFolder ) ;
+			}else{
+				failed = true ;
+
+				auto s = keyDialog::errorMessage( it.status ) ;
+
+				msg += tr( "Failed: \"%1\"\n%2" ).arg( it.options.cipherFolder,s ) ;
+			}
+
+			msg += "\n\n" ;
+		}
+
+		/*
+		 * Unlocked volumes show up in the table and hence the summary is only
+		 * shown when at least one volume failed to unlock.
+		 */
+		if( failed ){
+
+			DialogMsg( this ).ShowUIOK( tr( "ERROR" ),msg.trimmed() ) ;
+		}
+	} ) ;
 }
 
 void sirikali::autoMountFavoritesOnAvailable( QString m )
 {
 	if( utility::autoMountFavoritesOnAvailable() ){
 
-		utility::volumeList e ;
+		m_autoMount.mounted( m ) ;
+	}
+}
+
+void sirikali::autoMountFavoritesOnAvailable( std::vector< favorites::entry > m )
+{
+	auto s = mountinfo::unlockedVolumesSnapshot() ;
 
-		for( auto&& it : _readFavorites() ){
+	auto _mounted = [ & ]( const QString& e ){
 
-			if( it.first.volumePath.startsWith( m ) && it.first.autoMount() ){
+		for( const auto& it : *s ){
 
-				e.emplace_back( std::move( it ) ) ;
+			if( it.volumePath() == e ){
+
+				return true ;
 			}
 		}
 
-		this->mountMultipleVolumes( this->autoUnlockVolumes( std::move( e ) ) ) ;
+		return false ;
+	} ;
+
+	utility::volumeList e ;
+
+	for( auto&& it : m ){
+
+		if( !_mounted( it.volumePath ) ){
+
+			e.emplace_back( std::move( it ),QByteArray() ) ;
+		}
 	}
+
+	this->mountMultipleVolumes( this->readKeysFromWallet( std::move( e ) ),false ) ;
 }
 
 void sirikali::autoUnlockVolumes( const std::vector< volumeInfo >& s )
@@ -817,20 +1251,18 @@ void sirikali::autoUnlockVolumes( const std::vector< volumeInfo >& s )
 		return false ;
 	} ;
 
-	for( auto&& it : _readFavorites() ){
-
-		const auto& m = it.first ;
+	for( auto&& it : utility::readAutoMountFavorites() ){
 
-		if( m.autoMount() && !_mounted( m.volumePath )){
+		if( !_mounted( it.volumePath ) ){
 
-			e.emplace_back( std::move( it ) ) ;
+			e.emplace_back( std::move( it ),QByteArray() ) ;
 		}
 	}
 
-	this->mountMultipleVolumes( this->autoUnlockVolumes( std::move( e ) ) ) ;
+	this->mountMultipleVolumes( this->readKeysFromWallet( std::move( e ) ),false ) ;
 }
 
-utility::volumeList sirikali::autoUnlockVolumes( utility::volumeList l,bool autoOpenFolderOnMount )
+utility::volumeList sirikali::readKeysFromWallet( utility::volumeList l )
 {
 	if( l.empty() ){
 
@@ -851,57 +1283,42 @@ utility::volumeList sirikali::autoUnlockVolumes( utility::volumeList l,bool auto
 		return l ;
 	}
 
-	auto _mountVolumes = [ & ](){
+	auto _readKeys = [ & ](){
 
-		utility::volumeList e ;
-
-		auto _mount = [ & ]( utility::volumeList& q,
-				     const std::pair< favorites::entry,QByteArray >& e,
-				     const QByteArray& key,
-				     bool s ){
-			if( s ){
+		QStringList keys ;
 
-				q.emplace_back( e.first,key ) ;
-			}else{
-				auto& s = siritask::encryptedFolderMount( { e.first,key } ) ;
-
-				s.then( [ this,autoOpenFolderOnMount,e = e.first.mountPointPath ]( siritask::cmdStatus s ){
+		for( const auto& it : l ){
 
-					if( s == siritask::status::success && autoOpenFolderOnMount ){
+			if( it.second.isEmpty() ){
 
-						this->openMountPointPath( e ) ;
-					}
-				} ) ;
+				keys.append( it.first.volumePath ) ;
 			}
-		} ;
+		}
 
-		auto s = utility::showMountDialogWhenAutoMounting() ;
+		auto values = m->readValues( keys ) ;
 
-		for( const auto& it : l ){
+		int i = 0 ;
 
-			const auto key = m->readValue( it.first.volumePath ) ;
+		for( auto& it : l ){
 
-			if( key.isEmpty() ){
+			if( it.second.isEmpty() ){
 
-				e.emplace_back( it ) ;
-			}else{
-				_mount( e,it,key,s ) ;
+				it.second = values.at( i++ ) ;
 			}
 		}
 
-		return e ;
+		return l ;
 	} ;
 
-
 	if( m->opened() ){
 
-		return _mountVolumes() ;
+		return _readKeys() ;
 	}else{
 		m->setImage( QIcon( ":/sirikali" ) ) ;
 
 		if( m->open( utility::walletName( m->backEnd() ),utility::applicationName() ) ){
 
-			return _mountVolumes() ;
+			return _readKeys() ;
 		}else{
 			return l ;
 		}
@@ -926,7 +1343,7 @@ void sirikali::ecryptfsProperties()
 		}
 	}() ;
 
-	for( const auto& it : mountinfo::unlockedVolumes().await() ){
+	for( const auto& it : *mountinfo::unlockedVolumesSnapshot() ){
 
 		if( it.mountPoint() == s ){
 
@@ -1083,31 +1500,32 @@ void sirikali::cryfsProperties()
 
 static utility::result< QByteArray > _volume_properties( const QString& cmd,
 							 const std::pair< QString,QString >& args,
-							 const QString& path )
+							 const QString& volumePath )
 {
+	auto path = utility::Task::makePath( volumePath ) ;
+
 	auto e = utility::Task::run( cmd + args.first + path ).await() ;
 
 	if( e.success() ){
 
 		return e.stdOut() ;
 	}else{
-		for( auto& it : utility::readFavorites() ){
+		auto it = utility::readFavorite( volumePath ) ;
 
-			if( utility::Task::makePath( it.volumePath ) == path ){
+		if( !it.volumePath.isEmpty() ){
 
-				auto s = utility::Task::makePath( it.configFilePath ) ;
+			auto s = utility::Task::makePath( it.configFilePath ) ;
 
-				if( cmd.endsWith( "gocryptfs" ) ){
+			if( cmd.endsWith( "gocryptfs" ) ){
 
-					s += " " + it.volumePath ;
-				}
+				s += " " + it.volumePath ;
+			}
 
-				e = utility::Task::run( cmd + args.first + args.second + s ).await() ;
+			e = utility::Task::run( cmd + args.first + args.second + s ).await() ;
 
-				if( e.success() ){
+			if( e.success() ){
 
-					return e.stdOut() ;
-				}
+				return e.stdOut() ;
 			}
 		}
 
@@ -1128,7 +1546,7 @@ static void _volume_properties( const QString& cmd,const std::pair<QString,QStri
 
 			return QString() ;
 		}else{
-			return utility::Task::makePath( table->item( row,0 )->text() ) ;
+			return table->item( row,0 )->text() ;
 		}
 	}() ;
 
@@ -1199,6 +1617,24 @@ void sirikali::sshfsProperties()
 	}
 }
 
+void sirikali::resourceUsage()
+{
+	auto table = m_ui->tableWidget ;
+
+	auto row = table->currentRow() ;
+
+	if( row < 0 ){
+
+		return ;
+	}
+
+	auto m = table->item( row,1 )->text() ;
+
+	auto e = Task::await( [ & ](){ return backendResources::usage( m ) ; } ) ;
+
+	DialogMsg( this ).ShowUIInfo( tr( "INFORMATION" ),true,e ) ;
+}
+
 void sirikali::showContextMenu( QTableWidgetItem * item,bool itemClicked )
 {
 	struct volumeType{ const char * slot ; bool enabled ; } ;
@@ -1267,6 +1703,24 @@ void sirikali::showContextMenu( QTableWidgetItem * item,bool itemClicked )
 		return { nullptr,false } ;
 	}() ) ;
 
+	_addAction( tr( "Resource Usage" ),{ SLOT( resourceUsage() ),utility::platformIsLinux() } ) ;
+
+	_addAction( tr( "Abort Hung Volume" ),[ this ]()->volumeType{
+
+		auto table = m_ui->tableWidget ;
+
+		auto row = table->currentRow() ;
+
+		if( row >= 0 ){
+
+			auto hung = watchdog::health( table->item( row,1 )->text() ).hung ;
+
+			return { SLOT( abortHungVolume() ),hung } ;
+		}else{
+			return { nullptr,false } ;
+		}
+	}() ) ;
+
 	m.addSeparator() ;
 
 	m.addAction( tr( "Close Menu" ) ) ;
@@ -1429,7 +1883,7 @@ void sirikali::dropEvent( QDropEvent * e )
 		s.emplace_back( std::move( m ),QByteArray() ) ;
 	}
 
-	this->mountMultipleVolumes( std::move( s ) ) ;
+	this->mountMultipleVolumes( std::move( s ),m_autoOpenFolderOnMount ) ;
 }
 
 void sirikali::mount( const volumeInfo& entry,const QString& exe,const QByteArray& key )
@@ -1557,35 +2011,204 @@ void sirikali::updateList( const volumeInfo& entry )
 
 		tablewidget::updateRow( table,entry.mountInfo().minimalList(),row,this->font() ) ;
 
+		this->updateRowHealth( row ) ;
+
 		tablewidget::selectRow( table,row ) ;
 	}
 }
 
+void sirikali::updateHealth()
+{
+	if( m_ui ){
+
+		for( int row = 0 ; row < m_ui->tableWidget->rowCount() ; row++ ){
+
+			this->updateRowHealth( row ) ;
+		}
+	}
+}
+
+void sirikali::updateRowHealth( int row )
+{
+	auto table = m_ui->tableWidget ;
+
+	auto m = table->item( row,1 ) ;
+
+	if( !m ){
+
+		return ;
+	}
+
+	auto mountPoint = m->text() ;
+
+	auto restarts = supervisor::restarts( mountPoint ) ;
+
+	auto health = watchdog::health( mountPoint ) ;
+
+	QStringList tip ;
+
+	if( health.hung ){
+
+		tip.append( tr( "Not Responding For %1 Seconds." ).arg( health.latency / 1000 ) ) ;
+
+	}else if( health.latency >= 0 ){
+
+		tip.append( tr( "Response Time: %1 ms" ).arg( health.latency ) ) ;
+	}
+
+	if( restarts > 0 ){
+
+		tip.append( tr( "The Backend Of This Volume Died And Was Restarted %1 Times." ).arg( restarts ) ) ;
+	}
+
+	for( int i = 0 ; i < table->columnCount() ; i++ ){
+
+		auto item = table->item( row,i ) ;
+
+		if( item ){
+
+			item->setToolTip( tip.join( "\n" ) ) ;
+
+			if( health.hung ){
+
+				item->setForeground( Qt::red ) ;
+			}else{
+				item->setForeground( table->palette().text() ) ;
+			}
+		}
+	}
+}
+
+void sirikali::abortHungVolume()
+{
+	auto table = m_ui->tableWidget ;
+
+	auto row = table->currentRow() ;
+
+	if( row < 0 ){
+
+		return ;
+	}
+
+	auto m = table->item( row,1 )->text() ;
+
+	auto msg = tr( "\"%1\" Is Not Responding.\n\nAbort Its Connection To The Backend And Detach It?\nData Not Yet Written To The Volume Will Be Lost." ).arg( m ) ;
+
+	if( DialogMsg( this ).ShowUIYesNo( tr( "WARNING" ),msg ) != QMessageBox::Yes ){
+
+		return ;
+	}
+
+	this->disableAll() ;
+
+	Task::run( [ = ](){ return watchdog::abort( m ) ; } ).then( [ this,m ]( bool e ){
+
+		if( e ){
+
+			siritask::deleteMountFolder( m ) ;
+		}else{
+			auto s = tr( "Failed To Abort \"%1\"" ).arg( m ) ;
+
+			DialogMsg( this ).ShowUIOK( tr( "ERROR" ),s ) ;
+		}
+
+		this->enableAll() ;
+	} ) ;
+}
+
 void sirikali::pbUmount()
 {
 	auto table = m_ui->tableWidget ;
 
 	if( table->rowCount() > 0 ){
 
-		this->disableAll() ;
-
 		auto row = table->currentRow() ;
 
+		if( watchdog::health( table->item( row,1 )->text() ).hung ){
+
+			return this->abortHungVolume() ;
+		}
+
+		this->disableAll() ;
+
 		auto type = table->item( row,2 )->text() ;
 
 		auto a = table->item( row,0 )->text() ;
 		auto b = table->item( row,1 )->text() ;
 		auto c = table->item( row,2 )->text() ;
 
-		utility::Task::suspendForOneSecond() ;
+		while( true ){
 
-		if( siritask::encryptedFolderUnMount( a,b,c ).await() ){
+			if( siritask::encryptedFolderUnMount( a,b,c ).await() ){
 
-			siritask::deleteMountFolder( b ) ;
-		}else{
-			DialogMsg( this ).ShowUIOK( tr( "ERROR" ),tr( "Failed To Unmount %1 Volume" ).arg( type ) ) ;
+				siritask::deleteMountFolder( b ) ;
+
+				break ;
+			}
+
+			auto e = Task::await( [ & ](){ return openFiles::holders( b ) ; } ) ;
+
+			auto msg = tr( "Failed To Unmount %1 Volume" ).arg( type ) ;
+
+			if( e.empty() ){
+
+				DialogMsg( this ).ShowUIOK( tr( "ERROR" ),msg ) ;
+
+				this->enableAll() ;
+
+				break ;
+			}
+
+			msg += "\n\n" + tr( "Below Processes Are Using The Volume:" ) ;
+			msg += "\n\n" + openFiles::report( e ) + "\n" ;
+			msg += tr( "Retry Unmounting After They Exit?" ) ;
+
+			if( DialogMsg( this ).ShowUIYesNo( tr( "ERROR" ),msg ) != QMessageBox::Yes ){
+
+				this->enableAll() ;
+
+				break ;
+			}
+
+			/*
+			 * The wait runs in slices of 250ms so that it can be cancelled from
+			 * the dialog while the event loop keeps the GUI responsive.
+			 */
+			std::atomic_bool cancelled( false ) ;
+
+			QMessageBox box( QMessageBox::Information,
+					 tr( "INFORMATION" ),
+					 tr( "Waiting For The Processes To Exit Before Unmounting Again." ),
+					 QMessageBox::Cancel,
+					 this ) ;
+
+			auto c = connect( &box,&QMessageBox::finished,[ & ]( int ){ cancelled = true ; } ) ;
+
+			box.setWindowModality( Qt::WindowModal ) ;
+
+			box.show() ;
+
+			Task::await( [ & ](){
+
+				for( int i = 0 ; i < 240 && !cancelled ; i++ ){
+
+					if( openFiles::waitForExit( e,250 ) ){
 
-			this->enableAll() ;
+						break ;
+					}
+				}
+			} ) ;
+
+			disconnect( c ) ;
+
+			box.hide() ;
+
+			if( cancelled ){
+
+				this->enableAll() ;
+
+				break ;
+			}
 		}
 	}
 }
@@ -1602,22 +2225,103 @@ void sirikali::unMountAll()
 	const auto mountPoints   = tablewidget::columnEntries( table,1 ) ;
 	const auto fileSystems   = tablewidget::columnEntries( table,2 ) ;
 
-	utility::Task::suspendForOneSecond() ;
+	enum class state{ waiting,running,unmounted,failed } ;
 
-	for( auto r = cipherFolders.size() - 1 ; r >= 0 ; r-- ){
+	struct volume
+	{
+		QString cipherFolder ;
+		QString mountPoint ;
+		QString fileSystem ;
+		state status ;
+	} ;
 
-		const auto& a = cipherFolders.at( r ) ;
-		const auto& b = mountPoints.at( r ) ;
-		const auto& c = fileSystems.at( r ) ;
+	std::vector< volume > volumes ;
 
-		if( siritask::encryptedFolderUnMount( a,b,c ).await() ){
+	for( int r = 0 ; r < cipherFolders.size() ; r++ ){
 
-			tablewidget::deleteRow( table,b,1 ) ;
+		volumes.emplace_back( volume{ cipherFolders.at( r ),
+					      mountPoints.at( r ),
+					      fileSystems.at( r ),
+					      state::waiting } ) ;
+	}
 
-			siritask::deleteMountFolder( b ) ;
+	/*
+	 * A volume is unmounted only after every volume mounted inside its mount point
+	 * is unmounted.Volumes that do not depend on each other are unmounted concurrently.
+	 */
+	auto _blocked = [ & ]( const volume& e ){
 
-			utility::Task::suspendForOneSecond() ;
+		auto m = e.mountPoint + "/" ;
+
+		for( const auto& it : volumes ){
+
+			if( it.status != state::unmounted && it.mountPoint.startsWith( m ) ){
+
+				return true ;
+			}
+		}
+
+		return false ;
+	} ;
+
+	auto limit = static_cast< size_t >( utility::mountConcurrencyLimit() ) ;
+
+	size_t running = 0 ;
+
+	QEventLoop loop ;
+
+	std::function< void() > next = [ & ](){
+
+		for( size_t i = 0 ; i < volumes.size() && running < limit ; i++ ){
+
+			auto& it = volumes[ i ] ;
+
+			if( it.status != state::waiting || _blocked( it ) ){
+
+				continue ;
+			}
+
+			it.status = state::running ;
+
+			running++ ;
+
+			auto& e = siritask::encryptedFolderUnMount( it.cipherFolder,it.mountPoint,it.fileSystem ) ;
+
+			e.then( [ &,i ]( bool s ){
+
+				auto& m = volumes[ i ] ;
+
+				running-- ;
+
+				if( s ){
+
+					m.status = state::unmounted ;
+
+					tablewidget::deleteRow( table,m.mountPoint,1 ) ;
+
+					siritask::deleteMountFolder( m.mountPoint ) ;
+				}else{
+					m.status = state::failed ;
+				}
+
+				next() ;
+			} ) ;
+		}
+
+		/*
+		 * Parents of volumes that failed to unmount are left alone.
+		 */
+		if( running == 0 ){
+
+			loop.exit() ;
 		}
+	} ;
+
+	next() ;
+
+	if( running > 0 ){
+
+		loop.exec() ;
 	}
 
 	this->enableAll() ;
@@ -1637,9 +2341,19 @@ void sirikali::unMountAllAndQuit()
 
 void sirikali::pbUpdate()
 {
+	if( m_rpc ){
+
+		m_rpc->volumesChanged() ;
+	}
+
+	if( !m_ui ){
+
+		return ;
+	}
+
 	this->disableAll() ;
 
-	this->updateVolumeList( mountinfo::unlockedVolumes().await() ) ;
+	this->updateVolumeList( *mountinfo::unlockedVolumesSnapshot() ) ;
 }
 
 void sirikali::updateVolumeList( const std::vector< volumeInfo >& r )
@@ -1651,6 +2365,11 @@ void sirikali::updateVolumeList( const std::vector< volumeInfo >& r )
 		this->updateList( it ) ;
 	}
 
+	for( auto it : m_favoritesMenus ){
+
+		it->mountedVolumes( r ) ;
+	}
+
 	this->enableAll() ;
 }
 
@@ -38,6 +38,7 @@
 #include "keydialog.h"
 #include "checkforupdates.h"
 #include "configoptions.h"
+#include "automount.h"
 
 #include <vector>
 
@@ -45,6 +46,8 @@ class QCloseEvent ;
 class QAction ;
 class QTableWidgetItem ;
 class mountinfo ;
+class favoritesMenu ;
+class rpc ;
 
 namespace Ui {
 class sirikali ;
@@ -72,7 +75,11 @@ private slots:
 	void encfsProperties( void ) ;
 	void ecryptfsProperties( void ) ;
 	void securefsProperties( void ) ;
+	void resourceUsage( void ) ;
+	void abortHungVolume( void ) ;
+	void updateHealth( void ) ;
 	void unlockVolume( const QStringList& ) ;
+	void unlockVolumes( const QStringList& ) ;
 	void closeApplication( int = 0,const QString& = QString() ) ;
 	void unlockVolume( void ) ;
 	void startGUI( const std::vector< volumeInfo >& ) ;
@@ -95,7 +102,6 @@ private slots:
 	void addEntryToTable( const QStringList& ) ;
 	void addEntryToTable( const volumeInfo& ) ;
 	void removeEntryFromTable( QString ) ;
-	void showFavorites( void ) ;
 	void favoriteClicked( QAction * ) ;
 	void openMountPointPath( const QString& ) ;
 	void licenseInfo( void ) ;
@@ -106,7 +112,8 @@ private:
 
 	void showTrayIcon() ;
 
-	void mountMultipleVolumes( utility::volumeList ) ;
+	void mountMultipleVolumes( utility::volumeList,bool ) ;
+	void mountVolumes( std::vector< siritask::options >,bool ) ;
 
 	QString resolveFavoriteMountPoint( const QString& ) ;
 
@@ -120,6 +127,7 @@ private:
 	void dropEvent( QDropEvent * ) ;
 	void showContextMenu( QTableWidgetItem *,bool ) ;
 	void updateList( const volumeInfo& ) ;
+	void updateRowHealth( int ) ;
 	void setUpAppMenu( void ) ;
 	void disableAll( void ) ;
 	void closeEvent( QCloseEvent * e ) ;
@@ -127,11 +135,14 @@ private:
 	void setUpShortCuts( void ) ;
 	void raiseWindow( const QString& = QString() ) ;
 	void autoUnlockVolumes( const std::vector< volumeInfo >& ) ;
+	void autoMountFavoritesOnAvailable( std::vector< favorites::entry > ) ;
 
-	utility::volumeList autoUnlockVolumes( utility::volumeList,bool = false ) ;
+	utility::volumeList readKeysFromWallet( utility::volumeList ) ;
 
 	Ui::sirikali * m_ui = nullptr ;
 
+	rpc * m_rpc = nullptr ;
+
 	secrets m_secrets ;
 
 	utility2::translator m_translator ;
@@ -145,10 +156,13 @@ private:
 	std::vector< std::pair< QAction *,const char * > > m_actionPair ;
 	std::vector< std::pair< QMenu *,const char * > > m_menuPair ;
 
+	std::vector< favoritesMenu * > m_favoritesMenus ;
+
 	QAction * m_unMountAll = nullptr ;
 	QAction * m_change_password_action = nullptr ;
 
 	bool m_startHidden ;
+	bool m_daemon = false ;
 	bool m_autoOpenFolderOnMount ;
 	bool m_disableEnableAll = false ;
 	bool m_warnOnMissingExecutable = false ;
@@ -162,6 +176,8 @@ private:
 
 	mountinfo m_mountInfo ;
 
+	automount m_autoMount ;
+
 	checkUpdates m_checkUpdates ;
 
 	configOptions m_configOptions ;
@@ -21,12 +21,34 @@
 #include "siritask.h"
 #include "mountinfo.h"
 #include "winfsp.h"
+#include "openfiles.h"
+#include "profiler.h"
+#include "warmup.h"
+#include "idlemonitor.h"
+#include "backendresources.h"
+#include "supervisor.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QString>
 #include <QDebug>
 #include <QFile>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef Q_OS_LINUX
+#include <sys/mount.h>
+#endif
+
+#ifndef Q_OS_WIN
+#include <sys/statvfs.h>
+#endif
+
 using cs = siritask::status ;
 
 static bool _create_folder( const QString& m )
@@ -99,6 +121,194 @@ static void _run_command_on_mount( const siritask::options& opt,const QString& a
 	}
 }
 
+#ifdef Q_OS_WIN
+
+class usabilityProbe
+{
+public:
+	usabilityProbe( const QString& )
+	{
+	}
+	bool usable( int )
+	{
+		return true ;
+	}
+} ;
+
+#else
+
+/*
+ * statvfs() blocks for as long as the backend does not answer,it runs in a thread
+ * of its own that is left behind if it hangs,the way the watchdog runs its probes.
+ * Only one statvfs() is in flight at a time,a hung one is waited on again instead
+ * of starting another thread.
+ */
+class usabilityProbe
+{
+public:
+	usabilityProbe( const QString& m ) : m_path( QFile::encodeName( m ) )
+	{
+	}
+	bool usable( int timeOut )
+	{
+		if( !m_state || m_state->done ){
+
+			m_state = std::make_shared< state >() ;
+
+			std::thread( [ s = m_state,path = m_path ](){
+
+				struct statvfs e ;
+
+				auto r = statvfs( path.constData(),&e ) == 0 ;
+
+				std::lock_guard< std::mutex > lock( s->mutex ) ;
+
+				s->done   = true ;
+				s->usable = r ;
+
+				s->cv.notify_one() ;
+
+			} ).detach() ;
+		}
+
+		auto s = m_state ;
+
+		std::unique_lock< std::mutex > lock( s->mutex ) ;
+
+		s->cv.wait_for( lock,std::chrono::milliseconds( timeOut ),[ & ](){ return s->done ; } ) ;
+
+		return s->done && s->usable ;
+	}
+private:
+	struct state
+	{
+		std::mutex mutex ;
+		std::condition_variable cv ;
+		bool done = false ;
+		bool usable = false ;
+	} ;
+
+	QByteArray m_path ;
+	std::shared_ptr< state > m_state ;
+} ;
+
+#endif
+
+/*
+ * The kernel reports mount points with symlinks resolved.The mount point itself is
+ * not resolved because that would go through the backend once it is mounted.
+ */
+static QString _canonical_mount_point( const QString& e )
+{
+	QFileInfo m( QDir::cleanPath( e ) ) ;
+
+	auto parent = QFileInfo( m.absolutePath() ).canonicalFilePath() ;
+
+	if( parent.isEmpty() ){
+
+		return m.absoluteFilePath() ;
+
+	}else if( parent == "/" ){
+
+		return "/" + m.fileName() ;
+	}else{
+		return parent + "/" + m.fileName() ;
+	}
+}
+
+enum class readiness{ usable,notMounted,notUsable,backendExited } ;
+
+/*
+ * Backends that daemonize may exit before their file system is ready to be used.
+ * A mount is considered usable once the monitor sees it and statvfs() on it,which
+ * goes through the backend,succeeds.The wait is raced against the exit of the
+ * daemonized backend so that a backend that dies early fails the mount right away.
+ */
+static readiness _wait_until_usable( const QString& m,std::chrono::steady_clock::time_point start )
+{
+	if( utility::platformIsWindows() ){
+
+		return readiness::usable ;
+	}
+
+	using ms = std::chrono::milliseconds ;
+
+	auto end = std::max( start + ms( 20000 ),std::chrono::steady_clock::now() + ms( 5000 ) ) ;
+
+	auto left = [ & ](){
+
+		auto e = std::chrono::duration_cast< ms >( end - std::chrono::steady_clock::now() ) ;
+
+		return static_cast< int >( std::max( e.count(),decltype( e.count() )( 0 ) ) ) ;
+	} ;
+
+	/*
+	 * Backends without a process of their own,like ecryptfs,have no pid.
+	 */
+	auto pid = openFiles::backend( m ) ;
+
+	auto _exited = [ & ](){
+
+		return pid != -1 && openFiles::waitForExit( { { pid,QString(),m } },1 ) ;
+	} ;
+
+	const int slice = 250 ;
+
+	auto status = readiness::notMounted ;
+
+	while( left() > 0 ){
+
+		if( mountinfo::waitForMount( m,std::min( left(),slice ) ) ){
+
+			status = readiness::notUsable ;
+
+			break ;
+		}
+
+		if( _exited() ){
+
+			status = readiness::backendExited ;
+
+			break ;
+		}
+	}
+
+	usabilityProbe probe( m ) ;
+
+	while( status == readiness::notUsable && left() > 0 ){
+
+		if( probe.usable( std::min( left(),slice ) ) ){
+
+			status = readiness::usable ;
+
+		}else if( _exited() ){
+
+			status = readiness::backendExited ;
+		}else{
+			std::this_thread::sleep_for( ms( 50 ) ) ;
+		}
+	}
+
+	auto e = std::chrono::duration_cast< ms >( std::chrono::steady_clock::now() - start ).count() ;
+
+	auto s = QString::number( e ) ;
+
+	if( status == readiness::backendExited ){
+
+		utility::debug() << QString( "Backend Of \"%1\" Exited After %2ms" ).arg( m,s ) ;
+
+	}else if( status != readiness::usable ){
+
+		utility::debug() << QString( "Volume At \"%1\" Is Not Usable After %2ms" ).arg( m,s ) ;
+
+	}else if( utility::debugEnabled() ){
+
+		utility::debug() << QString( "Volume At \"%1\" Became Usable After %2ms" ).arg( m,s ) ;
+	}
+
+	return status ;
+}
+
 bool siritask::deleteMountFolder( const QString& m )
 {
 	if( utility::reUseMountPoint() ){
@@ -126,25 +336,123 @@ static QString _wrap_su( const QString& s )
 	}
 }
 
-static utility::result< utility::Task > _unmount_volume( const QString& exe,
-							 const QString& mountPoint,
-							 bool usePolkit )
+static bool _pre_unmount( const QString& mountPoint )
 {
 	auto e = utility::preUnMountCommand() ;
 
-	int timeOut = 10000 ;
-
 	if( e.isEmpty() ){
 
-		return utility::Task::run( exe,timeOut,usePolkit ).get() ;
+		return true ;
 	}else{
-		if( utility::Task::run( e + " " + mountPoint,timeOut,false ).get().success() ){
+		return utility::Task::run( e + " " + mountPoint,10000,false ).get().success() ;
+	}
+}
+
+static utility::Task _unmount_volume( const QString& exe,bool usePolkit )
+{
+	mountinfo::expectChange() ;
+
+	auto s = utility::Task::run( exe,10000,usePolkit ).get() ;
+
+	mountinfo::expectChange() ;
+
+	return s ;
+}
+
+#ifdef Q_OS_LINUX
+
+/*
+ * umount2() on a FUSE mount needs CAP_SYS_ADMIN and hence only root can unmount
+ * without going through the setuid fusermount.
+ */
+static bool _native_unmount()
+{
+	return geteuid() == 0 ;
+}
+
+static bool _umount2( const QString& mountPoint,bool lazy )
+{
+	return umount2( QFile::encodeName( mountPoint ).constData(),lazy ? MNT_DETACH : 0 ) == 0 ;
+}
 
-			return utility::Task::run( exe,timeOut,usePolkit ).get() ;
+#else
+
+static bool _native_unmount()
+{
+	return false ;
+}
+
+static bool _umount2( const QString&,bool )
+{
+	return false ;
+}
+
+#endif
+
+static const QString& _fusermount()
+{
+	static QString e = [](){
+
+		auto s = utility::executableFullPath( "fusermount3" ) ;
+
+		if( s.isEmpty() ){
+
+			return QString( "fusermount" ) ;
 		}else{
-			return {} ;
+			return s ;
 		}
-	}
+	}() ;
+
+	return e ;
+}
+
+static bool _unmount_fuse( const QString& mountPoint,bool lazy )
+{
+	mountinfo::expectChange() ;
+
+	auto s = [ & ](){
+
+		if( _native_unmount() ){
+
+			return _umount2( mountPoint,lazy ) ;
+		}
+
+		auto m = _makePath( mountPoint ) ;
+
+		QString cmd ;
+
+		if( utility::platformIsOSX() ){
+
+			cmd = "umount " + m ;
+
+		}else if( lazy ){
+
+			cmd = _fusermount() + " -u -z " + m ;
+		}else{
+			cmd = _fusermount() + " -u " + m ;
+		}
+
+		return utility::Task::run( cmd,10000,false ).get().success() ;
+	}() ;
+
+	mountinfo::expectChange() ;
+
+	return s ;
+}
+
+/*
+ * Unmount attempts are retried with exponential backoff starting at 100ms and
+ * capped at 1.6 seconds.A successful attempt is confirmed with the mount monitor
+ * and the attempt is retried if the volume is still mounted.
+ */
+static void _unmount_backoff( int attempt )
+{
+	std::this_thread::sleep_for( std::chrono::milliseconds( std::min( 100 << attempt,1600 ) ) ) ;
+}
+
+static bool _unmount_confirm( const QString& mountPoint )
+{
+	return mountinfo::waitForUnmount( mountPoint,2000 ) ;
 }
 
 static bool _unmount_ecryptfs( const QString& cipherFolder,const QString& mountPoint,int maxCount )
@@ -165,15 +473,25 @@ static bool _unmount_ecryptfs( const QString& cipherFolder,const QString& mountP
 		}
 	} ;
 
+	if( !_pre_unmount( _makePath( mountPoint ) ) ){
+
+		return false ;
+	}
+
 	for( int i = 0 ; i < maxCount ; i++ ){
 
-		auto s = _unmount_volume( cmd(),mountPoint,true ) ;
+		auto s = _unmount_volume( cmd(),true ) ;
 
-		if( s && s.value().success() ){
+		if( s.success() ){
 
-			return true ;
+			if( _unmount_confirm( mountPoint ) ){
+
+				return true ;
+			}
+
+			_unmount_backoff( i ) ;
 		}else{
-			if( not_set && s.value().stdError().contains( "error: failed to set gid" ) ){
+			if( not_set && s.stdError().contains( "error: failed to set gid" ) ){
 
 				if( utility::enablePolkit( utility::background_thread::True ) ){
 
@@ -182,7 +500,7 @@ static bool _unmount_ecryptfs( const QString& cipherFolder,const QString& mountP
 					return false ;
 				}
 			}else{
-				utility::Task::waitForOneSecond() ;
+				_unmount_backoff( i ) ;
 			}
 		}
 	}
@@ -190,55 +508,101 @@ static bool _unmount_ecryptfs( const QString& cipherFolder,const QString& mountP
 	return false ;
 }
 
-static bool _unmount_rest( const QString& mountPoint,int maxCount )
+static bool _unmount_rest( const QString& mountPoint,int maxCount,bool lazy )
 {
 	if( utility::platformIsWindows() ){
 
-		return SiriKali::Winfsp::FspLaunchStop( mountPoint ).success() ;
+		return SiriKali::Winfsp::FspLaunchStop( _makePath( mountPoint ) ).success() ;
 	}
 
-	auto cmd = [ & ](){
+	if( !_pre_unmount( _makePath( mountPoint ) ) ){
 
-		if( utility::platformIsOSX() ){
-
-			return "umount " + mountPoint ;
-		}else{
-			return "fusermount -u " + mountPoint ;
-		}
-	}() ;
+		return false ;
+	}
 
 	for( int i = 0 ; i < maxCount ; i++ ){
 
-		auto s = _unmount_volume( cmd,mountPoint,false ) ;
+		if( _unmount_fuse( mountPoint,false ) ){
 
-		if( s && s.value().success() ){
+			if( _unmount_confirm( mountPoint ) ){
 
-			return true ;
-		}else{
-			utility::Task::waitForOneSecond() ;
+				return true ;
+			}
+
+		}else if( lazy && !utility::platformIsOSX() ){
+
+			/*
+			 * The volume is busy,detach it now and let the backend finish
+			 * flushing in the background.
+			 */
+			auto pid = openFiles::backend( mountPoint ) ;
+
+			if( _unmount_fuse( mountPoint,true ) ){
+
+				mountinfo::watchBackend( pid,mountPoint ) ;
+
+				if( _unmount_confirm( mountPoint ) ){
+
+					return true ;
+				}
+			}
 		}
+
+		_unmount_backoff( i ) ;
 	}
 
 	return false ;
 }
 
+bool siritask::detachMount( const QString& mountPoint )
+{
+	return _unmount_fuse( mountPoint,true ) ;
+}
+
 Task::future< bool >& siritask::encryptedFolderUnMount( const QString& cipherFolder,
 							const QString& mountPoint,
 							const QString& fileSystem )
+{
+	auto lazy = utility::readFavorite( cipherFolder ).lazyUnmount ;
+
+	return siritask::encryptedFolderUnMount( cipherFolder,mountPoint,fileSystem,lazy ) ;
+}
+
+Task::future< bool >& siritask::encryptedFolderUnMount( const QString& cipherFolder,
+							const QString& mountPoint,
+							const QString& fileSystem,
+							bool lazy )
 {
 	return Task::run( [ = ](){
 
-		const int max_count = 5 ;
+		warmUp::cancel( mountPoint ) ;
 
-		if( _ecryptfs( fileSystem ) ){
+		supervisor::expectExit( mountPoint,true ) ;
 
-			auto a = _makePath( cipherFolder ) ;
-			auto b = _makePath( mountPoint ) ;
+		const int max_count = 8 ;
 
-			return _unmount_ecryptfs( a,b,max_count ) ;
+		auto s = [ & ](){
+
+			if( _ecryptfs( fileSystem ) ){
+
+				return _unmount_ecryptfs( _makePath( cipherFolder ),mountPoint,max_count ) ;
+			}else{
+				return _unmount_rest( mountPoint,max_count,lazy ) ;
+			}
+		}() ;
+
+		if( s ){
+
+			/*
+			 * The backend is usually still running right after the unmount,its
+			 * cgroup is removed by the backend watcher once it exits.
+			 */
+			mountinfo::watchBackend( backendResources::release( mountPoint ),mountPoint ) ;
 		}else{
-			return _unmount_rest( _makePath( mountPoint ),max_count ) ;
+			supervisor::expectExit( mountPoint,false ) ;
 		}
+
+		return s ;
 	} ) ;
 }
 
@@ -467,6 +831,11 @@ static QString _sshfs( const cmdArgsList& args )
 		      _mountOptions( args,mountOptions,"sshfs",",subtype=sshfs" ) ) ;
 }
 
+static bool _backend_handles_idle_timeout( const QString& type )
+{
+	return type == "cryfs" || type == "encfs" ;
+}
+
 static QString _args( const QString& exe,const siritask::options& opt,
 		      const QString& configFilePath,
 		      bool create )
@@ -762,8 +1131,16 @@ static utility::Task _run_task( const QString& cmd,
 			return SiriKali::Winfsp::FspLaunchStart( cmd,password.toLatin1(),opts ) ;
 		}
 	}else{
-		return utility::Task( cmd,20000,utility::systemEnvironment(),
-				      password.toLatin1(),[](){},ecryptfs ) ;
+		mountinfo::expectChange() ;
+
+		auto setup = backendResources::childSetup( opts.resources,opts.plainFolder ) ;
+
+		auto s = utility::Task( cmd,20000,utility::systemEnvironment(),
+					password.toLatin1(),std::move( setup ),ecryptfs ) ;
+
+		mountinfo::expectChange() ;
+
+		return s ;
 	}
 }
 
@@ -786,8 +1163,12 @@ static siritask::cmdStatus _cmd( bool create,const siritask::options& opts,
 
 			auto cmd = _args( exe,opt,configFilePath,create ) ;
 
+			profiler::phase p( "runBackend" ) ;
+
 			auto s = _run_task( cmd,password,opt,create,_ecryptfs( app ) ) ;
 
+			p.end() ;
+
 			return { cmd,_status( s,_status( app,status_type::exeName ) ) } ;
 		} ;
 
@@ -819,9 +1200,15 @@ static QString _configFilePath( const siritask::options& opt )
 
 static siritask::cmdStatus _encrypted_folder_mount( const siritask::options& opt,bool reUseMountPoint )
 {
-	auto _mount = [ reUseMountPoint ]( const QString& app,const siritask::options& copt,
+	profiler::phase detectBackend( "detectBackend" ) ;
+
+	auto _mount = [ reUseMountPoint,&detectBackend ]( const QString& app,const siritask::options& copt,
 			const QString& configFilePath )->siritask::cmdStatus{
 
+		detectBackend.end() ;
+
+		profiler::backend( app ) ;
+
 		auto opt = copt ;
 
 		opt.type = app ;
@@ -831,12 +1218,75 @@ static siritask::cmdStatus _encrypted_folder_mount( const siritask::options& opt
 			return cs::ecryptfsIllegalPath ;
 		}
 
-		if( _create_folder( opt.plainFolder ) || reUseMountPoint ){
+		auto created = [ & ](){
+
+			profiler::phase p( "createMountPoint" ) ;
+
+			return _create_folder( opt.plainFolder ) ;
+		}() ;
+
+		if( created || reUseMountPoint ){
+
+			auto start = std::chrono::steady_clock::now() ;
 
 			auto e = _cmd( false,opt,opt.key,configFilePath ) ;
 
 			if( e == cs::success ){
 
+				profiler::phase p( "waitUntilUsable" ) ;
+
+				auto mountPoint = _canonical_mount_point( opt.plainFolder ) ;
+
+				auto ready = _wait_until_usable( mountPoint,start ) ;
+
+				p.end() ;
+
+				if( ready != readiness::usable ){
+
+					if( ready == readiness::notUsable ){
+
+						/*
+						 * A backend that does not answer would hang
+						 * everything that touches its mount point.
+						 */
+						siritask::detachMount( mountPoint ) ;
+					}
+
+					siritask::deleteMountFolder( opt.plainFolder ) ;
+
+					auto m = [ & ](){
+
+						if( ready == readiness::backendExited ){
+
+							return QObject::tr( "The Backend Exited Before The Volume Became Usable." ) ;
+
+						}else if( ready == readiness::notMounted ){
+
+							return QObject::tr( "The Volume Did Not Get Mounted In Time." ) ;
+						}else{
+							return QObject::tr( "The Volume Was Mounted But It Did Not Become Usable In Time." ) ;
+						}
+					}() ;
+
+					return siritask::cmdStatus( cs::backendFail,m ) ;
+				}
+
+				if( profiler::enabled() ){
+
+					profiler::backendProcess( openFiles::backend( mountPoint ) ) ;
+				}
+
+				warmUp::start( mountPoint,opt.warmUpDepth ) ;
+
+				if( !_backend_handles_idle_timeout( opt.type ) ){
+
+					idleMonitor::watch( mountPoint,opt.idleTimeout.toInt(),opt.lazyUnmount ) ;
+				}
+
+				supervisor::watch( opt,opt.autoRemount ) ;
+
+				profiler::phase r( "runCommandOnMount" ) ;
+
 				_run_command_on_mount( opt,app ) ;
 			}else{
 				siritask::deleteMountFolder( opt.plainFolder ) ;
@@ -1054,5 +1504,14 @@ Task::future< siritask::cmdStatus >& siritask::encryptedFolderCreate( const siri
 Task::future< siritask::cmdStatus >& siritask::encryptedFolderMount( const siritask::options& opt,
 								     bool reUseMountPoint )
 {
-	return Task::run( _encrypted_folder_mount,opt,reUseMountPoint ) ;
+	return Task::run( [ opt,reUseMountPoint ](){
+
+		profiler::begin( opt.cipherFolder ) ;
+
+		auto e = _encrypted_folder_mount( opt,reUseMountPoint ) ;
+
+		profiler::end( e == cs::success ) ;
+
+		return e ;
+	} ) ;
 }
@@ -93,6 +93,7 @@ namespace siritask
 			ro( false ),
 			mountOptions( e.mountOptions )
 		{
+			this->setFavoriteOptions( e ) ;
 		}
 		options( const QString& cipher_folder,
 			 const QString& plain_folder,
@@ -115,6 +116,18 @@ namespace siritask
 			createOptions( create_options )
 		{
 		}
+		/*
+		 * Settings that are only kept in favorites.The favorites store
+		 * belongs to the GUI thread and so they are copied here before the
+		 * options are handed to a worker thread.
+		 */
+		void setFavoriteOptions( const favorites::entry& e )
+		{
+			lazyUnmount = e.lazyUnmount ;
+			resources   = e.resources ;
+			warmUpDepth = e.warmUpDepth ;
+			autoRemount = e.autoRemount ;
+		}
 
 		QString cipherFolder ;
 		QString plainFolder ;
@@ -125,6 +138,10 @@ namespace siritask
 		bool ro ;
 		QString mountOptions ;
 		QString createOptions ;
+		bool lazyUnmount = false ;
+		favorites::entry::resources resources ;
+		int warmUpDepth = 0 ;
+		bool autoRemount = false ;
 	};
 
 	enum class status
@@ -268,10 +285,25 @@ namespace siritask
 	};
 
 	bool deleteMountFolder( const QString& ) ;
+
+	/*
+	 * Lazily unmounts a fuse mount,used to clean up after a backend that died.
+	 */
+	bool detachMount( const QString& mountPoint ) ;
+
+	/*
+	 * Reads the lazy unmount setting from favorites,only call it from the GUI
+	 * thread.
+	 */
 	Task::future< bool >& encryptedFolderUnMount( const QString& cipherFolder,
 						      const QString& mountPoint,
 						      const QString& fileSystem ) ;
 
+	Task::future< bool >& encryptedFolderUnMount( const QString& cipherFolder,
+						      const QString& mountPoint,
+						      const QString& fileSystem,
+						      bool lazyUnmount ) ;
+
 	Task::future< cmdStatus >& encryptedFolderMount( const siritask::options&,bool = false ) ;
 	Task::future< cmdStatus >& encryptedFolderCreate( const siritask::options& ) ;
 }
@@ -0,0 +1,257 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "supervisor.h"
+
+#ifdef Q_OS_LINUX
+
+#include "utility.h"
+#include "mountinfo.h"
+#include "openfiles.h"
+
+#include <QDir>
+#include <QObject>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const size_t _restart_budget = 3 ;
+
+static const std::chrono::minutes _restart_window( 10 ) ;
+
+struct supervisedVolume
+{
+	std::vector< std::chrono::steady_clock::time_point > restarts ;
+	int total = 0 ;
+	qint64 pid = -1 ;
+	bool expectExit = false ;
+} ;
+
+static std::mutex _mutex ;
+
+static std::map< QString,supervisedVolume > _volumes ;
+
+static void _forget( const QString& m,qint64 pid )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	auto it = _volumes.find( m ) ;
+
+	if( it != _volumes.end() && it->second.pid == pid ){
+
+		_volumes.erase( it ) ;
+	}
+}
+
+/*
+ * Returns how long to wait before remounting or a negative value if the restart
+ * budget is used up.
+ */
+static int _restart_delay( const QString& m,qint64 pid )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	auto it = _volumes.find( m ) ;
+
+	if( it == _volumes.end() || it->second.pid != pid ){
+
+		return -1 ;
+	}
+
+	auto& s = it->second ;
+
+	auto now = std::chrono::steady_clock::now() ;
+
+	auto e = std::remove_if( s.restarts.begin(),s.restarts.end(),[ & ]( const auto& t ){
+
+		return now - t > _restart_window ;
+	} ) ;
+
+	s.restarts.erase( e,s.restarts.end() ) ;
+
+	if( s.restarts.size() >= _restart_budget ){
+
+		_volumes.erase( it ) ;
+
+		return -1 ;
+	}
+
+	auto delay = 1000 << s.restarts.size() ;
+
+	s.restarts.emplace_back( now ) ;
+
+	s.total++ ;
+
+	return delay ;
+}
+
+static void _supervise( const siritask::options& opts,bool remount,qint64 pid )
+{
+	auto m = QDir::cleanPath( opts.plainFolder ) ;
+
+	openFiles::waitForExit( { { pid,QString(),m } },std::numeric_limits< int >::max() ) ;
+
+	std::unique_lock< std::mutex > lock( _mutex ) ;
+
+	auto it = _volumes.find( m ) ;
+
+	if( it == _volumes.end() || it->second.pid != pid ){
+
+		return ;
+	}
+
+	if( it->second.expectExit ){
+
+		_volumes.erase( it ) ;
+
+		return ;
+	}
+
+	lock.unlock() ;
+
+	/*
+	 * A volume unmounted from outside of SiriKali goes away first and then its
+	 * backend exits.
+	 */
+	if( mountinfo::waitForUnmount( m,2000 ) ){
+
+		return _forget( m,pid ) ;
+	}
+
+	auto e = QObject::tr( "Backend Of \"%1\" With Pid %2 Exited While The Volume Was Still Mounted." ) ;
+
+	utility::debug( false ) << e.arg( m,QString::number( pid ) ) ;
+
+	siritask::detachMount( m ) ;
+
+	if( !remount ){
+
+		return _forget( m,pid ) ;
+	}
+
+	auto delay = _restart_delay( m,pid ) ;
+
+	if( delay < 0 ){
+
+		auto s = QObject::tr( "Not Remounting \"%1\",Its Backend Died Too Many Times." ) ;
+
+		utility::debug( false ) << s.arg( m ) ;
+
+		return ;
+	}
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( delay ) ) ;
+
+	if( siritask::encryptedFolderMount( opts,true ).get() == siritask::status::success ){
+
+		if( utility::debugEnabled() ){
+
+			utility::debug() << QObject::tr( "Remounted \"%1\"." ).arg( m ) ;
+		}
+	}else{
+		utility::debug( false ) << QObject::tr( "Failed To Remount \"%1\"." ).arg( m ) ;
+
+		_forget( m,pid ) ;
+	}
+}
+
+void supervisor::watch( const siritask::options& e,bool remount )
+{
+	auto m = QDir::cleanPath( e.plainFolder ) ;
+
+	auto pid = openFiles::backend( m ) ;
+
+	if( pid == -1 ){
+
+		return ;
+	}
+
+	auto opts = e ;
+
+	if( !remount ){
+
+		opts.key.clear() ;
+	}
+
+	std::unique_lock< std::mutex > lock( _mutex ) ;
+
+	auto& s = _volumes[ m ] ;
+
+	s.pid        = pid ;
+	s.expectExit = false ;
+
+	lock.unlock() ;
+
+	std::thread( [ opts,remount,pid ](){ _supervise( opts,remount,pid ) ; } ).detach() ;
+}
+
+void supervisor::expectExit( const QString& mountPoint,bool e )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	auto it = _volumes.find( QDir::cleanPath( mountPoint ) ) ;
+
+	if( it != _volumes.end() ){
+
+		it->second.expectExit = e ;
+	}
+}
+
+int supervisor::restarts( const QString& mountPoint )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	auto it = _volumes.find( QDir::cleanPath( mountPoint ) ) ;
+
+	if( it != _volumes.end() ){
+
+		return it->second.total ;
+	}else{
+		return 0 ;
+	}
+}
+
+#else
+
+void supervisor::watch( const siritask::options& e,bool remount )
+{
+	Q_UNUSED( e ) ;
+	Q_UNUSED( remount ) ;
+}
+
+void supervisor::expectExit( const QString& mountPoint,bool e )
+{
+	Q_UNUSED( mountPoint ) ;
+	Q_UNUSED( e ) ;
+}
+
+int supervisor::restarts( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	return 0 ;
+}
+
+#endif
@@ -0,0 +1,52 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <QString>
+
+#include "siritask.h"
+
+/*
+ * Watches backends of unlocked volumes and notices when one exits while its volume
+ * is still mounted,which leaves behind a mount point that fails with "Transport
+ * endpoint is not connected".The dead mount is lazily unmounted and,if the favorite
+ * asks for it,the volume is unlocked again with the key it was unlocked with.At most
+ * 3 restarts are made in 10 minutes,waiting 1,2 and then 4 seconds before each.
+ * Only implemented on linux.
+ */
+namespace supervisor
+{
+	/*
+	 * The key in the options is kept in memory only when "remount" is true.
+	 */
+	void watch( const siritask::options&,bool remount ) ;
+
+	/*
+	 * Tells the supervisor that SiriKali is about to unmount the volume and its
+	 * backend is expected to exit.
+	 */
+	void expectExit( const QString& mountPoint,bool ) ;
+
+	int restarts( const QString& mountPoint ) ;
+}
+
+#endif
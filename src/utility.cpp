@@ -29,6 +29,10 @@
 #include <cstdio>
 #include <memory>
 #include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include <QObject>
 #include <QDir>
@@ -63,6 +67,9 @@
 #include "json.h"
 #include "winfsp.h"
 #include "readonlywarning.h"
+#include "favoritesstore.h"
+#include "profiler.h"
+#include "watchdog.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -503,15 +510,60 @@ void utility::openPath( const QString& path,const QString& opener,
 
 		utility::fsInfo s ;
 
+		if( watchdog::health( q ).hung ){
+
+			/*
+			 * statfs() would never return
+			 */
+			s.valid = false ;
+
+			return s ;
+		}
 #ifndef Q_OS_WIN
-		struct statfs e ;
+		/*
+		 * The watchdog only reports a mount as hung after 15 seconds,until
+		 * then statfs() runs in a thread of its own that is left behind if
+		 * it does not return in 5 seconds.
+		 */
+		struct state
+		{
+			std::mutex mutex ;
+			std::condition_variable cv ;
+			bool done = false ;
+			utility::fsInfo info ;
+		} ;
+
+		auto m = std::make_shared< state >() ;
+
+		m->info.valid = false ;
+
+		std::thread( [ m,path = q.toLatin1() ](){
+
+			struct statfs e ;
+
+			utility::fsInfo s ;
+
+			s.valid = statfs( path.constData(),&e ) == 0 ;
+
+			s.f_bavail = e.f_bavail ;
+			s.f_bfree  = e.f_bfree ;
+			s.f_blocks = e.f_blocks ;
+			s.f_bsize  = e.f_bsize ;
+
+			std::lock_guard< std::mutex > lock( m->mutex ) ;
+
+			m->done = true ;
+			m->info = s ;
+
+			m->cv.notify_one() ;
 
-		s.valid = statfs( q.toLatin1().constData(),&e ) == 0 ;
+		} ).detach() ;
 
-		s.f_bavail = e.f_bavail ;
-		s.f_bfree  = e.f_bfree ;
-		s.f_blocks = e.f_blocks ;
-		s.f_bsize  = e.f_bsize ;
+		std::unique_lock< std::mutex > lock( m->mutex ) ;
+
+		m->cv.wait_for( lock,std::chrono::seconds( 5 ),[ & ](){ return m->done ; } ) ;
+
+		s = m->info ;
 #endif
 		return s ;
 	} ) ;
@@ -522,6 +574,11 @@ void utility::setSettingsObject( QSettings * s )
 	_settings = s ;
 }
 
+QSettings& utility::settingsObject()
+{
+	return *_settings ;
+}
+
 static bool _help()
 {
 	utility::debug() << VERSION_STRING << QObject::tr( "\n\
@@ -548,7 +605,19 @@ options:\n\
 	-f   Path to keyfile.\n\
 	-u   Unmount volume.\n\
 	-p   Print a list of unlocked volumes.\n\
-	-s   Option to trigger generation of password hash." ) ;
+	-s   Option to trigger generation of password hash.\n\
+	--daemon   Run without a GUI and serve JSON-RPC requests on the socket other instances connect to,\n\
+	           a display server is only needed to show the GUI when another instance asks for it.\n\
+	           \"-p\",\"-u\" and \"-b\" are handled by a running instance when there is one.\n\
+	--batch   Path to a JSON manifest of volumes to unlock in parallel using keys from a backend given with \"-b\".\n\
+	--batch-tag   Unlock in parallel all favorites with a given tag using keys from a backend given with \"-b\".\n\
+	--profile-json   Append a JSON line with time spent in each phase of unlocking a volume to a given file.\n\
+	--wallet-kdf-benchmark   Print key derivation parameters that make opening an internal wallet take a given\n\
+	                         number of milliseconds(default is 250) on this computer and the time they took.\n\
+	                         Internal wallets use them when \"InternalWalletCalibratedKdf\" is set in the config file,\n\
+	                         older versions of SiriKali report a wrong password for such wallets.\n\
+	--clear-wallet-key-cache   Remove internal wallet keys cached in the session keyring,meant to be run by a screen locker.\n\
+	                           Keys are cached for \"InternalWalletKeyCacheTimeOut\" minutes set in the config file(0 by default,off)." ) ;
 
 	return true ;
 }
@@ -573,13 +642,45 @@ bool utility::printVersionOrHelpInfo( const QStringList& e )
 	}
 }
 
+bool utility::cliWalletBackEnd( const QString& backEnd,LXQt::Wallet::BackEnd& e )
+{
+	namespace wxt = LXQt::Wallet ;
+
+	auto _supported = [ & ]( wxt::BackEnd s,const char * m ){
+
+		if( backEnd == m && wxt::backEndIsSupported( s ) ){
+
+			e = s ;
+
+			return true ;
+		}else{
+			return false ;
+		}
+	} ;
+
+	return _supported( wxt::BackEnd::internal,"internal" ) ||
+	       _supported( wxt::BackEnd::libsecret,"gnomewallet" ) ||
+	       _supported( wxt::BackEnd::libsecret,"libsecret" ) ||
+	       _supported( wxt::BackEnd::kwallet,"kwallet" ) ||
+	       _supported( wxt::BackEnd::osxkeychain,"osxkeychain" ) ;
+}
+
 utility::wallet utility::getKey( const QString& keyID,LXQt::Wallet::Wallet& wallet,QWidget * widget )
 {
 	auto _getKey = []( LXQt::Wallet::Wallet& wallet,const QString& volumeID ){
 
+		profiler::phase p( "walletRead",volumeID ) ;
+
 		return ::Task::await( [ & ](){ return wallet.readValue( volumeID ) ; } ) ;
 	} ;
 
+	auto _open = [ & ]( const QString& walletName,const QString& appName ){
+
+		profiler::phase p( "walletOpen",keyID ) ;
+
+		return wallet.open( walletName,appName ) ;
+	} ;
+
 	utility::wallet w{ false,false,"" } ;
 
 	auto s = wallet.backEnd() ;
@@ -601,12 +702,12 @@ utility::wallet utility::getKey( const QString& keyID,LXQt::Wallet::Wallet& wall
 
 					widget->hide() ;
 
-					w.opened = wallet.open( walletName,appName ) ;
+					w.opened = _open( walletName,appName ) ;
 
 					widget->show() ;
 
 				}else{
-					w.opened = wallet.open( walletName,appName ) ;
+					w.opened = _open( walletName,appName ) ;
 				}
 			}
 
@@ -618,7 +719,7 @@ utility::wallet utility::getKey( const QString& keyID,LXQt::Wallet::Wallet& wall
 			w.notConfigured = true ;
 		}
 	}else{
-		w.opened = wallet.open( utility::walletName( s ),utility::applicationName() ) ;
+		w.opened = _open( utility::walletName( s ),utility::applicationName() ) ;
 
 		if( w.opened ){
 
@@ -781,138 +882,57 @@ QString utility::getVolumeID( const QString& id,bool expand )
 	return id ;
 }
 
+quint64 utility::favoritesGeneration()
+{
+	return favoritesStore::instance().generation() ;
+}
+
 void utility::clearFavorites()
 {
-	_settings->setValue( "FavoritesVolumes",QStringList() ) ;
+	favoritesStore::instance().clear() ;
 }
 
 void utility::replaceFavorite( const favorites::entry& e,const favorites::entry& f )
 {
-	QStringList l ;
-
-	for( const auto& it : utility::readFavorites() ){
-
-		if( it == e ){
-
-			l.append( f.configString() ) ;
-		}else{
-			l.append( it.configString() ) ;
-		}
-	}
-
-	if( !l.isEmpty() ){
-
-		_settings->setValue( "FavoritesVolumes",l ) ;
-	}
+	favoritesStore::instance().replace( e,f ) ;
 }
 
 int utility::favoritesEntrySize()
 {
-	auto s = _settings->value( "FavoritesVolumes" ).toStringList() ;
-
-	if( s.size() == 0 ){
-
-		return 0 ;
-	}else{
-		return utility::split( s.first(),'\t' ).size() ;
-	}
+	return favoritesStore::instance().entrySize() ;
 }
 
 void utility::addToFavorite( const QStringList& e )
 {
 	if( !e.isEmpty() ){
 
-		_settings->setValue( "FavoritesVolumes",[ & ](){
-
-			auto q = utility::readFavorites() ;
-
-			q.emplace_back( e ) ;
-
-			QStringList l ;
-
-			for( const auto& it : q ){
-
-				l.append( it.configString() ) ;
-			}
-
-			return l ;
-		}() ) ;
+		favoritesStore::instance().add( e ) ;
 	}
 }
 
 std::vector< favorites::entry > utility::readFavorites()
 {
-	if( _settings->contains( "FavoritesVolumes" ) ){
-
-		std::vector< favorites::entry > e ;
-
-		for( const auto& it : _settings->value( "FavoritesVolumes" ).toStringList() ){
-
-			e.emplace_back( it ) ;
-		}
+	return favoritesStore::instance().entries() ;
+}
 
-		return e ;
-	}else{
-		return {} ;
-	}
+std::vector< favorites::entry > utility::readAutoMountFavorites()
+{
+	return favoritesStore::instance().autoMountEntries() ;
 }
 
 favorites::entry utility::readFavorite( const QString& e )
 {
-	for( const auto& it : utility::readFavorites() ){
-
-		if( it.volumePath == e ){
-
-			return it ;
-		}
-	}
-
-	return {} ;
+	return favoritesStore::instance().volumePath( e ) ;
 }
 
-void utility::removeFavoriteEntry( const favorites::entry& e )
+favorites::entry utility::readFavoriteByMountPoint( const QString& e )
 {
-	_settings->setValue( "FavoritesVolumes",[ & ](){
-
-		QStringList l ;
-
-		for( const auto& it : utility::readFavorites() ){
-
-			if( it != e ){
-
-				l.append( it.configString() ) ;
-			}
-		}
-
-		return l ;
-	}() ) ;
+	return favoritesStore::instance().mountPointPath( e ) ;
 }
 
-void utility::readFavorites( QMenu * m )
+void utility::removeFavoriteEntry( const favorites::entry& e )
 {
-	m->clear() ;
-
-	auto _add_action = [ m ]( const QString& e,const QString& s ){
-
-		auto ac = new QAction( m ) ;
-
-		ac->setText( e ) ;
-		ac->setObjectName( s ) ;
-
-		return ac ;
-	} ;
-
-	m->addAction( _add_action( QObject::tr( "Manage Favorites" ),"Manage Favorites" ) ) ;
-	m->addAction( _add_action( QObject::tr( "Mount All" ),"Mount All" ) ) ;
-
-	m->addSeparator() ;
-
-	for( const auto& it : utility::readFavorites() ){
-
-		const auto& e = it.volumePath ;
-
-		m->addAction( _add_action( e,e ) ) ;
-	}
+	favoritesStore::instance().remove( e ) ;
 }
 
 void utility::licenseInfo( QWidget * parent )
@@ -1951,6 +1971,60 @@ int utility::pollForUpdatesInterval()
 	return _settings->value( "WinFSPpollingInterval" ).toInt() ;
 }
 
+int utility::pollForUpdatesMaximumInterval()
+{
+	if( !_settings->contains( "PollForUpdatesMaximumInterval" ) ){
+
+		_settings->setValue( "PollForUpdatesMaximumInterval",30 ) ;
+	}
+
+	return _settings->value( "PollForUpdatesMaximumInterval" ).toInt() ;
+}
+
+int utility::mountConcurrencyLimit()
+{
+	if( !_settings->contains( "MountConcurrencyLimit" ) ){
+
+		_settings->setValue( "MountConcurrencyLimit",4 ) ;
+	}
+
+	auto s = _settings->value( "MountConcurrencyLimit" ).toInt() ;
+
+	if( s < 1 ){
+
+		return 1 ;
+	}else{
+		return s ;
+	}
+}
+
+bool utility::internalWalletCalibratedKdf()
+{
+	if( !_settings->contains( "InternalWalletCalibratedKdf" ) ){
+
+		_settings->setValue( "InternalWalletCalibratedKdf",false ) ;
+	}
+
+	return _settings->value( "InternalWalletCalibratedKdf" ).toBool() ;
+}
+
+int utility::internalWalletKeyCacheTimeOut()
+{
+	if( !_settings->contains( "InternalWalletKeyCacheTimeOut" ) ){
+
+		_settings->setValue( "InternalWalletKeyCacheTimeOut",0 ) ;
+	}
+
+	auto s = _settings->value( "InternalWalletKeyCacheTimeOut" ).toInt() ;
+
+	if( s < 0 ){
+
+		return 0 ;
+	}else{
+		return s ;
+	}
+}
+
 void utility::setWindowsExecutableSearchPath( const QString& e )
 {
 	if( e.isEmpty() ){
@@ -266,6 +266,12 @@ namespace utility
 
 	wallet getKey( const QString& keyID,LXQt::Wallet::Wallet&,QWidget * = nullptr ) ;
 
+	/*
+	 * Maps a backend name given with "-b" to a wallet backend,returns false if the
+	 * name is not a wallet backend or the backend is not supported in this build.
+	 */
+	bool cliWalletBackEnd( const QString&,LXQt::Wallet::BackEnd& ) ;
+
 	QString cmdArgumentValue( const QStringList&,const QString& arg,const QString& defaulT = QString() ) ;
 
 	void runCommandOnMount( const QString& ) ;
@@ -305,6 +311,7 @@ namespace utility
 	void setDefaultMountPointPrefix( const QString& path ) ;
 
 	void setSettingsObject( QSettings * ) ;
+	QSettings& settingsObject() ;
 
 	void preUnMountCommand( const QString& ) ;
 	QString preUnMountCommand( void ) ;
@@ -321,6 +328,10 @@ namespace utility
 	QString securefsPath() ;
 	QString winFSPpath() ;
 	int pollForUpdatesInterval() ;
+	int pollForUpdatesMaximumInterval() ;
+	int mountConcurrencyLimit() ;
+	int internalWalletKeyCacheTimeOut() ;
+	bool internalWalletCalibratedKdf() ;
 
 	bool autoCheck() ;
 	void autoCheck( bool ) ;
@@ -384,12 +395,18 @@ namespace utility
 	QString helperSocketPath() ;
 	void clearFavorites( void ) ;
 	void addToFavorite( const QStringList& ) ;
+	/*
+	 * The favorites store is not thread safe,read favorites from the GUI
+	 * thread only.
+	 */
 	std::vector< favorites::entry > readFavorites( void ) ;
+	std::vector< favorites::entry > readAutoMountFavorites( void ) ;
 	favorites::entry readFavorite( const QString& ) ;
+	favorites::entry readFavoriteByMountPoint( const QString& ) ;
 	void replaceFavorite( const favorites::entry&,const favorites::entry& ) ;
-	void readFavorites( QMenu * ) ;
 	void removeFavoriteEntry( const favorites::entry& ) ;
 	int favoritesEntrySize() ;
+	quint64 favoritesGeneration() ;
 	QString getVolumeID( const QString&,bool = false ) ;
 	QString localizationLanguage() ;
 	QString localizationLanguagePath() ;
@@ -0,0 +1,364 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "warmup.h"
+#include "utility.h"
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+
+#ifdef Q_OS_LINUX
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class warmUpWalk
+{
+public:
+	warmUpWalk( const std::string& root,int depth ) :
+		m_start( std::chrono::steady_clock::now() ),m_root( root ),m_running( 0 )
+	{
+		m_folders.emplace_back( root,depth ) ;
+	}
+	const std::string& root() const
+	{
+		return m_root ;
+	}
+	/*
+	 * The device is set when the root is read,which happens before any other
+	 * folder is handed out.
+	 */
+	void setDevice( dev_t e )
+	{
+		m_device = e ;
+	}
+	bool sameDevice( dev_t e ) const
+	{
+		return m_device == e ;
+	}
+	bool cancelled() const
+	{
+		return m_cancelled.load() ;
+	}
+	void add( std::string folder,int depth )
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_folders.emplace_back( std::move( folder ),depth ) ;
+
+		m_changed.notify_one() ;
+	}
+	/*
+	 * Hands out the next folder to read.Returns false when there is nothing left
+	 * to read and no other thread is reading a folder that could add more.
+	 */
+	bool next( std::pair< std::string,int >& e )
+	{
+		std::unique_lock< std::mutex > lock( m_mutex ) ;
+
+		m_changed.wait( lock,[ this ](){
+
+			return m_cancelled || !m_folders.empty() || m_busy == 0 ;
+		} ) ;
+
+		if( m_cancelled || m_folders.empty() ){
+
+			return false ;
+		}
+
+		e = std::move( m_folders.front() ) ;
+
+		m_folders.pop_front() ;
+
+		m_busy++ ;
+
+		return true ;
+	}
+	void done()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_busy-- ;
+
+		m_changed.notify_all() ;
+	}
+	void visited()
+	{
+		m_entries++ ;
+	}
+	void threadStarted()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_running++ ;
+	}
+	/*
+	 * Returns true for the last thread to finish.
+	 */
+	bool threadFinished()
+	{
+		std::lock_guard< std::mutex > lock( m_mutex ) ;
+
+		m_running-- ;
+
+		m_changed.notify_all() ;
+
+		return m_running == 0 ;
+	}
+	void cancel()
+	{
+		std::unique_lock< std::mutex > lock( m_mutex ) ;
+
+		m_cancelled = true ;
+
+		m_changed.notify_all() ;
+
+		m_changed.wait_for( lock,std::chrono::seconds( 10 ),[ this ](){ return m_running == 0 ; } ) ;
+	}
+	quint64 entries() const
+	{
+		return m_entries.load() ;
+	}
+	qint64 elapsed() const
+	{
+		auto e = std::chrono::steady_clock::now() - m_start ;
+
+		return std::chrono::duration_cast< std::chrono::milliseconds >( e ).count() ;
+	}
+private:
+	std::chrono::steady_clock::time_point m_start ;
+	std::string m_root ;
+	dev_t m_device = 0 ;
+	std::atomic_bool m_cancelled{ false } ;
+	std::atomic< quint64 > m_entries{ 0 } ;
+	std::mutex m_mutex ;
+	std::condition_variable m_changed ;
+	std::deque< std::pair< std::string,int > > m_folders ;
+	int m_busy = 0 ;
+	int m_running ;
+};
+
+static std::mutex _walks_mutex ;
+
+static std::map< QString,std::shared_ptr< warmUpWalk > > _walks ;
+
+static void _lower_priority()
+{
+	auto tid = static_cast< int >( syscall( SYS_gettid ) ) ;
+
+	setpriority( PRIO_PROCESS,static_cast< id_t >( tid ),19 ) ;
+
+	/*
+	 * IOPRIO_WHO_PROCESS and the idle io scheduling class,the values are not
+	 * exported by glibc.
+	 */
+	const int who_process = 1 ;
+	const int class_idle  = 3 << 13 ;
+
+	syscall( SYS_ioprio_set,who_process,tid,class_idle ) ;
+}
+
+static void _read_folder( warmUpWalk& w,const std::string& path,int depth )
+{
+	int fd = open( path.c_str(),O_RDONLY | O_DIRECTORY | O_CLOEXEC ) ;
+
+	if( fd == -1 ){
+
+		return ;
+	}
+
+	if( path == w.root() ){
+
+		struct stat st ;
+
+		if( fstat( fd,&st ) != 0 ){
+
+			close( fd ) ;
+
+			return ;
+		}
+
+		w.setDevice( st.st_dev ) ;
+	}
+
+	alignas( struct dirent64 ) char buffer[ 32 * 1024 ] ;
+
+	while( !w.cancelled() ){
+
+		auto n = syscall( SYS_getdents64,fd,buffer,sizeof( buffer ) ) ;
+
+		if( n <= 0 ){
+
+			break ;
+		}
+
+		for( long i = 0 ; i < n && !w.cancelled() ; ){
+
+			auto d = reinterpret_cast< struct dirent64 * >( buffer + i ) ;
+
+			i += d->d_reclen ;
+
+			const char * name = d->d_name ;
+
+			if( std::strcmp( name,"." ) == 0 || std::strcmp( name,".." ) == 0 ){
+
+				continue ;
+			}
+
+			struct stat st ;
+
+			if( fstatat( fd,name,&st,AT_SYMLINK_NOFOLLOW ) == 0 ){
+
+				w.visited() ;
+
+				/*
+				 * Folders of file systems mounted inside the volume are not walked.
+				 */
+				if( depth > 1 && S_ISDIR( st.st_mode ) && w.sameDevice( st.st_dev ) ){
+
+					w.add( path + "/" + name,depth - 1 ) ;
+				}
+			}
+		}
+	}
+
+	close( fd ) ;
+}
+
+void warmUp::start( const QString& mountPoint,int depth )
+{
+	if( depth <= 0 ){
+
+		return ;
+	}
+
+	auto m = QDir::cleanPath( mountPoint ) ;
+
+	auto w = std::make_shared< warmUpWalk >( QFile::encodeName( m ).constData(),depth ) ;
+
+	std::unique_lock< std::mutex > lock( _walks_mutex ) ;
+
+	if( _walks.find( m ) != _walks.end() ){
+
+		return ;
+	}
+
+	_walks[ m ] = w ;
+
+	lock.unlock() ;
+
+	auto threads = std::min( 4,std::max( 1,static_cast< int >( std::thread::hardware_concurrency() ) ) ) ;
+
+	for( int i = 0 ; i < threads ; i++ ){
+
+		w->threadStarted() ;
+	}
+
+	for( int i = 0 ; i < threads ; i++ ){
+
+		std::thread( [ w,m ](){
+
+			_lower_priority() ;
+
+			std::pair< std::string,int > e ;
+
+			while( w->next( e ) ){
+
+				_read_folder( *w,e.first,e.second ) ;
+
+				w->done() ;
+			}
+
+			if( w->threadFinished() ){
+
+				std::unique_lock< std::mutex > lock( _walks_mutex ) ;
+
+				auto it = _walks.find( m ) ;
+
+				if( it != _walks.end() && it->second == w ){
+
+					_walks.erase( it ) ;
+				}
+
+				lock.unlock() ;
+
+				if( utility::debugEnabled() ){
+
+					auto s = QObject::tr( "Warm Up Of \"%1\" %2 After Visiting %3 Entries In %4ms." ) ;
+
+					auto r = w->cancelled() ? QObject::tr( "Was Cancelled" ) : QObject::tr( "Finished" ) ;
+
+					utility::debug() << s.arg( m,r,QString::number( w->entries() ),QString::number( w->elapsed() ) ) ;
+				}
+			}
+
+		} ).detach() ;
+	}
+}
+
+void warmUp::cancel( const QString& mountPoint )
+{
+	std::unique_lock< std::mutex > lock( _walks_mutex ) ;
+
+	auto it = _walks.find( QDir::cleanPath( mountPoint ) ) ;
+
+	if( it == _walks.end() ){
+
+		return ;
+	}
+
+	auto w = it->second ;
+
+	lock.unlock() ;
+
+	w->cancel() ;
+}
+
+#else
+
+void warmUp::start( const QString& mountPoint,int depth )
+{
+	Q_UNUSED( mountPoint ) ;
+	Q_UNUSED( depth ) ;
+}
+
+void warmUp::cancel( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+}
+
+#endif
@@ -0,0 +1,43 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WARM_UP_H
+#define WARM_UP_H
+
+#include <QString>
+
+/*
+ * Reads folders of a freshly unlocked volume in the background down to a given
+ * depth so that the backend decrypts them and the kernel caches them before the
+ * user gets there.It runs at the lowest cpu and io priority on a few threads
+ * and it is only implemented on linux.
+ */
+namespace warmUp
+{
+	void start( const QString& mountPoint,int depth ) ;
+
+	/*
+	 * Stops a warm up of a volume and returns once nothing in the volume
+	 * is held open by it anymore.
+	 */
+	void cancel( const QString& mountPoint ) ;
+}
+
+#endif
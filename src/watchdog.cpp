@@ -0,0 +1,289 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "watchdog.h"
+
+#ifdef Q_OS_LINUX
+
+#include "utility.h"
+#include "mountinfo.h"
+#include "siritask.h"
+#include "supervisor.h"
+#include "idlemonitor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+static const std::chrono::seconds _probe_interval( 10 ) ;
+
+static const std::chrono::seconds _hung_threshold( 15 ) ;
+
+struct probe
+{
+	bool inFlight = false ;
+	std::chrono::steady_clock::time_point started ;
+	qint64 latency = -1 ;
+} ;
+
+static std::mutex _mutex ;
+
+static std::map< QString,std::shared_ptr< probe > > _probes ;
+
+static qint64 _milliseconds( std::chrono::steady_clock::duration e )
+{
+	return std::chrono::duration_cast< std::chrono::milliseconds >( e ).count() ;
+}
+
+/*
+ * AT_STATX_FORCE_SYNC makes fuse ask the backend instead of answering from its
+ * attribute cache.
+ */
+static void _stat( const QByteArray& m )
+{
+#ifdef STATX_BASIC_STATS
+	struct statx e ;
+
+	statx( AT_FDCWD,m.constData(),AT_STATX_FORCE_SYNC,STATX_BASIC_STATS,&e ) ;
+#else
+	struct statvfs e ;
+
+	statvfs( m.constData(),&e ) ;
+#endif
+}
+
+static void _probe( const QString& m,std::shared_ptr< probe > p )
+{
+	{
+		std::lock_guard< std::mutex > lock( _mutex ) ;
+
+		p->inFlight = true ;
+		p->started  = std::chrono::steady_clock::now() ;
+	}
+
+	std::thread( [ p,m ](){
+
+		/*
+		 * Answering the probe is I/O of the backend that must not keep the
+		 * volume from being unmounted when idle.
+		 */
+		idleMonitor::unobserved( m,[ & ](){ _stat( QFile::encodeName( m ) ) ; } ) ;
+
+		std::lock_guard< std::mutex > lock( _mutex ) ;
+
+		p->latency  = _milliseconds( std::chrono::steady_clock::now() - p->started ) ;
+		p->inFlight = false ;
+
+	} ).detach() ;
+}
+
+static void _watch()
+{
+	while( true ){
+
+		auto volumes = mountinfo::unlockedVolumesSnapshot() ;
+
+		std::map< QString,std::shared_ptr< probe > > probes ;
+
+		std::unique_lock< std::mutex > lock( _mutex ) ;
+
+		for( const auto& it : *volumes ){
+
+			if( it.fileSystem() == "ecryptfs" ){
+
+				continue ;
+			}
+
+			auto m = QDir::cleanPath( it.mountPoint() ) ;
+
+			auto e = _probes.find( m ) ;
+
+			if( e == _probes.end() ){
+
+				probes[ m ] = std::make_shared< probe >() ;
+			}else{
+				probes[ m ] = e->second ;
+			}
+		}
+
+		_probes = probes ;
+
+		lock.unlock() ;
+
+		for( const auto& it : probes ){
+
+			lock.lock() ;
+
+			auto busy = it.second->inFlight ;
+
+			lock.unlock() ;
+
+			/*
+			 * A volume nobody used for a minute is left alone,probing it
+			 * would only keep its backend busy.
+			 */
+			if( !busy && !idleMonitor::quiet( it.first,60 ) ){
+
+				_probe( it.first,it.second ) ;
+			}
+		}
+
+		std::this_thread::sleep_for( _probe_interval ) ;
+	}
+}
+
+void watchdog::start()
+{
+	static std::once_flag once ;
+
+	std::call_once( once,[](){ std::thread( _watch ).detach() ; } ) ;
+}
+
+watchdog::health watchdog::health( const QString& mountPoint )
+{
+	std::lock_guard< std::mutex > lock( _mutex ) ;
+
+	auto it = _probes.find( QDir::cleanPath( mountPoint ) ) ;
+
+	if( it == _probes.end() ){
+
+		return { -1,false } ;
+	}
+
+	const auto& p = *it->second ;
+
+	if( p.inFlight ){
+
+		auto e = std::chrono::steady_clock::now() - p.started ;
+
+		return { std::max( p.latency,_milliseconds( e ) ),e > _hung_threshold } ;
+	}else{
+		return { p.latency,false } ;
+	}
+}
+
+static QString _unescape( const QByteArray& e )
+{
+	QByteArray s ;
+
+	for( int i = 0 ; i < e.size() ; i++ ){
+
+		if( e.at( i ) == '\\' && i + 3 < e.size() ){
+
+			s.append( static_cast< char >( e.mid( i + 1,3 ).toInt( nullptr,8 ) ) ) ;
+
+			i += 3 ;
+		}else{
+			s.append( e.at( i ) ) ;
+		}
+	}
+
+	return QFile::decodeName( s ) ;
+}
+
+/*
+ * The fuse connection id is the minor device number of the mount,it is read
+ * from mountinfo because the mount itself can not be stat()ed when it is hung.
+ */
+static int _connection( const QString& mountPoint )
+{
+	QFile f( "/proc/self/mountinfo" ) ;
+
+	if( !f.open( QIODevice::ReadOnly ) ){
+
+		return -1 ;
+	}
+
+	auto m = QDir::cleanPath( mountPoint ) ;
+
+	for( const auto& it : f.readAll().split( '\n' ) ){
+
+		auto e = it.split( ' ' ) ;
+
+		if( e.size() > 4 && _unescape( e.at( 4 ) ) == m ){
+
+			auto s = e.at( 2 ).split( ':' ) ;
+
+			if( s.size() == 2 ){
+
+				return s.at( 1 ).toInt() ;
+			}
+		}
+	}
+
+	return -1 ;
+}
+
+bool watchdog::abort( const QString& mountPoint )
+{
+	auto id = _connection( mountPoint ) ;
+
+	if( id == -1 ){
+
+		return false ;
+	}
+
+	supervisor::expectExit( mountPoint,true ) ;
+
+	QFile f( "/sys/fs/fuse/connections/" + QString::number( id ) + "/abort" ) ;
+
+	if( !f.open( QIODevice::WriteOnly ) || f.write( "1" ) != 1 ){
+
+		auto e = QObject::tr( "Failed To Abort The Fuse Connection Of \"%1\",Is fusectl Mounted?" ) ;
+
+		utility::debug( false ) << e.arg( mountPoint ) ;
+	}
+
+	f.close() ;
+
+	return siritask::detachMount( mountPoint ) ;
+}
+
+#else
+
+void watchdog::start()
+{
+}
+
+watchdog::health watchdog::health( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	return { -1,false } ;
+}
+
+bool watchdog::abort( const QString& mountPoint )
+{
+	Q_UNUSED( mountPoint ) ;
+
+	return false ;
+}
+
+#endif
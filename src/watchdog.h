@@ -0,0 +1,54 @@
+
+/*
+ *
+ *  Copyright (c) 2018
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <QString>
+
+/*
+ * A backend that stops answering requests hangs every process that touches its
+ * mount point,SiriKali included.Every 10 seconds each fuse mount is probed with
+ * statx() in a thread of its own that is simply left behind if it hangs.The time
+ * the last probe took is kept as a health metric and a mount whose probe did not
+ * return in 15 seconds is reported as hung.Volumes the idle monitor sees as unused
+ * for a minute are not probed and the I/O of a probe does not count as activity.
+ * Only implemented on linux.
+ */
+namespace watchdog
+{
+	struct health
+	{
+		qint64 latency ; // milliseconds,-1 if the mount was not probed yet
+		bool hung ;
+	} ;
+
+	void start() ;
+
+	watchdog::health health( const QString& mountPoint ) ;
+
+	/*
+	 * Aborts the fuse connection of a mount through fusectl,which makes every
+	 * pending and future request fail,and then lazily unmounts it.
+	 */
+	bool abort( const QString& mountPoint ) ;
+}
+
+#endif